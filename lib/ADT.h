@@ -1,6 +1,7 @@
 #pragma once  // include at most once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 
@@ -25,6 +26,9 @@ typedef void (*DestroyFunc)(Pointer value);
 // Pointer to function that hashes a value to a positive integer - needed only by the hash table
 typedef unsigned int (*HashFunc)(Pointer value);
 
+// Pointer to function that hashes a value to a 64-bit integer - for large hash tables and bloom filters
+typedef uint64_t (*HashFunc64)(Pointer value);
+
 
 // Graph typedefs
 typedef uint32_t Vertex;
@@ -47,8 +51,10 @@ typedef struct StackSet* Stack;            // stack (Stack)
 typedef struct queue* Queue;               // queue (Queue)
 typedef struct pq* PQueue;                 // priority queue (PQueue)
 typedef struct Set* RBTree;                // red-black tree (RBTree)
+typedef struct bptree* BPTree;             // B+ tree (BPTree)
 typedef struct hash_table* HashTable;      // hash table (HashTable)
 typedef struct bfilter* bloom_filter;      // bloom filter (bloom_filter)
+typedef struct string_pool* StringPool;    // string pool (StringPool)
 typedef struct _dir_graph* dir_graph;      // directed graph (dir_graph)
 typedef struct _undir_graph* undir_graph;  // undirected graph (undir_graph)
 typedef struct _wu_graph* wu_graph;        // weighted undirected (wu_graph)
@@ -119,7 +125,10 @@ void pq_destroy(const PQueue);                                // destroys memory
 // -requires a compare and destroy function
 typedef struct tnode* RBTreeNode;  // rbt node handle
 RBTree rbt_create(const CompareFunc, const DestroyFunc);       // creates red-black tree
+RBTree rbt_create_from_sorted(const CompareFunc, const DestroyFunc, const Pointer*, const uint64_t);  // creates balanced red-black tree from n sorted values
 bool rbt_insert(const RBTree, const Pointer);                  // insert the item
+bool rbt_get_or_insert(const RBTree, const Pointer value, Pointer* existing);  // inserts the item if it does not exist, returns the stored one at existing without destroying value
+uint64_t rbt_insert_sorted_batch(const RBTree, const Pointer*, const uint64_t);  // inserts n sorted values, returns the number inserted
 bool rbt_remove(const RBTree, const Pointer);                  // remove the item
 bool rbt_exists(const RBTree, const Pointer);                  // returns true if the value exists, false otherwise
 uint64_t rbt_size(const RBTree);                               // returns the size of the tree
@@ -133,17 +142,104 @@ RBTreeNode rbt_find_next(const RBTreeNode);                    // returns the ne
 RBTreeNode rbt_first(const RBTree);                            // returns the node with the lowest value
 RBTreeNode rbt_last(const RBTree);                             // returns the node with the highest value
 
+RBTree rbt_map_create(const CompareFunc, const DestroyFunc, const DestroyFunc);  // creates red-black tree in map mode (key, value destroy functions)
+bool rbt_map_put(const RBTree, const Pointer key, const Pointer value);         // inserts the key with the value, or replaces its value
+Pointer* rbt_map_get(const RBTree, const Pointer key);                          // returns the address of the key's value, NULL if it does not exist
+Pointer* rbt_map_get_or_insert(const RBTree, const Pointer key, bool* inserted);  // returns the address of the key's value, inserting the key if needed
+Pointer* rbt_map_node_value(const RBTreeNode);                                  // returns the address of the value of the node
+
+#define RBT_MAX_HEIGHT 128  // maximum height of a red-black tree
+typedef struct rbt_iter { RBTreeNode stack[RBT_MAX_HEIGHT]; uint8_t top; } rbt_iter;  // in order iterator
+RBTreeNode rbt_iter_begin(const RBTree, rbt_iter*);            // initializes the iterator and returns the node with the lowest value
+RBTreeNode rbt_iter_next(rbt_iter*);                           // returns the next, in order, node or NULL if the iteration is over
+
+typedef struct rbt_version* RBTreeVersion;  // persistent (copy-on-write) rbt version handle
+RBTreeVersion rbt_persistent_create(const CompareFunc, const DestroyFunc);  // creates an empty version
+RBTreeVersion rbt_insert_persistent(const RBTreeVersion, const Pointer);   // returns a new version with the value inserted
+RBTreeVersion rbt_remove_persistent(const RBTreeVersion, const Pointer);   // returns a new version with the value removed
+bool rbt_version_exists(const RBTreeVersion, const Pointer);               // returns true if the value exists in the version, false otherwise
+uint64_t rbt_version_size(const RBTreeVersion);                            // returns the size of the version
+void rbt_version_foreach(const RBTreeVersion, void (*visit)(Pointer value, void* context), void*);  // visits the values of the version in order
+RBTreeVersion rbt_version_retain(const RBTreeVersion);                     // returns a new handle to the version (snapshot)
+void rbt_version_release(const RBTreeVersion);                             // releases the handle to the version
+
+typedef struct rbt_concurrent* RBTreeConcurrent;  // concurrent rbt handle
+RBTreeConcurrent rbt_concurrent_create(const CompareFunc, const DestroyFunc);  // creates concurrent red-black tree
+bool rbt_concurrent_insert(const RBTreeConcurrent, const Pointer);             // insert the item
+bool rbt_concurrent_remove(const RBTreeConcurrent, const Pointer);             // remove the item
+bool rbt_concurrent_exists(const RBTreeConcurrent, const Pointer);             // returns true if the value exists, false otherwise (lock-free)
+uint64_t rbt_concurrent_size(const RBTreeConcurrent);                          // returns the size of the tree
+RBTreeVersion rbt_concurrent_snapshot(const RBTreeConcurrent);                 // returns the current version of the tree
+void rbt_concurrent_destroy(const RBTreeConcurrent);                           // destroys the memory used by the tree
+
+
+// B+ TREE
+// -requires a compare and destroy function
+// -same interface as the red-black tree, node handles are invalidated by insertions and removals
+typedef struct bpt_entry* BPTreeNode;  // b+ tree node handle
+BPTree bpt_create(const CompareFunc, const DestroyFunc);       // creates B+ tree
+bool bpt_insert(const BPTree, const Pointer);                  // insert the item
+bool bpt_remove(const BPTree, const Pointer);                  // remove the item
+bool bpt_exists(const BPTree, const Pointer);                  // returns true if the value exists, false otherwise
+uint64_t bpt_size(const BPTree);                               // returns the size of the tree
+bool is_bpt_empty(const BPTree);                               // returns true if the tree is empty, false otherwise
+DestroyFunc bpt_set_destroy(const BPTree, const DestroyFunc);  // changes the destroy function and returns the old one
+void bpt_destroy(const BPTree);                                // destroys the memory used by the tree
+Pointer bpt_node_value(const BPTreeNode);                      // returns the value of the node
+BPTreeNode bpt_find_node(const BPTree, const Pointer);         // returns the node with that value, if it exists, otherwise NULL
+BPTreeNode bpt_find_previous(const BPTreeNode);                // returns the previous, in order, node of target
+BPTreeNode bpt_find_next(const BPTreeNode);                    // returns the next, in order, node of target
+BPTreeNode bpt_first(const BPTree);                            // returns the node with the lowest value
+BPTreeNode bpt_last(const BPTree);                             // returns the node with the highest value
+
 
 // HASH TABLE
 // -requires a hash, compare and destroy function
 HashTable hash_create(const HashFunc, const CompareFunc, const DestroyFunc);  // creates hash table
+HashTable hash_create_with_capacity(const HashFunc, const CompareFunc, const DestroyFunc, const uint64_t expected);  // creates hash table with room for the expected elements
 bool hash_insert(const HashTable, const Pointer);                             // inserts value at the hash table
 bool hash_remove(const HashTable, const Pointer);                             // removes the value from the hash table
 bool hash_exists(const HashTable, const Pointer);                             // returns true if value exists in the hash table
+Pointer hash_find(const HashTable, const Pointer);                            // returns the stored element equal to value, NULL if it does not exist
+bool hash_get_or_insert(const HashTable, const Pointer, Pointer* existing);   // inserts value unless it exists (then not destroyed, existing: the stored element)
 uint64_t hash_size(const HashTable);                                          // returns the number of elements in the hash table
 bool is_ht_empty(const HashTable);                                            // returns true if the hash table is empty, false otherwise
 DestroyFunc hash_set_destroy(const HashTable, const DestroyFunc);             // changes the destroy function and returns the old one
+void hash_compact(const HashTable);                                           // removes the deleted buckets (tombstones) of open addressing
+void hash_reserve(const HashTable, const uint64_t n);                          // makes room for n elements, so that inserting them does not rehash
 void hash_destroy(const HashTable);                                           // destroys the memory used by the hash table
+uint64_t hash_exists_many(const HashTable, const Pointer*, const uint64_t, uint64_t*);  // checks whether each value exists (result bitmap), returns how many exist
+uint64_t hash_insert_many(const HashTable, const Pointer*, const uint64_t, uint64_t*);  // inserts the values (result bitmap), returns how many were inserted
+
+HashTable hash_map_create(const HashFunc, const CompareFunc, const DestroyFunc, const DestroyFunc);  // creates hash table in map mode (key, value destroy functions)
+bool hash_map_put(const HashTable, const Pointer key, const Pointer value);                       // inserts the key with the value, or replaces its value
+Pointer* hash_map_get(const HashTable, const Pointer key);                                        // returns the address of the key's value, NULL if it does not exist
+Pointer* hash_map_get_or_insert(const HashTable, const Pointer key, bool* inserted);               // returns the address of the key's value, inserting the key if needed
+
+HashTable hash_create_concurrent(const HashFunc, const CompareFunc, const DestroyFunc);  // creates a thread-safe, sharded, hash table (SeparateChaining only)
+
+HashTable hash_create64(const HashFunc64, const CompareFunc, const DestroyFunc);                          // creates hash table with a 64-bit hash function
+HashTable hash_map_create64(const HashFunc64, const CompareFunc, const DestroyFunc, const DestroyFunc);    // creates hash table in map mode with a 64-bit hash function
+HashTable hash_create_concurrent64(const HashFunc64, const CompareFunc, const DestroyFunc);               // creates a concurrent hash table with a 64-bit hash function (SeparateChaining only)
+
+#define HT_HISTOGRAM_SIZE 16
+struct ht_stats
+{
+    uint64_t elements, buckets;             // number of elements and buckets
+    double load_factor;                     // elements / buckets
+    uint64_t bytes;                         // bytes allocated, not counting the elements
+    uint64_t histogram[HT_HISTOGRAM_SIZE];  // chained: buckets with i elements, open addressing: elements found with i probes
+    uint64_t tombstones, rehashes;          // deleted buckets, reallocations of the buckets
+    uint64_t lookups, probes;               // searches and their probes (only counted with HT_PROBE_STATS)
+};
+void hash_stats(const HashTable, struct ht_stats*);  // fills the statistics of the hash table
+
+void hash_foreach(const HashTable, void (*visit)(Pointer value, void* context), void* context);  // visits every element, passing the context
+typedef struct hash_iter { HashTable ht; uint64_t pos; Pointer node; } hash_iter;  // iterator (the hash table must not be modified)
+Pointer hash_iter_begin(const HashTable, hash_iter*);  // initializes the iterator and returns the first element, NULL if the hash table is empty
+Pointer hash_iter_next(hash_iter*);                    // returns the next element, NULL if the iteration is over
+Pointer* hash_iter_value(const hash_iter*);            // returns the address of the current element's value (map mode)
+uint64_t hash_scan(const HashTable, const uint64_t cursor, const uint64_t count, void (*visit)(Pointer value, void* context), void* context);  // visits the next count buckets, returns the cursor to continue from (0: over), restarts after a rehash
 
 // provided hash functions
 unsigned int hash_int1(Pointer);     // hashes an integer (1)
@@ -152,16 +248,41 @@ unsigned int hash_int3(Pointer);     // hashes an integer (3)
 unsigned int hash_string1(Pointer);  // hashes a string (1)
 unsigned int hash_string2(Pointer);  // hashes a string (2)
 unsigned int hash_string3(Pointer);  // hashes a string (3)
+unsigned int hash_int4(Pointer);     // hashes an integer (seeded, wyhash)
+unsigned int hash_string4(Pointer);  // hashes a string (seeded, word-at-a-time wyhash)
+uint64_t hash_int64(Pointer);        // 64-bit version of hash_int4
+uint64_t hash_string64(Pointer);     // 64-bit version of hash_string4
+uint64_t hash_bytes(const void* data, size_t len, uint64_t seed);  // hashes len bytes with the given seed (64-bit)
+void hash_set_seed(uint64_t);        // sets the seed of the seeded hash functions (randomize it against hash flooding)
+uint64_t hash_get_seed(void);        // returns the seed of the seeded hash functions
 
 
 // BLOOM FILTER
 // -requires an array of hash functions
 bloom_filter bf_create(const uint32_t, HashFunc*, const uint8_t);  // creates bloom filter (number of elements, hash functions, number of hash functions)
+bloom_filter bf_create64(const uint64_t, HashFunc64*, const uint8_t);  // creates bloom filter with 64-bit hash functions
 void bf_insert(const bloom_filter, const Pointer);                 // inserts value at the bloom filter
 bool bf_exists(const bloom_filter, const Pointer);                 // returns true if value exists (possibly falsely) in the bloom filter, false otherwise
 void bf_destroy(bloom_filter);                               // destroys the memory used by the bloom filter
 
 
+// STRING POOL
+// -the handles (const char*) and ids of equal strings are equal, both remain valid until the pool is destroyed
+StringPool sp_create(void);                                               // creates string pool
+const char* sp_intern(const StringPool, const char* str);                 // inserts the string if it does not exist, returns its handle
+const char* sp_intern_n(const StringPool, const char* str, const uint32_t len);  // same as sp_intern, for the first len bytes of str
+uint32_t sp_intern_id(const StringPool, const char* str);                 // same as sp_intern, returns the id of the string
+const char* sp_lookup(const StringPool, const char* str);                 // returns the handle of the string, NULL if it does not exist
+const char* sp_string(const StringPool, const uint32_t id);               // returns the handle of the string with that id
+uint32_t sp_id(const char* handle);                                       // returns the id of a handle
+uint32_t sp_length(const char* handle);                                   // returns the length of a handle's string
+uint32_t sp_size(const StringPool);                                       // returns the number of strings in the pool
+uint64_t sp_memory(const StringPool);                                     // returns the bytes allocated by the pool
+void sp_destroy(const StringPool);                                        // destroys the memory used by the pool
+uint64_t sp_hash(Pointer handle);                                         // hashes a handle by its id (HashFunc64)
+int sp_compare(Pointer a, Pointer b);                                     // compares two handles by their ids (CompareFunc)
+
+
 // DIRECTED GRAPH
 // -visit function required
 dir_graph dg_create(const uint32_t, const VisitFunc);             // creates directed graph
@@ -0,0 +1,600 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+// compiled with BPT_RBT_NAMES (make RBT_IMPLEMENTATION=BPlusTree), the functions get the names of the
+// red-black tree's functions, so that the B+ tree replaces it in the programs that use only those
+#ifdef BPT_RBT_NAMES
+#define bpt_create rbt_create
+#define bpt_insert rbt_insert
+#define bpt_remove rbt_remove
+#define bpt_exists rbt_exists
+#define bpt_size rbt_size
+#define bpt_set_destroy rbt_set_destroy
+#define bpt_destroy rbt_destroy
+#define bpt_node_value rbt_node_value
+#define bpt_find_node rbt_find_node
+#define bpt_find_previous rbt_find_previous
+#define bpt_find_next rbt_find_next
+#define bpt_first rbt_first
+#define bpt_last rbt_last
+#define is_bpt_empty is_rbt_empty
+#endif
+
+#include "BPlusTree.h"
+
+// source: https://en.wikipedia.org/wiki/B%2B_tree
+
+// every node occupies NODE_SIZE bytes (8 cache lines), aligned to NODE_SIZE
+// so that a lookup touches a handful of nodes instead of one node per comparison
+#define NODE_SIZE 512
+
+// maximum number of values in a leaf and minimum before it has to be rebalanced
+#define LEAF_ORDER ((NODE_SIZE - 2*sizeof(void*) - sizeof(uint64_t)) / sizeof(Pointer))
+#define MIN_LEAF (LEAF_ORDER/2)
+
+// maximum number of children of an inner node and minimum number of keys before it has to be rebalanced
+#define INNER_ORDER ((NODE_SIZE - sizeof(uint64_t) + sizeof(Pointer)) / (2*sizeof(Pointer)))
+#define MIN_INNER ((INNER_ORDER-1)/2)
+
+// maximum number of inner levels, each inner node (but the root) has at least MIN_INNER+1 children
+#define MAX_HEIGHT 32
+
+// leaf node, holds the values in order
+typedef struct leaf
+{
+    uint64_t count;               // number of values in the leaf
+    struct leaf *prev, *next;     // neighbouring leaves, in order
+    Pointer data[LEAF_ORDER];     // values
+}
+leaf;
+
+// inner node, children[i] holds the values in [keys[i-1], keys[i])
+typedef struct inner
+{
+    uint64_t count;                // number of keys, the node has count+1 children
+    Pointer keys[INNER_ORDER-1];   // separators - the lowest value of the right subtree
+    void* children[INNER_ORDER];   // inner nodes or leaves, depending on the level
+}
+inner;
+
+struct bptree
+{
+    void* root;           // root node, NULL if the tree is empty
+    uint32_t height;      // number of inner levels above the leaves
+    leaf *first, *last;   // leaves with the lowest and highest values
+    uint64_t size;        // number of elements in the tree
+    CompareFunc compare;  // function that compares the elements - dictates the order of the elements
+    DestroyFunc destroy;  // function that destroys the elements, NULL if not
+};
+
+// a node handle points to a value inside a leaf, the leaf is found by rounding down to its alignment
+#define handle_leaf(node) ((leaf*)((uintptr_t)(node) & ~((uintptr_t)NODE_SIZE - 1)))
+#define handle_index(node) ((Pointer*)(node) - handle_leaf(node)->data)
+#define make_handle(lf, i) ((BPTreeNode)&((lf)->data[i]))
+
+// path from the root to a leaf - the inner nodes and the index of the child taken in each one of them
+typedef struct path
+{
+    inner* nodes[MAX_HEIGHT];
+    uint32_t index[MAX_HEIGHT];
+}
+path;
+
+// allocates a node aligned to NODE_SIZE
+static inline void* allocate_node(void)
+{
+    void* node = aligned_alloc(NODE_SIZE, NODE_SIZE);
+    assert(node != NULL);  // allocation failure
+
+    return node;
+}
+
+BPTree bpt_create(const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert(compare != NULL);  // a compare function needs to be given
+    assert(sizeof(leaf) <= NODE_SIZE && sizeof(inner) <= NODE_SIZE);
+
+    BPTree Tree = malloc(sizeof(struct bptree));
+    assert(Tree != NULL);  // allocation failure
+
+    Tree->root = NULL;
+    Tree->height = 0;
+    Tree->first = Tree->last = NULL;
+    Tree->size = 0;
+    Tree->compare = compare;
+    Tree->destroy = destroy;
+
+    return Tree;
+}
+
+uint64_t bpt_size(const BPTree Tree)
+{
+    assert(Tree != NULL);
+    return Tree->size;
+}
+
+bool is_bpt_empty(const BPTree Tree)
+{
+    assert(Tree != NULL);
+    return Tree->size == 0;
+}
+
+// binary search - returns the index of the first element >= value and sets found if it is equal
+static inline uint64_t lower_bound(const BPTree Tree, const Pointer* arr, const uint64_t count, const Pointer value, bool* found)
+{
+    uint64_t low = 0, high = count;
+    *found = false;
+
+    while (low < high)
+    {
+        const uint64_t mid = (low + high)/2;
+        const int comp = Tree->compare(arr[mid], value);
+
+        if (comp < 0)  // arr[mid] < value
+            low = mid+1;
+        else
+        {
+            if (comp == 0) *found = true;
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// index of the child of the inner node in which the value belongs
+static inline uint32_t child_index(const BPTree Tree, const inner* node, const Pointer value)
+{
+    bool found;
+    const uint64_t i = lower_bound(Tree, node->keys, node->count, value, &found);
+    return found ? i+1 : i;
+}
+
+// descends from the root to the leaf the value belongs to, saving the path if one is given
+static inline leaf* find_leaf(const BPTree Tree, const Pointer value, path* p)
+{
+    void* node = Tree->root;
+    for (uint32_t level = 0; level < Tree->height; level++)
+    {
+        const uint32_t i = child_index(Tree, node, value);
+        if (p != NULL)
+        {
+            p->nodes[level] = node;
+            p->index[level] = i;
+        }
+        node = ((inner*)node)->children[i];
+    }
+    return node;
+}
+
+BPTreeNode bpt_find_node(const BPTree Tree, const Pointer value)
+{
+    assert(Tree != NULL);
+
+    if (Tree->size == 0) return NULL;
+
+    leaf* lf = find_leaf(Tree, value, NULL);
+
+    bool found;
+    const uint64_t i = lower_bound(Tree, lf->data, lf->count, value, &found);
+    return found ? make_handle(lf, i) : NULL;
+}
+
+bool bpt_exists(const BPTree Tree, const Pointer value)
+{
+    return bpt_find_node(Tree, value) != NULL;
+}
+
+Pointer bpt_node_value(const BPTreeNode node)
+{
+    assert(node != NULL);
+    return *((Pointer*)node);
+}
+
+// inserts the key and its right child at the inner nodes of the path, splitting them as needed
+static void insert_in_parent(const BPTree Tree, path* p, Pointer key, void* right_child)
+{
+    for (int64_t level = (int64_t)Tree->height-1; level >= 0; level--)
+    {
+        inner* node = p->nodes[level];
+        const uint32_t pos = p->index[level];
+
+        if (node->count < INNER_ORDER-1)  // there is space, insert
+        {
+            memmove(node->keys+pos+1, node->keys+pos, (node->count-pos) * sizeof(Pointer));
+            memmove(node->children+pos+2, node->children+pos+1, (node->count-pos) * sizeof(void*));
+            node->keys[pos] = key;
+            node->children[pos+1] = right_child;
+            node->count++;
+            return;
+        }
+
+        // node is full, split it - first gather all keys and children in order
+        Pointer keys[INNER_ORDER];
+        void* children[INNER_ORDER+1];
+
+        memcpy(keys, node->keys, pos * sizeof(Pointer));
+        keys[pos] = key;
+        memcpy(keys+pos+1, node->keys+pos, (node->count-pos) * sizeof(Pointer));
+
+        memcpy(children, node->children, (pos+1) * sizeof(void*));
+        children[pos+1] = right_child;
+        memcpy(children+pos+2, node->children+pos+1, (node->count-pos) * sizeof(void*));
+
+        // the left half stays at the node, the middle key moves up and the right half goes to a new node
+        const uint64_t total = INNER_ORDER, mid = total/2;
+        inner* new_node = allocate_node();
+
+        node->count = mid;
+        memcpy(node->keys, keys, mid * sizeof(Pointer));
+        memcpy(node->children, children, (mid+1) * sizeof(void*));
+
+        new_node->count = total-mid-1;
+        memcpy(new_node->keys, keys+mid+1, new_node->count * sizeof(Pointer));
+        memcpy(new_node->children, children+mid+1, (new_node->count+1) * sizeof(void*));
+
+        key = keys[mid];
+        right_child = new_node;
+    }
+
+    // the root was split, the tree grows by one level
+    assert(Tree->height < MAX_HEIGHT);
+
+    inner* new_root = allocate_node();
+    new_root->count = 1;
+    new_root->keys[0] = key;
+    new_root->children[0] = Tree->root;
+    new_root->children[1] = right_child;
+
+    Tree->root = new_root;
+    Tree->height++;
+}
+
+bool bpt_insert(const BPTree Tree, const Pointer value)
+{
+    assert(Tree != NULL);
+
+    if (Tree->root == NULL)  // empty tree
+    {
+        leaf* lf = allocate_node();
+        lf->count = 1;
+        lf->prev = lf->next = NULL;
+        lf->data[0] = value;
+
+        Tree->root = Tree->first = Tree->last = lf;
+        Tree->size = 1;
+        return true;
+    }
+
+    path p;
+    leaf* lf = find_leaf(Tree, value, &p);
+
+    bool found;
+    const uint64_t pos = lower_bound(Tree, lf->data, lf->count, value, &found);
+    if (found)  // value already exists
+    {
+        // if a destroy function exists, destroy the value
+        if (Tree->destroy != NULL)
+            Tree->destroy(value);
+
+        return false;
+    }
+
+    Tree->size++;  // value will be inserted, increment the number of elements in the tree
+
+    if (lf->count < LEAF_ORDER)  // there is space in the leaf, insert
+    {
+        memmove(lf->data+pos+1, lf->data+pos, (lf->count-pos) * sizeof(Pointer));
+        lf->data[pos] = value;
+        lf->count++;
+        return true;
+    }
+
+    // leaf is full, split it in half
+    leaf* new_leaf = allocate_node();
+    const uint64_t mid = (LEAF_ORDER+1)/2;  // number of values that stay at the left leaf
+
+    if (pos < mid)  // value goes to the left leaf
+    {
+        new_leaf->count = LEAF_ORDER-(mid-1);
+        memcpy(new_leaf->data, lf->data+mid-1, new_leaf->count * sizeof(Pointer));
+        memmove(lf->data+pos+1, lf->data+pos, (mid-1-pos) * sizeof(Pointer));
+        lf->data[pos] = value;
+    }
+    else  // value goes to the right leaf
+    {
+        new_leaf->count = LEAF_ORDER-mid+1;
+        memcpy(new_leaf->data, lf->data+mid, (pos-mid) * sizeof(Pointer));
+        new_leaf->data[pos-mid] = value;
+        memcpy(new_leaf->data+pos-mid+1, lf->data+pos, (LEAF_ORDER-pos) * sizeof(Pointer));
+    }
+    lf->count = mid;
+
+    // link the new leaf after the old one
+    new_leaf->prev = lf;
+    new_leaf->next = lf->next;
+    if (lf->next != NULL)
+        lf->next->prev = new_leaf;
+    else
+        Tree->last = new_leaf;
+    lf->next = new_leaf;
+
+    insert_in_parent(Tree, &p, new_leaf->data[0], new_leaf);
+    return true;
+}
+
+// removes the key at index pos and the child right of it from the inner node
+static inline void inner_remove_at(inner* node, const uint64_t pos)
+{
+    memmove(node->keys+pos, node->keys+pos+1, (node->count-pos-1) * sizeof(Pointer));
+    memmove(node->children+pos+1, node->children+pos+2, (node->count-pos-1) * sizeof(void*));
+    node->count--;
+}
+
+// rebalances the inner nodes of the path, from the given level up to the root
+static void rebalance_inner(const BPTree Tree, path* p, int64_t level)
+{
+    for (; level > 0; level--)
+    {
+        inner* node = p->nodes[level];
+        if (node->count >= MIN_INNER)  // no underflow
+            return;
+
+        inner* parent = p->nodes[level-1];
+        const uint32_t i = p->index[level-1];
+        inner* left = i > 0 ? parent->children[i-1] : NULL;
+        inner* right = i < parent->count ? parent->children[i+1] : NULL;
+
+        if (left != NULL && left->count > MIN_INNER)  // borrow from the left sibling, through the parent
+        {
+            memmove(node->keys+1, node->keys, node->count * sizeof(Pointer));
+            memmove(node->children+1, node->children, (node->count+1) * sizeof(void*));
+            node->keys[0] = parent->keys[i-1];
+            node->children[0] = left->children[left->count];
+            node->count++;
+
+            parent->keys[i-1] = left->keys[--(left->count)];
+            return;
+        }
+        if (right != NULL && right->count > MIN_INNER)  // borrow from the right sibling, through the parent
+        {
+            node->keys[node->count] = parent->keys[i];
+            node->children[node->count+1] = right->children[0];
+            node->count++;
+
+            parent->keys[i] = right->keys[0];
+            memmove(right->keys, right->keys+1, (right->count-1) * sizeof(Pointer));
+            memmove(right->children, right->children+1, right->count * sizeof(void*));
+            right->count--;
+            return;
+        }
+
+        // merge with a sibling, the separator moves down between them
+        uint64_t sep = i;
+        if (left != NULL)
+        {
+            right = node;
+            sep = i-1;
+        }
+        else
+            left = node;
+
+        left->keys[left->count] = parent->keys[sep];
+        memcpy(left->keys+left->count+1, right->keys, right->count * sizeof(Pointer));
+        memcpy(left->children+left->count+1, right->children, (right->count+1) * sizeof(void*));
+        left->count += right->count+1;
+        free(right);
+
+        inner_remove_at(parent, sep);
+    }
+
+    // the root has only one child left, the tree shrinks by one level
+    inner* root = Tree->root;
+    if (Tree->height > 0 && root->count == 0)
+    {
+        Tree->root = root->children[0];
+        Tree->height--;
+        free(root);
+    }
+}
+
+// rebalances a leaf that underflowed
+static void rebalance_leaf(const BPTree Tree, path* p, leaf* lf)
+{
+    if (Tree->height == 0)  // leaf is the root
+    {
+        if (lf->count == 0)  // tree is now empty
+        {
+            free(lf);
+            Tree->root = Tree->first = Tree->last = NULL;
+        }
+        return;
+    }
+    if (lf->count >= MIN_LEAF)  // no underflow
+        return;
+
+    inner* parent = p->nodes[Tree->height-1];
+    const uint32_t i = p->index[Tree->height-1];
+    leaf* left = i > 0 ? parent->children[i-1] : NULL;
+    leaf* right = i < parent->count ? parent->children[i+1] : NULL;
+
+    if (left != NULL && left->count > MIN_LEAF)  // borrow the highest value of the left sibling
+    {
+        memmove(lf->data+1, lf->data, lf->count * sizeof(Pointer));
+        lf->data[0] = left->data[--(left->count)];
+        lf->count++;
+        parent->keys[i-1] = lf->data[0];
+        return;
+    }
+    if (right != NULL && right->count > MIN_LEAF)  // borrow the lowest value of the right sibling
+    {
+        lf->data[(lf->count)++] = right->data[0];
+        memmove(right->data, right->data+1, (--(right->count)) * sizeof(Pointer));
+        parent->keys[i] = right->data[0];
+        return;
+    }
+
+    // merge with a sibling
+    uint64_t sep = i;
+    if (left != NULL)
+    {
+        right = lf;
+        sep = i-1;
+    }
+    else
+        left = lf;
+
+    memcpy(left->data+left->count, right->data, right->count * sizeof(Pointer));
+    left->count += right->count;
+
+    left->next = right->next;
+    if (right->next != NULL)
+        right->next->prev = left;
+    else
+        Tree->last = left;
+    free(right);
+
+    inner_remove_at(parent, sep);
+    rebalance_inner(Tree, p, Tree->height-1);
+}
+
+bool bpt_remove(const BPTree Tree, const Pointer value)
+{
+    assert(Tree != NULL);
+
+    if (Tree->size == 0) return false;
+
+    path p;
+    leaf* lf = find_leaf(Tree, value, &p);
+
+    bool found;
+    const uint64_t pos = lower_bound(Tree, lf->data, lf->count, value, &found);
+    if (!found)  // value does not exist
+        return false;
+
+    Pointer data = lf->data[pos];
+    memmove(lf->data+pos, lf->data+pos+1, (lf->count-pos-1) * sizeof(Pointer));
+    lf->count--;
+
+    rebalance_leaf(Tree, &p, lf);
+
+    // the removed value might still be used as a separator by one of the inner nodes (on its path),
+    // replace it with the lowest value of the subtree at its right before the data is destroyed
+    void* node = Tree->root;
+    for (uint32_t level = 0; level < Tree->height; level++)
+    {
+        bool is_key;
+        inner* in = node;
+        const uint64_t i = lower_bound(Tree, in->keys, in->count, value, &is_key);
+
+        if (is_key)
+        {
+            void* min = in->children[i+1];
+            for (uint32_t l = level+1; l < Tree->height; l++)
+                min = ((inner*)min)->children[0];
+
+            in->keys[i] = ((leaf*)min)->data[0];
+            break;
+        }
+        node = in->children[i];
+    }
+
+    // if a destroy function exists, destroy the value
+    if (Tree->destroy != NULL)
+        Tree->destroy(data);
+
+    Tree->size--;  // value removed, decrement the number of elements in the tree
+    return true;
+}
+
+BPTreeNode bpt_find_previous(const BPTreeNode target)
+{
+    assert(target != NULL);
+
+    leaf* lf = handle_leaf(target);
+    const uint64_t i = handle_index(target);
+
+    if (i > 0)
+        return make_handle(lf, i-1);
+
+    // previous value is the highest of the previous leaf
+    return lf->prev != NULL ? make_handle(lf->prev, lf->prev->count-1) : NULL;
+}
+
+BPTreeNode bpt_find_next(const BPTreeNode target)
+{
+    assert(target != NULL);
+
+    leaf* lf = handle_leaf(target);
+    const uint64_t i = handle_index(target);
+
+    if (i+1 < lf->count)
+        return make_handle(lf, i+1);
+
+    // next value is the lowest of the next leaf
+    return lf->next != NULL ? make_handle(lf->next, 0) : NULL;
+}
+
+BPTreeNode bpt_first(const BPTree Tree)
+{
+    assert(Tree != NULL);
+
+    if (Tree->size == 0) return NULL;
+
+    return make_handle(Tree->first, 0);
+}
+
+BPTreeNode bpt_last(const BPTree Tree)
+{
+    assert(Tree != NULL);
+
+    if (Tree->size == 0) return NULL;
+
+    return make_handle(Tree->last, Tree->last->count-1);
+}
+
+DestroyFunc bpt_set_destroy(const BPTree Tree, const DestroyFunc new_destroy_func)
+{
+    assert(Tree != NULL);
+
+    DestroyFunc old_destroy_func = Tree->destroy;
+    Tree->destroy = new_destroy_func;
+    return old_destroy_func;
+}
+
+// destroys the inner nodes of the subtree (the leaves are destroyed separately)
+static void destroy_inner(inner* node, const uint32_t levels)
+{
+    if (levels == 0)  // base case - children are leaves
+        return;
+
+    for (uint64_t i = 0; i <= node->count; i++)
+        destroy_inner(node->children[i], levels-1);
+
+    free(node);
+}
+
+void bpt_destroy(const BPTree Tree)
+{
+    assert(Tree != NULL);
+
+    if (Tree->root != NULL)
+        destroy_inner(Tree->root, Tree->height);
+
+    // destroy the leaves and their data, if a destroy function is given
+    leaf* lf = Tree->first;
+    while (lf != NULL)
+    {
+        leaf* next = lf->next;
+        if (Tree->destroy != NULL)
+        {
+            for (uint64_t i = 0; i < lf->count; i++)
+                Tree->destroy(lf->data[i]);
+        }
+        free(lf);
+        lf = next;
+    }
+
+    free(Tree);
+}
@@ -0,0 +1,70 @@
+#pragma once  // include at most once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+typedef void* Pointer;
+
+// Pointer to function that compares 2 elements a and b and returns:
+// < 0  if a < b
+//   0  if a and b are equal
+// > 0  if a > b
+typedef int (*CompareFunc)(Pointer a, Pointer b);
+
+// Pointer to function that destroys an element value
+typedef void (*DestroyFunc)(Pointer value);
+
+typedef struct bptree* BPTree;
+
+
+// creates B+ tree
+// -requires a compare function
+//           a destroy function (or NULL if you want to preserve the data)
+BPTree bpt_create(const CompareFunc, const DestroyFunc);
+
+// returns true if the item is inserted, in any other case false
+bool bpt_insert(const BPTree, const Pointer);
+
+// returns true if the item is deleted, in any other case false
+bool bpt_remove(const BPTree, const Pointer);
+
+// returns true if the value exists, false otherwise
+bool bpt_exists(const BPTree, const Pointer);
+
+// returns the size of the tree
+uint64_t bpt_size(const BPTree);
+
+// returns true if the tree is empty, false otherwise
+bool is_bpt_empty(const BPTree);
+
+// changes the destroy function and returns the old one
+DestroyFunc bpt_set_destroy(const BPTree, const DestroyFunc);
+
+// destroys the memory used by the tree
+void bpt_destroy(const BPTree);
+
+//////////////////////////////
+// tree traversal functions //
+//////////////////////////////
+// node handles point inside the leaves of the tree, so unlike the red-black tree's
+// they are invalidated by any insertion or removal
+typedef struct bpt_entry* BPTreeNode;  // node handle
+
+// returns the value of the node
+Pointer bpt_node_value(const BPTreeNode);
+
+// returns the node with that value, if it exists, otherwise NULL
+BPTreeNode bpt_find_node(const BPTree, const Pointer);
+
+// returns the previous, in order, node of target or NULL if there is no previous value
+BPTreeNode bpt_find_previous(const BPTreeNode);
+
+// returns the next, in order, node of target or NULL if there is no next value
+BPTreeNode bpt_find_next(const BPTreeNode);
+
+// returns the node with the lowest value
+BPTreeNode bpt_first(const BPTree);
+
+// returns the node with the highest value
+BPTreeNode bpt_last(const BPTree);
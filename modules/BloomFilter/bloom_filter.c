@@ -6,42 +6,62 @@
 typedef struct bfilter
 {
     uint8_t* bit_array;  // bit array
-    uint32_t size;       // size of the bit array
+    uint64_t size;       // size of the bit array
     HashFunc* hash;      // array of hash functions
+    HashFunc64* hash64;  // array of 64-bit hash functions, used instead of hash if given
     uint8_t hash_count;  // number of hash functions
 }
 bfilter;
 
-#define create_mask(x) (1 << x)
-#define get_index(x) (x / sizeof(uint8_t))
-#define get_bit(x) (x % sizeof(uint8_t))
+// every byte of the bit array holds 8 bits
+#define create_mask(x) ((uint8_t)1 << (x))
+#define get_index(x) ((x) / 8)
+#define get_bit(x) ((x) % 8)
 
-bloom_filter bf_create(const uint32_t max_capacity, HashFunc* hash, const uint8_t hash_count)
+// creates the bloom filter with the hash functions, or the 64-bit ones, that are given
+static bloom_filter create(const uint64_t max_capacity, HashFunc* hash, HashFunc64* hash64, const uint8_t hash_count)
 {
-    assert(hash != NULL);
-
     bloom_filter bf = malloc(sizeof(bfilter));
     assert(bf != NULL);
 
     bf->size = hash_count*max_capacity;  // size of the bit array
 
-    bf->bit_array = calloc(sizeof(uint8_t), bf->size/sizeof(uint8_t)+1);
+    bf->bit_array = calloc(sizeof(uint8_t), bf->size/8 + 1);
     assert(bf->bit_array != NULL);
 
     bf->hash_count = hash_count;
     bf->hash = hash;
+    bf->hash64 = hash64;
 
     return bf;
 }
 
-static inline void set_bit(bloom_filter bf, const uint32_t hash_value)
+bloom_filter bf_create(const uint32_t max_capacity, HashFunc* hash, const uint8_t hash_count)
+{
+    assert(hash != NULL);
+    return create(max_capacity, hash, NULL, hash_count);
+}
+
+bloom_filter bf_create64(const uint64_t max_capacity, HashFunc64* hash, const uint8_t hash_count)
+{
+    assert(hash != NULL);
+    return create(max_capacity, NULL, hash, hash_count);
+}
+
+// the position of the value in the bit array, according to the i-th hash function
+static inline uint64_t get_position(const bloom_filter bf, const uint8_t i, const Pointer value)
+{
+    return (bf->hash64 != NULL ? bf->hash64[i](value) : bf->hash[i](value)) % bf->size;
+}
+
+static inline void set_bit(bloom_filter bf, const uint64_t hash_value)
 {
     bf->bit_array[get_index(hash_value)] |= create_mask(get_bit(hash_value));
 }
 
-static inline bool bit_exists(bloom_filter bf, const uint32_t hash_value)
+static inline bool bit_exists(bloom_filter bf, const uint64_t hash_value)
 {
-    return bf->bit_array[get_index(hash_value)] & create_mask(get_bit(hash_value)) != 0;
+    return (bf->bit_array[get_index(hash_value)] & create_mask(get_bit(hash_value))) != 0;
 }
 
 void bf_insert(const bloom_filter bf, const Pointer value)
@@ -50,7 +70,7 @@ void bf_insert(const bloom_filter bf, const Pointer value)
 
     // for every hash function, hash the value and set the bit
     for (uint8_t i = 0; i < bf->hash_count; i++)
-        set_bit(bf, bf->hash[i](value) % bf->size);
+        set_bit(bf, get_position(bf, i, value));
 }
 
 bool bf_exists(const bloom_filter bf, const Pointer value)
@@ -60,7 +80,7 @@ bool bf_exists(const bloom_filter bf, const Pointer value)
     // hash the value and check if the bit is set
     for (uint8_t i = 0; i < bf->hash_count; i++)
     {
-        if (!bit_exists(bf, bf->hash[i](value) % bf->size))
+        if (!bit_exists(bf, get_position(bf, i, value)))
             return false;
     }
 
@@ -8,12 +8,19 @@ typedef void* Pointer;
 // Pointer to function that hashes a value to a positive (unsigned) integer
 typedef unsigned int (*HashFunc)(Pointer value);
 
+// Pointer to function that hashes a value to a 64-bit (unsigned) integer
+typedef uint64_t (*HashFunc64)(Pointer value);
+
 typedef struct bfilter* bloom_filter;
 
 // creates bloom filter
 // -requires an array of hash functions
 bloom_filter bf_create(const uint32_t, HashFunc*, const uint8_t);
 
+// creates bloom filter with 64-bit hash functions (eg. hash_int64, hash_string64)
+// the positions are computed from the whole 64-bit hash values, so large filters keep a uniform distribution
+bloom_filter bf_create64(const uint64_t, HashFunc64*, const uint8_t);
+
 // inserts value at the bloom filter
 void bf_insert(const bloom_filter, const Pointer);
 
@@ -0,0 +1,817 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "hash_table.h"
+
+// when max load factor is exceeded, rehashing operation occurs
+// (with 2 buckets of 4 slots for every value, insertions rarely fail before ~95%)
+#define MAX_LOAD_FACTOR 0.9
+
+// number of values the batch operations process together
+#define BATCH_SIZE 16
+
+// initial number of buckets (a power of 2)
+#define MIN_CAPACITY 8
+
+// number of slots of a bucket, so that a bucket fills a cache line
+#define SLOTS 4
+#define CACHE_LINE 64
+
+// the search for a free slot moves at most MAX_PATH elements and checks at most BFS_SIZE buckets
+#define MAX_PATH 5
+#define BFS_SIZE 512
+
+// the stash doubles up to MAX_STASH buckets, then a full stash makes the table rehash with a new seed instead
+#define MAX_STASH 8
+
+// returned by the searches when the value (or a free slot) is not found
+#define NOT_FOUND UINT64_MAX
+
+// bucket
+typedef struct bucket
+{
+    uint64_t hash_values[SLOTS];  // hash values of the data, 0 if the slot is empty
+    Pointer data[SLOTS];          // pointers to the data we are storing
+}
+__attribute__((aligned(CACHE_LINE))) bucket;
+
+typedef struct hash_table
+{
+    bucket* buckets;      // buckets storing the data
+    Pointer* values;      // values of the slots' data in map mode (NULL if not a map)
+    uint64_t capacity;    // the number of buckets (not counting the stash) - a power of 2
+    uint8_t shift;        // 64 - log2(capacity), used to find the first bucket of a value
+    bucket* stash;        // buckets storing the elements that did not fit in their buckets
+    Pointer* stash_values;  // values of the stash's data in map mode
+    uint64_t stash_size;  // number of buckets of the stash - a power of 2
+    uint64_t stashed;     // number of elements in the stash
+    uint64_t seed;        // mixed into the hash values, changes when the stash overflows
+    uint64_t reseeded;    // the size of the stash when the seed last changed, 0 if it has not changed since the table grew
+    uint64_t elements;    // number of elements currently stored in the hash table
+    HashFunc hash;        // function that hashes an element into a positive integer
+    HashFunc64 hash64;    // function that hashes an element into a 64-bit integer, used instead of hash if given
+    CompareFunc compare;  // function that compares the elements
+    DestroyFunc destroy;  // function that destroys the elements, NULL if not
+    DestroyFunc destroy_value;  // function that destroys the values in map mode, NULL if not
+    uint64_t rehashes;    // number of rehashes
+    uint64_t lookups;     // number of searches (counted with HT_PROBE_STATS)
+    uint64_t probes;      // number of buckets checked by the searches (counted with HT_PROBE_STATS)
+}
+hash_table;
+
+// mixes the hash value (murmur3's 64-bit finalizer) with the seed, so that both of its buckets depend on all of its bits
+// 0 marks the empty slots, so it becomes 1
+static inline uint64_t mix(uint64_t h, const uint64_t seed)
+{
+    h ^= seed;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h + (h == 0);
+}
+
+// the mixed hash value of an element
+#define hash_of(ht, value) mix((ht)->hash64 != NULL ? (ht)->hash64(value) : (uint64_t)(ht)->hash(value), (ht)->seed)
+
+// the two buckets of a (mixed) hash value: the first one is given by its high bits, the second one by its low bits
+// (the lowest bit is set, so that the two buckets are always different)
+// both are in the same block of BLOCK buckets, so the elements only move within their block (see hash_scan), while
+// a block is large enough for the loads of the blocks to be almost equal
+#define BLOCK 1024
+#define bucket1(ht, h) ((h) >> (ht)->shift)
+#define bucket2(ht, h) (bucket1(ht, h) ^ (((h) | 1) & (BLOCK - 1) & ((ht)->capacity - 1)))
+
+// the bucket, of the two, where the element of bucket b can move to
+#define other_bucket(ht, h, b) (bucket1(ht, h) == (b) ? bucket2(ht, h) : bucket1(ht, h))
+
+// the stash stores the elements that did not fit in their buckets, its slots are numbered after the rest
+// it is a single bucket, unless many elements have the same buckets (bad hash function), then it grows
+#define stash_start(ht) ((ht)->capacity * SLOTS)
+#define stash_end(ht) (((ht)->capacity + (ht)->stash_size) * SLOTS)
+
+// the slots are numbered as bucket * SLOTS + slot, which is also the index of their value in map mode
+#define slot_bucket(ht, pos) \
+    ((pos) < stash_start(ht) ? (ht)->buckets + (pos) / SLOTS : (ht)->stash + ((pos) - stash_start(ht)) / SLOTS)
+#define slot_hash(ht, pos) (slot_bucket(ht, pos)->hash_values[(pos) % SLOTS])
+#define slot_data(ht, pos) (slot_bucket(ht, pos)->data[(pos) % SLOTS])
+#define slot_value(ht, pos) \
+    ((pos) < stash_start(ht) ? (ht)->values + (pos) : (ht)->stash_values + ((pos) - stash_start(ht)))
+
+// counts a search that checked the given number of buckets
+#ifdef HT_PROBE_STATS
+#define count_lookup(ht, checked) ((ht)->lookups++, (ht)->probes += (checked))
+#else
+#define count_lookup(ht, checked) ((void)0)
+#endif
+
+// allocates empty buckets
+static inline bucket* allocate(const uint64_t size)
+{
+    bucket* buckets = aligned_alloc(CACHE_LINE, sizeof(bucket) * size);
+    assert(buckets != NULL);  // allocation failure
+    memset(buckets, 0, sizeof(bucket) * size);
+    return buckets;
+}
+
+// allocates the values of the buckets (and of the stash) in map mode
+static inline void allocate_values(const HashTable ht)
+{
+    ht->values = malloc(sizeof(Pointer) * ht->capacity * SLOTS);
+    assert(ht->values != NULL);  // allocation failure
+    ht->stash_values = malloc(sizeof(Pointer) * ht->stash_size * SLOTS);
+    assert(ht->stash_values != NULL);  // allocation failure
+}
+
+// allocates the buckets and the stash of the hash table
+static inline void allocate_buckets(const HashTable ht, const uint64_t capacity, const uint64_t stash_size, const bool is_map)
+{
+    ht->capacity = capacity;
+    ht->shift = 64 - __builtin_ctzll(capacity);
+    ht->stash_size = stash_size;
+    ht->stashed = 0;
+
+    ht->buckets = allocate(capacity);
+    ht->stash = allocate(stash_size);
+
+    ht->values = ht->stash_values = NULL;
+    if (is_map)
+        allocate_values(ht);
+}
+
+// doubles the stash, which is kept apart from the buckets, so only the stash is copied
+static void grow_stash(const HashTable ht)
+{
+    bucket* stash = allocate(2*ht->stash_size);
+    memcpy(stash, ht->stash, sizeof(bucket) * ht->stash_size);
+    free(ht->stash);
+    ht->stash = stash;
+
+    if (ht->values != NULL)
+    {
+        ht->stash_values = realloc(ht->stash_values, sizeof(Pointer) * 2*ht->stash_size * SLOTS);
+        assert(ht->stash_values != NULL);  // allocation failure
+    }
+    ht->stash_size *= 2;
+}
+
+// creates the hash table with the hash function, or the 64-bit one, that is given
+static HashTable create(const HashFunc hash, const HashFunc64 hash64, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert((hash != NULL || hash64 != NULL) && compare != NULL);  // a hash and compare function needs to be given
+
+    HashTable ht = malloc(sizeof(hash_table));
+    assert(ht != NULL);  // allocation failure
+
+    ht->seed = ht->reseeded = 0;
+    allocate_buckets(ht, MIN_CAPACITY, 1, false);
+
+    ht->elements = 0;
+    ht->rehashes = ht->lookups = ht->probes = 0;
+    ht->hash = hash;
+    ht->hash64 = hash64;
+    ht->compare = compare;
+    ht->destroy = destroy;
+    ht->destroy_value = NULL;
+
+    return ht;
+}
+
+HashTable hash_create(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert(hash != NULL);
+    return create(hash, NULL, compare, destroy);
+}
+
+HashTable hash_create_with_capacity(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy, const uint64_t expected)
+{
+    HashTable ht = hash_create(hash, compare, destroy);
+    hash_reserve(ht, expected);
+    ht->rehashes = 0;  // sizing the buckets of a new hash table is not a rehash
+    return ht;
+}
+
+HashTable hash_create64(const HashFunc64 hash, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert(hash != NULL);
+    return create(NULL, hash, compare, destroy);
+}
+
+// turns the hash table into a map
+static HashTable make_map(const HashTable ht, const DestroyFunc destroy_value)
+{
+    allocate_values(ht);  // allocate memory for the values
+    ht->destroy_value = destroy_value;
+
+    return ht;
+}
+
+HashTable hash_map_create(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy_key, const DestroyFunc destroy_value)
+{
+    return make_map(hash_create(hash, compare, destroy_key), destroy_value);
+}
+
+HashTable hash_map_create64(const HashFunc64 hash, const CompareFunc compare, const DestroyFunc destroy_key, const DestroyFunc destroy_value)
+{
+    return make_map(hash_create64(hash, compare, destroy_key), destroy_value);
+}
+
+uint64_t hash_size(const HashTable ht)
+{
+    assert(ht != NULL);
+    return ht->elements;
+}
+
+bool is_ht_empty(const HashTable ht)
+{
+    assert(ht != NULL);
+    return ht->elements == 0;
+}
+
+// stores the element at the slot pos
+static inline void set_slot(const HashTable ht, const uint64_t pos, const Pointer data, const uint64_t h, const Pointer value)
+{
+    bucket* b = slot_bucket(ht, pos);
+    b->hash_values[pos % SLOTS] = h;
+    b->data[pos % SLOTS] = data;
+    if (ht->values != NULL)
+        *slot_value(ht, pos) = value;
+}
+
+// moves the element of the slot from to the empty slot to
+static inline void move_slot(const HashTable ht, const uint64_t from, const uint64_t to)
+{
+    set_slot(ht, to, slot_data(ht, from), slot_hash(ht, from), ht->values != NULL ? *slot_value(ht, from) : NULL);
+    slot_hash(ht, from) = 0;
+}
+
+// returns the first empty slot of the bucket, SLOTS if it is full
+static inline uint32_t empty_slot(const bucket* b)
+{
+    for (uint32_t s = 0; s < SLOTS; s++)
+    {
+        if (b->hash_values[s] == 0)
+            return s;
+    }
+    return SLOTS;
+}
+
+// a bucket reached by the breadth-first search
+typedef struct bfs_node
+{
+    uint64_t bucket;  // the bucket
+    uint32_t parent;  // the node whose element moves to this bucket (BFS_SIZE for the value's own buckets)
+    uint8_t slot;     // the slot of the parent's bucket holding that element
+    uint8_t depth;    // number of elements that have to move for the bucket to be reached
+}
+bfs_node;
+
+// returns true if the bucket b is on the path from the value's buckets to the node
+static inline bool on_path(const bfs_node* queue, uint32_t node, const uint64_t b)
+{
+    for (; node != BFS_SIZE; node = queue[node].parent)
+    {
+        if (queue[node].bucket == b)
+            return true;
+    }
+    return false;
+}
+
+// makes room for a value in one of its buckets and returns the free slot, NOT_FOUND if there is no room
+// the elements of a full bucket can move to their other bucket, so a breadth-first search finds the bucket with
+// a free slot that the fewest moves lead to, and then the elements along the way move, starting from the last one
+static uint64_t make_room(const HashTable ht, const uint64_t h)
+{
+    bfs_node queue[BFS_SIZE];
+    uint32_t tail = 0;
+    queue[tail++] = (bfs_node){ bucket1(ht, h), BFS_SIZE, 0, 0 };
+    queue[tail++] = (bfs_node){ bucket2(ht, h), BFS_SIZE, 0, 0 };
+
+    for (uint32_t head = 0; head < tail; head++)
+    {
+        const bucket* b = ht->buckets + queue[head].bucket;
+        const uint32_t free_slot = empty_slot(b);
+        if (free_slot != SLOTS)  // free slot found, move every element of the path to the slot the next one left
+        {
+            uint64_t pos = queue[head].bucket * SLOTS + free_slot;
+            for (uint32_t i = head; queue[i].parent != BFS_SIZE; i = queue[i].parent)
+            {
+                const uint64_t from = queue[queue[i].parent].bucket * SLOTS + queue[i].slot;
+                move_slot(ht, from, pos);
+                pos = from;
+            }
+            return pos;
+        }
+        if (queue[head].depth == MAX_PATH)
+            continue;
+
+        // any element of the full bucket could move to its other bucket
+        // (the buckets of the path are not visited again, so every element moves at most once)
+        for (uint32_t s = 0; s < SLOTS && tail < BFS_SIZE; s++)
+        {
+            const uint64_t other = other_bucket(ht, b->hash_values[s], queue[head].bucket);
+            if (!on_path(queue, head, other))
+                queue[tail++] = (bfs_node){ other, head, s, queue[head].depth + 1 };
+        }
+    }
+    return NOT_FOUND;
+}
+
+// places the element at one of its buckets or, if there is no room, at the stash
+// returns its slot, NOT_FOUND if the stash is full as well
+static inline uint64_t place(const HashTable ht, const Pointer data, const uint64_t h, const Pointer value)
+{
+    uint64_t pos = make_room(ht, h);
+    for (uint64_t b = 0; pos == NOT_FOUND && b < ht->stash_size; b++)
+    {
+        const uint32_t s = empty_slot(ht->stash + b);
+        if (s != SLOTS)
+        {
+            pos = stash_start(ht) + b * SLOTS + s;
+            ht->stashed++;
+        }
+    }
+    if (pos == NOT_FOUND)  // the stash is full
+        return NOT_FOUND;
+
+    set_slot(ht, pos, data, h, value);
+    return pos;
+}
+
+// function prototype
+static void rehash(const HashTable, const uint64_t, const uint64_t, const uint64_t);
+
+// places the element, making room for it if needed, and returns its slot
+// the table grows if it is more than half full, otherwise the value's buckets are full of elements with the same
+// buckets, which more buckets may not separate, so the stash doubles, up to MAX_STASH buckets
+// then the table rehashes with a new seed, to give the elements other buckets, and the stash only grows further if
+// that did not help either (the elements have the same hash value, because of a bad hash function)
+static inline uint64_t place_or_grow(const HashTable ht, Pointer data, uint64_t h, Pointer value)
+{
+    uint64_t pos;
+    while ((pos = place(ht, data, h, value)) == NOT_FOUND)
+    {
+        const uint64_t seed = ht->seed;
+        if (ht->elements > MAX_LOAD_FACTOR * ht->capacity * SLOTS / 2)
+            rehash(ht, 2*ht->capacity, 1, ht->seed);
+        else if (ht->stash_size < MAX_STASH || ht->reseeded == ht->stash_size)
+            grow_stash(ht);
+        else
+        {
+            ht->reseeded = ht->stash_size;
+            rehash(ht, ht->capacity, ht->stash_size, mix(ht->seed, 0x9E3779B97F4A7C15ull));
+        }
+        if (ht->seed != seed)  // the hash value changes along with the seed
+            h = hash_of(ht, data);
+    }
+    return pos;
+}
+
+// moves the elements to new buckets, with a new stash of stash_size buckets, and mixes their hash values with the seed
+static void rehash(const HashTable ht, const uint64_t capacity, const uint64_t stash_size, const uint64_t seed)
+{
+    // save previous buckets, along with the stash
+    bucket* old_buckets = ht->buckets;
+    bucket* old_stash = ht->stash;
+    Pointer* old_values = ht->values;
+    Pointer* old_stash_values = ht->stash_values;
+    const uint64_t old_slots = stash_end(ht), old_start = stash_start(ht);
+
+    // the stored hash values were mixed with the old seed
+    const uint64_t old_seed = ht->seed;
+    ht->seed = seed;
+    if (capacity != ht->capacity)
+        ht->reseeded = 0;
+
+    allocate_buckets(ht, capacity, stash_size, old_values != NULL);
+    ht->rehashes++;
+
+    // start rehash operation
+    // (the table is at most half full now, so an element that does not fit makes the stash grow)
+    for (uint64_t i = 0; i < old_slots; i++)
+    {
+        const bucket* b = i < old_start ? old_buckets + i / SLOTS : old_stash + (i - old_start) / SLOTS;
+        const uint64_t h = b->hash_values[i % SLOTS];
+        if (h == 0)
+            continue;
+
+        const Pointer data = b->data[i % SLOTS];
+        const Pointer value = old_values == NULL ? NULL : (i < old_start ? old_values[i] : old_stash_values[i - old_start]);
+
+        // (the seed may also change by a rehash in between)
+        place_or_grow(ht, data, ht->seed == old_seed ? h : hash_of(ht, data), value);
+    }
+    free(old_buckets);
+    free(old_stash);
+    free(old_values);
+    free(old_stash_values);
+}
+
+// returns the slot of the bucket holding the value (its hash value is h), NOT_FOUND if the value is not there
+// (first is the number of the bucket's first slot)
+static inline uint64_t search_bucket(const HashTable ht, const bucket* bkt, const uint64_t first, const Pointer value, const uint64_t h)
+{
+    for (uint32_t s = 0; s < SLOTS; s++)
+    {
+        if (bkt->hash_values[s] == h && ht->compare(bkt->data[s], value) == 0)
+            return first + s;
+    }
+    return NOT_FOUND;
+}
+
+// returns the slot in which the value exists (its hash value is h)
+// if it does not exist, returns NOT_FOUND
+// only the value's two buckets are searched, two cache lines, and the stash if it is not empty
+static inline uint64_t find_slot(const HashTable ht, const Pointer value, const uint64_t h)
+{
+    const uint64_t b1 = bucket1(ht, h), b2 = bucket2(ht, h);
+    uint64_t pos = search_bucket(ht, ht->buckets + b1, b1 * SLOTS, value, h), checked = 1;
+    if (pos == NOT_FOUND)
+    {
+        pos = search_bucket(ht, ht->buckets + b2, b2 * SLOTS, value, h);
+        checked++;
+    }
+    for (uint64_t b = 0; pos == NOT_FOUND && ht->stashed != 0 && b < ht->stash_size; b++)
+    {
+        pos = search_bucket(ht, ht->stash + b, stash_start(ht) + b * SLOTS, value, h);
+        checked++;
+    }
+
+    count_lookup(ht, checked);
+    return pos;
+}
+
+// returns the slot holding the value, inserting it if it does not exist (and setting inserted)
+static inline uint64_t insert_slot(const HashTable ht, const Pointer value, const uint64_t h, bool* inserted)
+{
+    // check to see if value already exists in the hash table
+    uint64_t pos = find_slot(ht, value, h);
+    if (pos != NOT_FOUND)
+    {
+        *inserted = false;
+        return pos;
+    }
+
+    if ((float)(ht->elements + 1) > MAX_LOAD_FACTOR * ht->capacity * SLOTS)  // max load factor exceeded, start rehash
+        rehash(ht, 2*ht->capacity, 1, ht->seed);
+
+    pos = place_or_grow(ht, value, h, NULL);
+    ht->elements++;  // value inserted, increment the number of elements in the hash table
+
+    *inserted = true;
+    return pos;
+}
+
+// inserts the value with the given hash value, returns true if it was inserted
+static inline bool insert_hashed(const HashTable ht, const Pointer value, const uint64_t h)
+{
+    bool inserted;
+    insert_slot(ht, value, h, &inserted);
+
+    // if the value already exists and a destroy function exists, destroy the value
+    if (!inserted && ht->destroy != NULL)
+        ht->destroy(value);
+
+    return inserted;
+}
+
+bool hash_insert(const HashTable ht, const Pointer value)
+{
+    assert(ht != NULL);
+    return insert_hashed(ht, value, hash_of(ht, value));
+}
+
+Pointer* hash_map_get_or_insert(const HashTable ht, const Pointer key, bool* inserted)
+{
+    assert(ht != NULL && ht->values != NULL && inserted != NULL);
+
+    const uint64_t pos = insert_slot(ht, key, hash_of(ht, key), inserted);
+
+    // if the key already exists and a destroy function exists, destroy the key
+    if (!(*inserted) && ht->destroy != NULL)
+        ht->destroy(key);
+
+    return slot_value(ht, pos);
+}
+
+bool hash_map_put(const HashTable ht, const Pointer key, const Pointer value)
+{
+    bool inserted;
+    Pointer* slot = hash_map_get_or_insert(ht, key, &inserted);
+
+    // the key already exists, destroy its old value
+    if (!inserted && ht->destroy_value != NULL && *slot != value)
+        ht->destroy_value(*slot);
+
+    *slot = value;
+    return inserted;
+}
+
+// moves an element of the stash, that belongs to the bucket of the empty slot pos, there
+static inline void unstash(const HashTable ht, const uint64_t pos)
+{
+    for (uint64_t i = stash_start(ht); i < stash_end(ht); i++)
+    {
+        const uint64_t h = slot_hash(ht, i);
+        if (h != 0 && (bucket1(ht, h) == pos / SLOTS || bucket2(ht, h) == pos / SLOTS))
+        {
+            move_slot(ht, i, pos);
+            ht->stashed--;
+            return;
+        }
+    }
+}
+
+bool hash_remove(const HashTable ht, const Pointer value)
+{
+    if (is_ht_empty(ht))  // empty hash table - nothing to remove
+        return false;
+
+    // find the potential slot the value exists in
+    const uint64_t pos = find_slot(ht, value, hash_of(ht, value));
+    if (pos == NOT_FOUND)  // value does not exist
+        return false;
+
+    // destroy the data, if a destroy function is given
+    if (ht->destroy != NULL)
+        ht->destroy(slot_data(ht, pos));
+    if (ht->values != NULL && ht->destroy_value != NULL)
+        ht->destroy_value(*slot_value(ht, pos));
+
+    slot_hash(ht, pos) = 0;  // mark the slot as empty
+    slot_data(ht, pos) = NULL;
+    ht->elements--;  // value removed, decrement the number of elements in the hash table
+
+    if (pos >= stash_start(ht))  // the value was stashed
+        ht->stashed--;
+    else if (ht->stashed != 0)  // a stashed element may fit in the slot
+        unstash(ht, pos);
+    return true;
+}
+
+Pointer* hash_map_get(const HashTable ht, const Pointer key)
+{
+    assert(ht != NULL && ht->values != NULL);
+
+    if (is_ht_empty(ht))  // hash table is empty, nothing to search
+        return NULL;
+
+    const uint64_t pos = find_slot(ht, key, hash_of(ht, key));
+    return pos != NOT_FOUND ? slot_value(ht, pos) : NULL;
+}
+
+bool hash_exists(const HashTable ht, const Pointer value)
+{
+    if (is_ht_empty(ht))  // hash table is empty, nothing to search
+        return false;
+
+    return find_slot(ht, value, hash_of(ht, value)) != NOT_FOUND;
+}
+
+Pointer hash_find(const HashTable ht, const Pointer value)
+{
+    if (is_ht_empty(ht))  // hash table is empty, nothing to search
+        return NULL;
+
+    const uint64_t pos = find_slot(ht, value, hash_of(ht, value));
+    return pos != NOT_FOUND ? slot_data(ht, pos) : NULL;
+}
+
+// a single hash for both the search and the insertion
+bool hash_get_or_insert(const HashTable ht, const Pointer value, Pointer* existing)
+{
+    assert(ht != NULL && existing != NULL);
+
+    bool inserted;
+    const uint64_t pos = insert_slot(ht, value, hash_of(ht, value), &inserted);
+    *existing = slot_data(ht, pos);
+    return inserted;
+}
+
+// sets bit i of the result bitmap (if given) to b
+static inline void set_result(uint64_t* result, const uint64_t i, const bool b)
+{
+    if (result == NULL) return;
+
+    const uint64_t mask = (uint64_t)1 << (i % 64);
+    result[i / 64] = b ? (result[i / 64] | mask) : (result[i / 64] & ~mask);
+}
+
+// computes the hash values of the values [start, end) and prefetches both buckets of each
+static inline void prefetch_batch(const HashTable ht, const Pointer* values, const uint64_t start, const uint64_t end, uint64_t* hashes)
+{
+    for (uint64_t i = start; i < end; i++)
+    {
+        hashes[i - start] = hash_of(ht, values[i]);
+        __builtin_prefetch(ht->buckets + bucket1(ht, hashes[i - start]));
+        __builtin_prefetch(ht->buckets + bucket2(ht, hashes[i - start]));
+    }
+}
+
+uint64_t hash_exists_many(const HashTable ht, const Pointer* values, const uint64_t n, uint64_t* result)
+{
+    assert(ht != NULL && (values != NULL || n == 0));
+
+    uint64_t found = 0;
+    uint64_t hashes[BATCH_SIZE];
+    for (uint64_t start = 0; start < n; start += BATCH_SIZE)
+    {
+        const uint64_t end = start + BATCH_SIZE < n ? start + BATCH_SIZE : n;
+        prefetch_batch(ht, values, start, end, hashes);
+
+        for (uint64_t i = start; i < end; i++)
+        {
+            const bool exists = !is_ht_empty(ht) && find_slot(ht, values[i], hashes[i - start]) != NOT_FOUND;
+            set_result(result, i, exists);
+            found += exists;
+        }
+    }
+    return found;
+}
+
+uint64_t hash_insert_many(const HashTable ht, const Pointer* values, const uint64_t n, uint64_t* result)
+{
+    assert(ht != NULL && (values != NULL || n == 0));
+
+    uint64_t inserted = 0;
+    uint64_t hashes[BATCH_SIZE];
+    for (uint64_t start = 0; start < n; start += BATCH_SIZE)
+    {
+        const uint64_t end = start + BATCH_SIZE < n ? start + BATCH_SIZE : n;
+        prefetch_batch(ht, values, start, end, hashes);
+
+        // an insertion of the batch may change the seed, and with it the hash values of the rest
+        const uint64_t seed = ht->seed;
+        for (uint64_t i = start; i < end; i++)
+        {
+            const bool ins = insert_hashed(ht, values[i], ht->seed == seed ? hashes[i - start] : hash_of(ht, values[i]));
+            set_result(result, i, ins);
+            inserted += ins;
+        }
+    }
+    return inserted;
+}
+
+void hash_compact(const HashTable ht)
+{
+    assert(ht != NULL);
+
+    // take every element out of the stash and place it again, it returns there only if its buckets are still full
+    for (uint64_t pos = stash_start(ht); pos < stash_end(ht) && ht->stashed != 0; pos++)
+    {
+        const uint64_t h = slot_hash(ht, pos);
+        if (h == 0)
+            continue;
+
+        slot_hash(ht, pos) = 0;
+        ht->stashed--;
+        place(ht, slot_data(ht, pos), h, ht->values != NULL ? *slot_value(ht, pos) : NULL);
+    }
+}
+
+void hash_reserve(const HashTable ht, const uint64_t n)
+{
+    assert(ht != NULL);
+
+    // the smallest number of buckets that holds n elements within the max load factor
+    uint64_t capacity = MIN_CAPACITY;
+    while (n > MAX_LOAD_FACTOR * capacity * SLOTS)
+        capacity *= 2;
+
+    if (capacity > ht->capacity)
+        rehash(ht, capacity, 1, ht->seed);
+}
+
+DestroyFunc hash_set_destroy(const HashTable ht, const DestroyFunc new_destroy_func)
+{
+    assert(ht != NULL);
+
+    DestroyFunc old_destroy_func = ht->destroy;
+    ht->destroy = new_destroy_func;
+    return old_destroy_func;
+}
+
+void hash_stats(const HashTable ht, struct ht_stats* stats)
+{
+    assert(ht != NULL && stats != NULL);
+    memset(stats, 0, sizeof(struct ht_stats));
+
+    const uint64_t slots = ht->capacity * SLOTS;
+    stats->elements = ht->elements;
+    stats->buckets = slots;
+    stats->load_factor = (double)ht->elements / slots;
+    stats->bytes = sizeof(hash_table) + (ht->capacity + ht->stash_size) * (sizeof(bucket) + (ht->values != NULL ? SLOTS * sizeof(Pointer) : 0));
+    stats->rehashes = ht->rehashes;
+    stats->lookups = ht->lookups;
+    stats->probes = ht->probes;
+
+    // an element is found with 1 probe at its first bucket, 2 at its second one and 3 or more at the stash
+    for (uint64_t pos = 0; pos < stash_end(ht); pos++)
+    {
+        const uint64_t h = slot_hash(ht, pos);
+        if (h == 0)
+            continue;
+
+        const uint64_t probes = pos >= slots ? 3 + (pos - slots) / SLOTS : (pos / SLOTS == bucket1(ht, h) ? 1 : 2);
+        stats->histogram[probes < HT_HISTOGRAM_SIZE ? probes : HT_HISTOGRAM_SIZE - 1]++;
+    }
+}
+
+// a scan cursor keeps the bucket to continue from, along with the (low 16 bits of the) number of rehashes when it was
+// returned, so a cursor to buckets that have been reallocated since then starts over
+#define CURSOR_POS_BITS 48
+#define make_cursor(ht, pos) (((ht)->rehashes << CURSOR_POS_BITS) | (pos))
+#define cursor_pos(ht, cursor) \
+    ((cursor) >> CURSOR_POS_BITS == ((ht)->rehashes & 0xFFFF) ? (cursor) & ((1ull << CURSOR_POS_BITS) - 1) : 0)
+
+void hash_foreach(const HashTable ht, void (*visit)(Pointer value, void* context), void* context)
+{
+    assert(ht != NULL && visit != NULL);
+
+    for (uint64_t pos = 0; pos < stash_end(ht); pos++)
+        if (slot_hash(ht, pos) != 0) visit(slot_data(ht, pos), context);
+}
+
+// moves the iterator to the first element from slot pos onwards and returns it, NULL if there is none
+static inline Pointer iter_seek(hash_iter* it, uint64_t pos)
+{
+    const HashTable ht = it->ht;
+    while (pos < stash_end(ht) && slot_hash(ht, pos) == 0) pos++;
+
+    it->pos = pos;
+    return pos < stash_end(ht) ? slot_data(ht, pos) : NULL;
+}
+
+Pointer hash_iter_begin(const HashTable ht, hash_iter* it)
+{
+    assert(ht != NULL && it != NULL);
+
+    it->ht = ht;
+    it->node = NULL;
+    return iter_seek(it, 0);
+}
+
+Pointer hash_iter_next(hash_iter* it)
+{
+    assert(it != NULL && it->ht != NULL);
+    return it->pos < stash_end(it->ht) ? iter_seek(it, it->pos + 1) : NULL;
+}
+
+Pointer* hash_iter_value(const hash_iter* it)
+{
+    assert(it != NULL && it->ht->values != NULL && it->pos < stash_end(it->ht));
+    return slot_value(it->ht, it->pos);
+}
+
+// the elements move between their two buckets, which are in the same block, so the buckets are visited a block at a
+// time, and from the stash, where only new elements are placed, so the stash is visited first
+// the cursor is 0 before the stash is visited, the next bucket + 1 after that
+uint64_t hash_scan(const HashTable ht, const uint64_t cursor, const uint64_t count, void (*visit)(Pointer value, void* context), void* context)
+{
+    assert(ht != NULL && visit != NULL && count != 0);
+
+    uint64_t b = cursor_pos(ht, cursor);
+    if (b == 0)
+    {
+        for (uint64_t pos = stash_start(ht); pos < stash_end(ht); pos++)
+            if (slot_hash(ht, pos) != 0) visit(slot_data(ht, pos), context);
+    }
+    else
+        b--;
+
+    const uint64_t block = ht->capacity < BLOCK ? ht->capacity : BLOCK;
+    for (const uint64_t end = b + count; b < end && b < ht->capacity; b += block)
+    {
+        for (uint64_t pos = b * SLOTS; pos < (b + block) * SLOTS; pos++)
+            if (slot_hash(ht, pos) != 0) visit(slot_data(ht, pos), context);
+    }
+
+    return b < ht->capacity ? make_cursor(ht, b + 1) : 0;
+}
+
+void hash_destroy(const HashTable ht)
+{
+    assert(ht != NULL);
+
+    // if a destroy function exists & there are elements, destroy the data (and values)
+    const DestroyFunc destroy_value = ht->values != NULL ? ht->destroy_value : NULL;
+    if ((ht->destroy != NULL || destroy_value != NULL) && ht->elements != 0)
+    {
+        for (uint64_t pos = 0; pos < stash_end(ht); pos++)
+        {
+            if (slot_hash(ht, pos) != 0)
+            {
+                if (ht->destroy != NULL) ht->destroy(slot_data(ht, pos));
+                if (destroy_value != NULL) destroy_value(*slot_value(ht, pos));
+            }
+        }
+    }
+
+    free(ht->buckets);
+    free(ht->stash);
+    free(ht->values);
+    free(ht->stash_values);
+    free(ht);
+}
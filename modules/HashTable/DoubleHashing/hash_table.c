@@ -1,18 +1,23 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include "hash_table.h"
 
 // when max load factor is exceeded, rehashing operation occurs
+// deleted buckets count towards it, since they also have to be searched through
 #define MAX_LOAD_FACTOR 0.5
 
+// number of values the batch operations process together
+#define BATCH_SIZE 16
+
 typedef enum { EMPTY = 0, OCCUPIED, DELETED } bucket_state;
 
 // bucket
 typedef struct node
 {
     Pointer data;         // pointer to the data we are storing
-    uint32_t hash_value;  // hash value of the data
+    uint64_t hash_value;  // hash value of the data
     bucket_state state;   // state of the bucket (empty/occupied/deleted)
 }
 node;
@@ -20,18 +25,25 @@ node;
 typedef struct hash_table
 {
     node* buckets;        // buckets storing the data
+    Pointer* values;      // values of the buckets' data in map mode (NULL if not a map)
     uint8_t capacity;     // the capacity of the hash table - index to the "hash_sizes" array
     uint8_t sec_prime;    // the prime number used for the second hash function
+    uint64_t recip;       // reciprocal of the capacity, used to find the buckets without divisions
+    uint64_t sec_recip;   // reciprocal of the second prime
     uint64_t elements;    // number of elements currently stored in the hash table
+    uint64_t deleted;     // number of deleted buckets (tombstones)
+    bool scanning;        // a scan is in progress, so the deleted buckets are cleaned up without moving the elements
     HashFunc hash;        // function that hashes an element into a positive integer 
+    HashFunc64 hash64;    // function that hashes an element into a 64-bit integer, used instead of hash if given
     CompareFunc compare;  // function that compares the elements
     DestroyFunc destroy;  // function that destroys the elements, NULL if not
+    DestroyFunc destroy_value;  // function that destroys the values in map mode, NULL if not
+    uint64_t rehashes;    // number of rehashes
+    uint64_t lookups;     // number of searches (counted with HT_PROBE_STATS)
+    uint64_t probes;      // number of buckets checked by the searches (counted with HT_PROBE_STATS)
 }
 hash_table;
 
-// the second hash function
-// source: https://cgi.di.uoa.gr/~k08/manolis/2020-2021/lectures/Hashing.pdf , page 87 
-#define hash_func2(PRIME, h1) (PRIME - (h1 % PRIME))
 
 // available number of buckets, preferably prime numbers since it has been proven they have better behavior
 static uint64_t hash_sizes[] =
@@ -43,31 +55,128 @@ static uint64_t hash_sizes[] =
     144115188075855859, 288230376151711717, 576460752303423433, 1152921504606846883, 2305843009213693951, 4611686018427387847 };
 
 #define get_hash(i) (hash_sizes[i])
+#define LAST_SIZE ((uint8_t)(sizeof(hash_sizes) / sizeof(hash_sizes[0]) - 1))
+
+// fast modulo (Lemire et al., "Faster Remainder by Direct Computation")
+// hash % size is computed with multiplications, using the precomputed reciprocal of the size
+// for 32-bit hash values, sizes that do not fit in 32 bits (reciprocal 0) leave them as they are
+#define reciprocal(size) ((size) <= UINT32_MAX ? UINT64_MAX / (size) + 1 : 0)
+
+static inline uint32_t fast_mod(const uint32_t hash_value, const uint64_t recip, const uint64_t size)
+{
+    if (recip == 0) return hash_value;
+    return (uint32_t)(((__uint128_t)(recip * hash_value) * size) >> 64);
+}
+
+// 64-bit hash values are mapped to [0, size) by the high bits of hash_value * size (Lemire's "fastrange")
+// it needs no reciprocal and reaches every bucket of any size, but it relies on the high bits of the hash values
+// being well mixed, so it is only used for the 64-bit hash functions (32-bit ones use the exact modulo)
+static inline uint64_t fast_range(const uint64_t hash_value, const uint64_t size)
+{
+    return (uint64_t)(((__uint128_t)hash_value * size) >> 64);
+}
+
+#define hash_of(ht, value) ((ht)->hash64 != NULL ? (ht)->hash64(value) : (uint64_t)(ht)->hash(value))
+#define map_hash(ht, hash_value, recip, size) \
+    ((ht)->hash64 != NULL ? fast_range(hash_value, size) : fast_mod((uint32_t)(hash_value), recip, size))
+
+// the first hash function
+#define hash_func1(ht, h) map_hash(ht, h, (ht)->recip, get_hash((ht)->capacity))
+
+// the second hash function
+// source: https://cgi.di.uoa.gr/~k08/manolis/2020-2021/lectures/Hashing.pdf , page 87 
+// 64-bit hash values are rotated, so that the interval depends on different bits than the first position
+#define hash_func2(ht, h) (get_hash((ht)->sec_prime) - \
+    map_hash(ht, (ht)->hash64 != NULL ? ((h) << 32 | (h) >> 32) : (h), (ht)->sec_recip, get_hash((ht)->sec_prime)))
+
+// the next position to probe, the interval is smaller than the capacity so there is no need for a modulo
+#define next_pos(pos, interval, size) ((pos) + (interval) >= (size) ? (pos) + (interval) - (size) : (pos) + (interval))
+
+// counts a search that checked the given number of buckets
+#ifdef HT_PROBE_STATS
+#define count_lookup(ht, checked) ((ht)->lookups++, (ht)->probes += (checked))
+#else
+#define count_lookup(ht, checked) ((void)0)
+#endif
+
+// sets the capacity and the prime of the second hash function, along with their reciprocals
+static inline void set_capacity(const HashTable ht, const uint8_t capacity, const uint8_t sec_prime)
+{
+    ht->capacity = capacity;
+    ht->sec_prime = sec_prime;
+    ht->recip = reciprocal(get_hash(capacity));
+    ht->sec_recip = reciprocal(get_hash(sec_prime));
+}
 
 
 // function prototype
-static inline void rehash(HashTable);
+static void rehash(HashTable, const uint8_t);
 
-HashTable hash_create(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy)
+// creates the hash table with the hash function, or the 64-bit one, that is given
+static HashTable create(const HashFunc hash, const HashFunc64 hash64, const CompareFunc compare, const DestroyFunc destroy)
 {
-    assert(hash != NULL && compare != NULL);  // a hash and compare function needs to be given
+    assert((hash != NULL || hash64 != NULL) && compare != NULL);  // a hash and compare function needs to be given
     
     HashTable ht = malloc(sizeof(hash_table));
     assert(ht != NULL);  // allocation failure
 
-    ht->capacity = 1;
+    set_capacity(ht, 1, 0);
     ht->buckets = calloc(sizeof(node), get_hash(ht->capacity));  // allocate memory for the buckets
     assert(ht->buckets != NULL);  // allocation failure
     
-    ht->sec_prime = 0;
-    ht->elements = 0;
+    ht->elements = ht->deleted = 0;
+    ht->scanning = false;
     ht->hash = hash;
+    ht->hash64 = hash64;
     ht->compare = compare;
     ht->destroy = destroy;
+    ht->values = NULL;
+    ht->destroy_value = NULL;
+    ht->rehashes = ht->lookups = ht->probes = 0;
 
     return ht;
 }
 
+HashTable hash_create(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert(hash != NULL);
+    return create(hash, NULL, compare, destroy);
+}
+
+HashTable hash_create_with_capacity(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy, const uint64_t expected)
+{
+    HashTable ht = hash_create(hash, compare, destroy);
+    hash_reserve(ht, expected);
+    ht->rehashes = 0;  // sizing the buckets of a new hash table is not a rehash
+    return ht;
+}
+
+HashTable hash_create64(const HashFunc64 hash, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert(hash != NULL);
+    return create(NULL, hash, compare, destroy);
+}
+
+// turns the hash table into a map
+static HashTable make_map(const HashTable ht, const DestroyFunc destroy_value)
+{
+    ht->values = calloc(sizeof(Pointer), get_hash(ht->capacity));  // allocate memory for the values
+    assert(ht->values != NULL);  // allocation failure
+    ht->destroy_value = destroy_value;
+
+    return ht;
+}
+
+HashTable hash_map_create(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy_key, const DestroyFunc destroy_value)
+{
+    return make_map(hash_create(hash, compare, destroy_key), destroy_value);
+}
+
+HashTable hash_map_create64(const HashFunc64 hash, const CompareFunc compare, const DestroyFunc destroy_key, const DestroyFunc destroy_value)
+{
+    return make_map(hash_create64(hash, compare, destroy_key), destroy_value);
+}
+
 uint64_t hash_size(const HashTable ht)
 {
     assert(ht != NULL);
@@ -80,84 +189,195 @@ bool is_ht_empty(const HashTable ht)
     return ht->elements == 0;
 }
 
-bool hash_insert(const HashTable ht, const Pointer value)
+// empties the deleted buckets that no element's search passes through, without moving the elements
+// (the rest of them are between the first bucket of an element and its own, so they have to be kept)
+static void drop_deleted(const HashTable ht)
 {
-    assert(ht != NULL);
+    const uint64_t size = get_hash(ht->capacity);
+    uint64_t* needed = calloc(size / 64 + 1, sizeof(uint64_t));
+    assert(needed != NULL);  // allocation failure
 
-    if (((float)ht->elements / get_hash(ht->capacity)) > MAX_LOAD_FACTOR)  // max load factor exceeded, start rehash
-        rehash(ht);
-    
-    const uint32_t hash_value = ht->hash(value), interval = hash_func2(get_hash(ht->sec_prime), hash_value);
-    uint32_t pos = hash_value % get_hash(ht->capacity), pos_adjustment = 0;
+    for (uint64_t i = 0; i < size; i++)
+    {
+        if (ht->buckets[i].state != OCCUPIED)
+            continue;
 
-    uint64_t deleted_index = get_hash(ht->capacity)+1;  // save deleted node's index if found
+        const uint64_t interval = hash_func2(ht, ht->buckets[i].hash_value);
+        for (uint64_t pos = hash_func1(ht, ht->buckets[i].hash_value); pos != i; pos = next_pos(pos, interval, size))
+            needed[pos / 64] |= (uint64_t)1 << (pos % 64);
+    }
 
-    for (uint64_t i = 0; i < get_hash(ht->capacity); pos_adjustment += interval, i++)
+    for (uint64_t i = 0; i < size; i++)
     {
-        const uint64_t new_pos = (pos + pos_adjustment) % get_hash(ht->capacity);
+        if (ht->buckets[i].state == DELETED && !(needed[i / 64] >> (i % 64) & 1))
+        {
+            ht->buckets[i].state = EMPTY;
+            ht->deleted--;
+        }
+    }
+    free(needed);
+}
+
+// returns the bucket holding the value, inserting it if it does not exist (and setting inserted)
+static inline uint64_t insert_bucket(const HashTable ht, const Pointer value, const uint64_t hash_value, bool* inserted)
+{
+    // max load factor exceeded, start rehash
+    // the table grows only if its elements alone are more than half the limit, otherwise it is full of deleted buckets
+    // and keeps its size, so that removing and inserting elements does not fill every probe sequence with them
+    const float max_elements = MAX_LOAD_FACTOR * get_hash(ht->capacity);
+    if (ht->elements + ht->deleted > max_elements)
+    {
+        // while a scan is in progress the deleted buckets are emptied in place instead, since a rehash starts it over
+        // (unless the table has to grow, or only few of them can be emptied)
+        if (ht->scanning && ht->elements <= max_elements/2)
+            drop_deleted(ht);
+        if (ht->elements + ht->deleted > 0.75 * max_elements)
+            rehash(ht, ht->elements > max_elements/2 ? ht->capacity+1 : ht->capacity);
+    }
+    
+    const uint64_t interval = hash_func2(ht, hash_value);
+    const uint64_t size = get_hash(ht->capacity);
+    uint64_t pos = size;
 
+    uint64_t deleted_index = size+1;  // save deleted node's index if found
+
+    uint64_t new_pos = hash_func1(ht, hash_value), i = 0;
+    for (; i < size; new_pos = next_pos(new_pos, interval, size), i++)
+    {
         if (ht->buckets[new_pos].state == EMPTY)  // empty spot found, insert
         {
-            pos = deleted_index == get_hash(ht->capacity)+1? new_pos : deleted_index;
+            pos = deleted_index == size+1? new_pos : deleted_index;
             break;
         }
         // a deleted, possible, spot found 
         // altough we could just insert here, we mark it and keep searching in case the value already exists in order to avoid duplicates
         else if (ht->buckets[new_pos].state == DELETED)
         {
-            if (deleted_index == get_hash(ht->capacity)+1)
+            if (deleted_index == size+1)
                 deleted_index = new_pos;
         }
         // check to see if value already exists in the hash table
-        else if (ht->compare(ht->buckets[new_pos].data, value) == 0)  // value already exists
+        else if (ht->buckets[new_pos].hash_value == hash_value && ht->compare(ht->buckets[new_pos].data, value) == 0)  // value already exists
         {
-            // if a destroy function exists, destroy the value
-            if (ht->destroy != NULL)
-                ht->destroy(value);
-            return false;
+            count_lookup(ht, i + 1);
+            *inserted = false;
+            return new_pos;
         }
     }
+    count_lookup(ht, pos != size ? i + 1 : size);
+    if (pos == size)  // there are no empty buckets left in the value's sequence, use the deleted one
+        pos = deleted_index;
+    if (pos == deleted_index)
+        ht->deleted--;
 
     ht->buckets[pos].state = OCCUPIED;  // mark the bucket as occupied
     ht->buckets[pos].data = value;
     ht->buckets[pos].hash_value = hash_value;
+    if (ht->values != NULL)
+        ht->values[pos] = NULL;
     ht->elements++;  // value inserted, increment the number of elements in the hash table
 
-    return true;
+    *inserted = true;
+    return pos;
+}
+
+// inserts the value with the given hash value, returns true if it was inserted
+static inline bool insert_hashed(const HashTable ht, const Pointer value, const uint64_t hash_value)
+{
+    bool inserted;
+    insert_bucket(ht, value, hash_value, &inserted);
+
+    // if the value already exists and a destroy function exists, destroy the value
+    if (!inserted && ht->destroy != NULL)
+        ht->destroy(value);
+
+    return inserted;
+}
+
+bool hash_insert(const HashTable ht, const Pointer value)
+{
+    assert(ht != NULL);
+    return insert_hashed(ht, value, hash_of(ht, value));
+}
+
+Pointer* hash_map_get_or_insert(const HashTable ht, const Pointer key, bool* inserted)
+{
+    assert(ht != NULL && ht->values != NULL && inserted != NULL);
+
+    const uint64_t pos = insert_bucket(ht, key, hash_of(ht, key), inserted);
+
+    // if the key already exists and a destroy function exists, destroy the key
+    if (!(*inserted) && ht->destroy != NULL)
+        ht->destroy(key);
+    
+    return ht->values + pos;
+}
+
+bool hash_map_put(const HashTable ht, const Pointer key, const Pointer value)
+{
+    bool inserted;
+    Pointer* slot = hash_map_get_or_insert(ht, key, &inserted);
+
+    // the key already exists, destroy its old value
+    if (!inserted && ht->destroy_value != NULL && *slot != value)
+        ht->destroy_value(*slot);
+    
+    *slot = value;
+    return inserted;
 }
 
 // helper function
-static inline void rehash_insert(const HashTable ht, const Pointer value, const uint32_t hash_value);
-static inline void rehash(const HashTable ht)
+static inline uint64_t rehash_insert(const HashTable ht, const Pointer value, const uint64_t hash_value);
+
+// moves the elements to new buckets, dropping the deleted ones
+// (capacity is the current one to clean up the deleted buckets, the next one when the table grows, or any larger one
+// that hash_reserve asks for - the second prime is always the one before it)
+static void rehash(const HashTable ht, const uint8_t capacity)
 {
     // save previous buckets
     node* old_buckets = ht->buckets;
+    Pointer* old_values = ht->values;
+    const uint64_t old_size = get_hash(ht->capacity);
 
-    ht->sec_prime = ht->capacity;
-    (ht->capacity)++;
+    if (capacity != ht->capacity)
+        set_capacity(ht, capacity, capacity - 1);
+    ht->deleted = 0;
+    ht->rehashes++;
             
     // create the new number of buckets
     ht->buckets = calloc(sizeof(node), get_hash(ht->capacity));
     assert(ht->buckets != NULL);  // allocation failure
 
+    if (old_values != NULL)  // map mode, the values move along with their keys
+    {
+        ht->values = malloc(sizeof(Pointer) * get_hash(ht->capacity));
+        assert(ht->values != NULL);  // allocation failure
+    }
+
     // start rehash operation
-    for (uint64_t i = 0; i < get_hash(ht->sec_prime); i++)
+    for (uint64_t i = 0; i < old_size; i++)
     {
         if (old_buckets[i].state == OCCUPIED)
-            rehash_insert(ht, old_buckets[i].data, old_buckets[i].hash_value);
+        {
+            const uint64_t pos = rehash_insert(ht, old_buckets[i].data, old_buckets[i].hash_value);
+            if (old_values != NULL)
+                ht->values[pos] = old_values[i];
+        }
     }
     free(old_buckets);
+    free(old_values);
 }
 
-static inline void rehash_insert(const HashTable ht, const Pointer value, const uint32_t hash_value)
+// inserts the value at the new buckets and returns its position
+static inline uint64_t rehash_insert(const HashTable ht, const Pointer value, const uint64_t hash_value)
 {
-    uint64_t pos = hash_value % get_hash(ht->capacity), pos_adjustment = 0;
-    const uint32_t interval = hash_func2(get_hash(ht->sec_prime), hash_value);
+    const uint64_t interval = hash_func2(ht, hash_value);
+    const uint64_t size = get_hash(ht->capacity);
+    uint64_t pos = 0;
 
-    for (uint64_t i = 0; i < get_hash(ht->capacity); pos_adjustment += interval, i++)
+    uint64_t new_pos = hash_func1(ht, hash_value);
+    for (uint64_t i = 0; i < size; new_pos = next_pos(new_pos, interval, size), i++)
     {
-        const uint64_t new_pos = (pos + pos_adjustment) % get_hash(ht->capacity);
-
         // during rehashing only empty spots exist
         if (ht->buckets[new_pos].state == EMPTY)  // empty spot found, insert
         {
@@ -170,24 +390,31 @@ static inline void rehash_insert(const HashTable ht, const Pointer value, const
     ht->buckets[pos].state = OCCUPIED;
     ht->buckets[pos].data = value;
     ht->buckets[pos].hash_value = hash_value;
+    return pos;
 }
 
 // returns the bucket in which the value exists
 // if it does not exist, returns the capacity of the hash table
-static inline uint64_t find_bucket(const HashTable ht, const Pointer value)
+static inline uint64_t find_bucket(const HashTable ht, const Pointer value, const uint64_t h1)
 {
-    const uint32_t h1 = ht->hash(value), interval = hash_func2(get_hash(ht->sec_prime), h1);
+    const uint64_t interval = hash_func2(ht, h1);
+    const uint64_t size = get_hash(ht->capacity);
     uint64_t buckets_checked = 0;
     
-    for (uint64_t pos = h1 % get_hash(ht->capacity); ht->buckets[pos].state != EMPTY; pos = (pos + interval) % get_hash(ht->capacity))
+    for (uint64_t pos = hash_func1(ht, h1); ht->buckets[pos].state != EMPTY; pos = next_pos(pos, interval, size))
     {
-        if (ht->buckets[pos].state == OCCUPIED && ht->compare(ht->buckets[pos].data, value) == 0)
+        buckets_checked++;
+        if (ht->buckets[pos].state == OCCUPIED && ht->buckets[pos].hash_value == h1 && ht->compare(ht->buckets[pos].data, value) == 0)
+        {
+            count_lookup(ht, buckets_checked);
             return pos;
-        else if (++buckets_checked == get_hash(ht->capacity))  // searched all buckets containing data, value does not exist
+        }
+        else if (buckets_checked == size)  // searched all buckets containing data, value does not exist
             break;
     }
 
     // reached an empty bucket, value does not exist
+    count_lookup(ht, buckets_checked + (buckets_checked != size));  // the empty bucket was checked as well
     return get_hash(ht->capacity);
 }
 
@@ -197,26 +424,142 @@ bool hash_remove(const HashTable ht, const Pointer value)
         return false;
     
     // find the potential bucket the value exists in
-    const uint64_t pos = find_bucket(ht, value);
+    const uint64_t pos = find_bucket(ht, value, hash_of(ht, value));
     if (pos == get_hash(ht->capacity))  // value does not exist
         return false;
 
     // destroy the data, if a destroy function is given
     if (ht->destroy != NULL)
         ht->destroy(ht->buckets[pos].data);
+    if (ht->values != NULL && ht->destroy_value != NULL)
+        ht->destroy_value(ht->values[pos]);
 
     ht->buckets[pos].state = DELETED;  // mark the bucket as deleted
     ht->buckets[pos].data = NULL;
     ht->elements--;  // value removed, decrement the number of elements in the hash table
+    ht->deleted++;
     return true;
 }
 
+Pointer* hash_map_get(const HashTable ht, const Pointer key)
+{
+    assert(ht != NULL && ht->values != NULL);
+
+    if (is_ht_empty(ht))  // hash table is empty, nothing to search
+        return NULL;
+
+    const uint64_t pos = find_bucket(ht, key, hash_of(ht, key));
+    return pos != get_hash(ht->capacity) ? ht->values + pos : NULL;
+}
+
 bool hash_exists(const HashTable ht, const Pointer value)
 {
     if (is_ht_empty(ht))  // hash table is empty, nothing to search
         return false;
 
-    return find_bucket(ht, value) != get_hash(ht->capacity);
+    return find_bucket(ht, value, hash_of(ht, value)) != get_hash(ht->capacity);
+}
+
+Pointer hash_find(const HashTable ht, const Pointer value)
+{
+    if (is_ht_empty(ht))  // hash table is empty, nothing to search
+        return NULL;
+
+    const uint64_t pos = find_bucket(ht, value, hash_of(ht, value));
+    return pos != get_hash(ht->capacity) ? ht->buckets[pos].data : NULL;
+}
+
+// a single search finds either the element or the bucket to insert the value at
+bool hash_get_or_insert(const HashTable ht, const Pointer value, Pointer* existing)
+{
+    assert(ht != NULL && existing != NULL);
+
+    bool inserted;
+    const uint64_t pos = insert_bucket(ht, value, hash_of(ht, value), &inserted);
+    *existing = ht->buckets[pos].data;
+    return inserted;
+}
+
+// sets bit i of the result bitmap (if given) to b
+static inline void set_result(uint64_t* result, const uint64_t i, const bool b)
+{
+    if (result == NULL) return;
+
+    const uint64_t mask = (uint64_t)1 << (i % 64);
+    result[i / 64] = b ? (result[i / 64] | mask) : (result[i / 64] & ~mask);
+}
+
+// computes the hash values of the values [start, end) and prefetches the first bucket of each
+static inline void prefetch_batch(const HashTable ht, const Pointer* values, const uint64_t start, const uint64_t end, uint64_t* hashes)
+{
+    for (uint64_t i = start; i < end; i++)
+    {
+        hashes[i - start] = hash_of(ht, values[i]);
+        __builtin_prefetch(&(ht->buckets[hash_func1(ht, hashes[i - start])]));
+    }
+}
+
+uint64_t hash_exists_many(const HashTable ht, const Pointer* values, const uint64_t n, uint64_t* result)
+{
+    assert(ht != NULL && (values != NULL || n == 0));
+
+    uint64_t found = 0;
+    uint64_t hashes[BATCH_SIZE];
+    for (uint64_t start = 0; start < n; start += BATCH_SIZE)
+    {
+        const uint64_t end = start + BATCH_SIZE < n ? start + BATCH_SIZE : n;
+        prefetch_batch(ht, values, start, end, hashes);
+
+        for (uint64_t i = start; i < end; i++)
+        {
+            const bool exists = !is_ht_empty(ht) && find_bucket(ht, values[i], hashes[i - start]) != get_hash(ht->capacity);
+            set_result(result, i, exists);
+            found += exists;
+        }
+    }
+    return found;
+}
+
+uint64_t hash_insert_many(const HashTable ht, const Pointer* values, const uint64_t n, uint64_t* result)
+{
+    assert(ht != NULL && (values != NULL || n == 0));
+
+    uint64_t inserted = 0;
+    uint64_t hashes[BATCH_SIZE];
+    for (uint64_t start = 0; start < n; start += BATCH_SIZE)
+    {
+        const uint64_t end = start + BATCH_SIZE < n ? start + BATCH_SIZE : n;
+        prefetch_batch(ht, values, start, end, hashes);
+
+        for (uint64_t i = start; i < end; i++)
+        {
+            const bool ins = insert_hashed(ht, values[i], hashes[i - start]);
+            set_result(result, i, ins);
+            inserted += ins;
+        }
+    }
+    return inserted;
+}
+
+void hash_compact(const HashTable ht)
+{
+    assert(ht != NULL);
+
+    if (ht->deleted != 0)
+        rehash(ht, ht->capacity);
+}
+
+void hash_reserve(const HashTable ht, const uint64_t n)
+{
+    assert(ht != NULL);
+
+    // the smallest capacity that holds n elements within the max load factor (the first size is only a second prime)
+    uint8_t capacity = 1;
+    while (n > MAX_LOAD_FACTOR * get_hash(capacity) && capacity != LAST_SIZE)
+        capacity++;
+
+    if (capacity > ht->capacity)
+        rehash(ht, capacity);
 }
 
 DestroyFunc hash_set_destroy(const HashTable ht, const DestroyFunc new_destroy_func)
@@ -228,23 +571,117 @@ DestroyFunc hash_set_destroy(const HashTable ht, const DestroyFunc new_destroy_f
     return old_destroy_func;
 }
 
+void hash_stats(const HashTable ht, struct ht_stats* stats)
+{
+    assert(ht != NULL && stats != NULL);
+    memset(stats, 0, sizeof(struct ht_stats));
+
+    const uint64_t size = get_hash(ht->capacity);
+    stats->elements = ht->elements;
+    stats->buckets = size;
+    stats->load_factor = (double)ht->elements / size;
+    stats->bytes = sizeof(hash_table) + size * (sizeof(node) + (ht->values != NULL ? sizeof(Pointer) : 0));
+    stats->tombstones = ht->deleted;
+    stats->rehashes = ht->rehashes;
+    stats->lookups = ht->lookups;
+    stats->probes = ht->probes;
+
+    for (uint64_t i = 0; i < size; i++)
+    {
+        if (ht->buckets[i].state == OCCUPIED)
+        {
+            // follow the element's probe sequence up to its bucket
+            const uint64_t interval = hash_func2(ht, ht->buckets[i].hash_value);
+            uint64_t probes = 1;
+            for (uint64_t pos = hash_func1(ht, ht->buckets[i].hash_value); pos != i; pos = next_pos(pos, interval, size))
+                probes++;
+            stats->histogram[probes < HT_HISTOGRAM_SIZE ? probes : HT_HISTOGRAM_SIZE - 1]++;
+        }
+    }
+}
+
+// a scan cursor keeps the bucket to continue from, along with the (low 16 bits of the) number of rehashes when it was
+// returned, so a cursor to buckets that have been reallocated since then starts over
+#define CURSOR_POS_BITS 48
+#define make_cursor(ht, pos) (((ht)->rehashes << CURSOR_POS_BITS) | (pos))
+#define cursor_pos(ht, cursor) \
+    ((cursor) >> CURSOR_POS_BITS == ((ht)->rehashes & 0xFFFF) ? (cursor) & ((1ull << CURSOR_POS_BITS) - 1) : 0)
+
+void hash_foreach(const HashTable ht, void (*visit)(Pointer value, void* context), void* context)
+{
+    assert(ht != NULL && visit != NULL);
+
+    const uint64_t size = get_hash(ht->capacity);
+    for (uint64_t i = 0; i < size; i++)
+        if (ht->buckets[i].state == OCCUPIED) visit(ht->buckets[i].data, context);
+}
+
+// moves the iterator to the first element from bucket pos onwards and returns it, NULL if there is none
+static inline Pointer iter_seek(hash_iter* it, uint64_t pos)
+{
+    const HashTable ht = it->ht;
+    const uint64_t size = get_hash(ht->capacity);
+    while (pos < size && ht->buckets[pos].state != OCCUPIED) pos++;
+
+    it->pos = pos;
+    return pos < size ? ht->buckets[pos].data : NULL;
+}
+
+Pointer hash_iter_begin(const HashTable ht, hash_iter* it)
+{
+    assert(ht != NULL && it != NULL);
+
+    it->ht = ht;
+    it->node = NULL;
+    return iter_seek(it, 0);
+}
+
+Pointer hash_iter_next(hash_iter* it)
+{
+    assert(it != NULL && it->ht != NULL);
+    return it->pos < get_hash(it->ht->capacity) ? iter_seek(it, it->pos + 1) : NULL;
+}
+
+Pointer* hash_iter_value(const hash_iter* it)
+{
+    assert(it != NULL && it->ht->values != NULL && it->pos < get_hash(it->ht->capacity));
+    return &(it->ht->values[it->pos]);
+}
+
+// the elements stay at their buckets until the next rehash
+uint64_t hash_scan(const HashTable ht, const uint64_t cursor, const uint64_t count, void (*visit)(Pointer value, void* context), void* context)
+{
+    assert(ht != NULL && visit != NULL && count != 0);
+
+    const uint64_t size = get_hash(ht->capacity);
+    uint64_t pos = cursor_pos(ht, cursor);
+    for (const uint64_t end = pos + count; pos < end && pos < size; pos++)
+        if (ht->buckets[pos].state == OCCUPIED) visit(ht->buckets[pos].data, context);
+
+    ht->scanning = pos < size;
+    return pos < size ? make_cursor(ht, pos) : 0;
+}
+
 void hash_destroy(const HashTable ht)
 {
     assert(ht != NULL);
 
-    // if a destroy function exists & there are elements, destroy the data
-    if (ht->destroy != NULL && ht->elements != 0)
+    // if a destroy function exists & there are elements, destroy the data (and values)
+    const DestroyFunc destroy_value = ht->values != NULL ? ht->destroy_value : NULL;
+    if ((ht->destroy != NULL || destroy_value != NULL) && ht->elements != 0)
     {
         for (uint64_t i = 0 ;; i++)
         {
             if (ht->buckets[i].state == OCCUPIED)
             {
-                ht->destroy(ht->buckets[i].data);
+                if (ht->destroy != NULL) ht->destroy(ht->buckets[i].data);
+                if (destroy_value != NULL) destroy_value(ht->values[i]);
                 if (--(ht->elements) == 0) break;  // all elements deleted
             }
         }
     }
     
     free(ht->buckets);
+    free(ht->values);
     free(ht);
 }
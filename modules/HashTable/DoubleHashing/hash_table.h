@@ -15,6 +15,9 @@ typedef void (*DestroyFunc)(Pointer value);
 // Pointer to function that hashes a value to a positive (unsigned) integer
 typedef unsigned int (*HashFunc)(Pointer value);
 
+// Pointer to function that hashes a value to a 64-bit (unsigned) integer
+typedef uint64_t (*HashFunc64)(Pointer value);
+
 typedef struct hash_table* HashTable;
 
 
@@ -24,6 +27,11 @@ typedef struct hash_table* HashTable;
 //           a destroy function (or NULL if you want to preserve the data)
 HashTable hash_create(const HashFunc, const CompareFunc, const DestroyFunc);
 
+// creates hash table with room for the expected number of elements, so that inserting them does not rehash
+// (as long as no element is removed, see hash_reserve)
+// -requires the same functions as hash_create
+HashTable hash_create_with_capacity(const HashFunc, const CompareFunc, const DestroyFunc, const uint64_t expected);
+
 // inserts value at the hash table
 // returns true if the value was inserted, false if it already exists
 bool hash_insert(const HashTable, const Pointer);
@@ -35,6 +43,14 @@ bool hash_remove(const HashTable, const Pointer);
 // returns true if value exists in the hash table, false otherwise
 bool hash_exists(const HashTable, const Pointer);
 
+// returns the stored element that is equal to value, NULL if it does not exist
+Pointer hash_find(const HashTable, const Pointer);
+
+// inserts value at the hash table if no equal element exists, searching for it only once
+// returns true if the value was inserted, false if an equal element exists - unlike hash_insert, the value is not
+// destroyed then, and the stored element is returned at existing (set to value if it was inserted)
+bool hash_get_or_insert(const HashTable, const Pointer value, Pointer* existing);
+
 // returns the number of elements in the hash table
 uint64_t hash_size(const HashTable);
 
@@ -44,5 +60,128 @@ bool is_ht_empty(const HashTable);
 // changes the destroy function and returns the old one
 DestroyFunc hash_set_destroy(const HashTable, const DestroyFunc);
 
+// removes the deleted buckets (tombstones) that hash_remove leaves behind, rehashing the elements into the same number of buckets
+// (insertions also do it, once the elements and deleted buckets reach the max load factor, unless the table has to grow)
+void hash_compact(const HashTable);
+
+// makes room for n elements, rehashing right away if needed, so that inserting up to n elements does not rehash
+// (only if no element is removed: the deleted buckets count towards the load factor, so after removals inserting
+// can still rehash at the same size, to clean them up)
+// it never shrinks the hash table
+void hash_reserve(const HashTable, const uint64_t n);
+
 // destroys the memory used by the hash table
 void hash_destroy(const HashTable);
+
+//////////////////////////////
+// batch operations         //
+//////////////////////////////
+// the values are processed in groups: the hash values of a group are computed and its buckets are
+// prefetched before they are searched, so the memory accesses of different values overlap
+// result is a bitmap with room for at least (n+63)/64 words (or NULL): bit i (result[i/64] >> (i%64)) is set for values[i]
+
+// checks whether each of the n values exists in the hash table
+// returns the number of values that exist
+uint64_t hash_exists_many(const HashTable, const Pointer* values, const uint64_t n, uint64_t* result);
+
+// inserts the n values at the hash table, the values that already exist are destroyed as in hash_insert
+// returns the number of values that were inserted
+uint64_t hash_insert_many(const HashTable, const Pointer* values, const uint64_t n, uint64_t* result);
+
+//////////////////////////////
+// map mode                 //
+//////////////////////////////
+// a hash table in map mode associates every element (key) with a value, stored next to the key
+// all the functions above work on maps as well (eg. hash_remove also destroys the key's value)
+
+// creates hash table in map mode
+// -requires a hash function
+//           a compare function
+//           a destroy function for the keys and one for the values (or NULL if you want to preserve the data)
+HashTable hash_map_create(const HashFunc, const CompareFunc, const DestroyFunc, const DestroyFunc);
+
+// inserts the key with the value, or replaces the value of the key if it already exists
+// (then the old value and the given key are destroyed, if destroy functions were given)
+// returns true if the key was inserted, false if it already existed
+bool hash_map_put(const HashTable, const Pointer key, const Pointer value);
+
+// returns the address of the key's value, so it can be read or changed in place, NULL if the key does not exist
+// the address remains valid until the hash table is modified
+Pointer* hash_map_get(const HashTable, const Pointer key);
+
+// returns the address of the key's value, inserting the key with a NULL value if it does not exist
+// inserted is set to true if the key was inserted - otherwise the given key is destroyed, if a destroy function was given
+Pointer* hash_map_get_or_insert(const HashTable, const Pointer key, bool* inserted);
+
+//////////////////////////////
+// 64-bit hash functions    //
+//////////////////////////////
+// a hash table created with a 64-bit hash function (eg. hash_int64, hash_string64) stores the full hash values,
+// so that tables with more than 2^32 buckets can reach all of them and large tables keep a uniform distribution
+
+// creates hash table with a 64-bit hash function, see hash_create
+HashTable hash_create64(const HashFunc64, const CompareFunc, const DestroyFunc);
+
+// creates hash table in map mode with a 64-bit hash function, see hash_map_create
+HashTable hash_map_create64(const HashFunc64, const CompareFunc, const DestroyFunc, const DestroyFunc);
+
+//////////////////////////////
+// statistics               //
+//////////////////////////////
+#define HT_HISTOGRAM_SIZE 16  // number of entries of the statistics' histogram
+
+struct ht_stats
+{
+    uint64_t elements;     // number of elements
+    uint64_t buckets;      // number of buckets (slots)
+    double load_factor;    // elements / buckets
+    uint64_t bytes;        // bytes allocated by the hash table, not counting the elements themselves
+    // chained hash tables: histogram[i] is the number of buckets holding i elements
+    // open addressing: histogram[i] is the number of elements found with i probes (histogram[0] is 0)
+    // the last entry also counts every larger chain length or number of probes
+    uint64_t histogram[HT_HISTOGRAM_SIZE];
+    uint64_t tombstones;   // number of buckets marked as deleted (0 if the implementation does not use them)
+    uint64_t rehashes;     // number of times the buckets were reallocated since the hash table was created
+    // the lookups are counted only if the library is compiled with HT_PROBE_STATS (make PROBE_STATS=1), 0 otherwise
+    uint64_t lookups;      // number of searches for a value, by any operation
+    uint64_t probes;       // number of buckets (nodes) checked by those searches, probes / lookups is the average
+};
+
+// fills stats with the statistics of the hash table - it goes through all of its buckets
+void hash_stats(const HashTable, struct ht_stats* stats);
+
+//////////////////////////////
+// iteration                //
+//////////////////////////////
+// the elements are visited in the order they are stored in memory (bucket by bucket), not in any order of their values
+
+// visits every element of the hash table, passing the given context to the visit function
+// the visit function must not modify the hash table
+void hash_foreach(const HashTable, void (*visit)(Pointer value, void* context), void* context);
+
+// iterator, the hash table must not be modified while it is being iterated
+typedef struct hash_iter
+{
+    HashTable ht;  // the hash table
+    uint64_t pos;  // bucket (slot) of the current element
+    Pointer node;  // node of the current element, NULL if it is stored at the bucket itself
+}
+hash_iter;
+
+// initializes the iterator and returns the first element, NULL if the hash table is empty
+Pointer hash_iter_begin(const HashTable, hash_iter*);
+
+// returns the next element, NULL if the iteration is over
+Pointer hash_iter_next(hash_iter*);
+
+// returns the address of the current element's value (map mode)
+Pointer* hash_iter_value(const hash_iter*);
+
+// visits the elements of (at least) the next count buckets, starting from the cursor, and returns the cursor to
+// continue from, 0 when the scan is over - a scan starts from cursor 0
+// the hash table can change between the calls: every element that is in it for the whole scan is visited at least
+// once, and if the buckets are reallocated (rehash) the scan starts over at the new ones, so some may be visited again
+// while a scan is in progress (until it returns 0), the deleted buckets that removals leave are emptied in place
+// instead of rehashing at the same size, so it starts over when the table grows, at hash_compact, and only rarely
+// otherwise (when few of them can be emptied)
+uint64_t hash_scan(const HashTable, const uint64_t cursor, const uint64_t count, void (*visit)(Pointer value, void* context), void* context);
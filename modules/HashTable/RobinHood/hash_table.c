@@ -0,0 +1,567 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "hash_table.h"
+
+// when max load factor is exceeded, rehashing operation occurs
+#define MAX_LOAD_FACTOR 0.9
+
+// number of values the batch operations process together
+#define BATCH_SIZE 16
+
+// initial number of buckets (a power of 2)
+#define MIN_CAPACITY 32
+
+// bucket
+typedef struct node
+{
+    Pointer data;         // pointer to the data we are storing
+    uint64_t hash_value;  // hash value of the data
+    uint32_t dist;        // distance of the bucket from the data's home bucket + 1, 0 if the bucket is empty
+}
+node;
+
+typedef struct hash_table
+{
+    node* buckets;        // buckets storing the data
+    Pointer* values;      // values of the buckets' data in map mode (NULL if not a map)
+    uint64_t capacity;    // the capacity of the hash table - a power of 2
+    uint8_t shift;        // 64 - log2(capacity), used to find the home buckets
+    uint64_t elements;    // number of elements currently stored in the hash table
+    HashFunc hash;        // function that hashes an element into a positive integer 
+    HashFunc64 hash64;    // function that hashes an element into a 64-bit integer, used instead of hash if given
+    CompareFunc compare;  // function that compares the elements
+    DestroyFunc destroy;  // function that destroys the elements, NULL if not
+    DestroyFunc destroy_value;  // function that destroys the values in map mode, NULL if not
+    uint64_t rehashes;    // number of rehashes
+    uint64_t lookups;     // number of searches (counted with HT_PROBE_STATS)
+    uint64_t probes;      // number of buckets checked by the searches (counted with HT_PROBE_STATS)
+}
+hash_table;
+
+// the home bucket of a hash value, found by fibonacci hashing (multiplication and shift)
+// so that all the bits of the hash value are used, even though the capacity is a power of 2
+#define home_bucket(ht, hash_value) ((uint64_t)((hash_value) * 0x9E3779B97F4A7C15ull) >> (ht)->shift)
+
+#define hash_of(ht, value) ((ht)->hash64 != NULL ? (ht)->hash64(value) : (uint64_t)(ht)->hash(value))
+
+// counts a search that checked the given number of buckets
+#ifdef HT_PROBE_STATS
+#define count_lookup(ht, checked) ((ht)->lookups++, (ht)->probes += (checked))
+#else
+#define count_lookup(ht, checked) ((void)0)
+#endif
+
+#define next_bucket(ht, pos) (((pos) + 1) & ((ht)->capacity - 1))
+
+// allocates the buckets of the hash table
+static inline void allocate_buckets(const HashTable ht, const uint64_t capacity, const bool is_map)
+{
+    ht->capacity = capacity;
+    ht->shift = 64 - __builtin_ctzll(capacity);
+
+    ht->buckets = calloc(sizeof(node), capacity);
+    assert(ht->buckets != NULL);  // allocation failure
+
+    ht->values = NULL;
+    if (is_map)
+    {
+        ht->values = malloc(sizeof(Pointer) * capacity);
+        assert(ht->values != NULL);  // allocation failure
+    }
+}
+
+// creates the hash table with the hash function, or the 64-bit one, that is given
+static HashTable create(const HashFunc hash, const HashFunc64 hash64, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert((hash != NULL || hash64 != NULL) && compare != NULL);  // a hash and compare function needs to be given
+    
+    HashTable ht = malloc(sizeof(hash_table));
+    assert(ht != NULL);  // allocation failure
+
+    allocate_buckets(ht, MIN_CAPACITY, false);
+    
+    ht->elements = 0;
+    ht->rehashes = ht->lookups = ht->probes = 0;
+    ht->hash = hash;
+    ht->hash64 = hash64;
+    ht->compare = compare;
+    ht->destroy = destroy;
+    ht->destroy_value = NULL;
+
+    return ht;
+}
+
+HashTable hash_create(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert(hash != NULL);
+    return create(hash, NULL, compare, destroy);
+}
+
+HashTable hash_create_with_capacity(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy, const uint64_t expected)
+{
+    HashTable ht = hash_create(hash, compare, destroy);
+    hash_reserve(ht, expected);
+    ht->rehashes = 0;  // sizing the buckets of a new hash table is not a rehash
+    return ht;
+}
+
+HashTable hash_create64(const HashFunc64 hash, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert(hash != NULL);
+    return create(NULL, hash, compare, destroy);
+}
+
+// turns the hash table into a map
+static HashTable make_map(const HashTable ht, const DestroyFunc destroy_value)
+{
+    ht->values = malloc(sizeof(Pointer) * ht->capacity);  // allocate memory for the values
+    assert(ht->values != NULL);  // allocation failure
+    ht->destroy_value = destroy_value;
+
+    return ht;
+}
+
+HashTable hash_map_create(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy_key, const DestroyFunc destroy_value)
+{
+    return make_map(hash_create(hash, compare, destroy_key), destroy_value);
+}
+
+HashTable hash_map_create64(const HashFunc64 hash, const CompareFunc compare, const DestroyFunc destroy_key, const DestroyFunc destroy_value)
+{
+    return make_map(hash_create64(hash, compare, destroy_key), destroy_value);
+}
+
+uint64_t hash_size(const HashTable ht)
+{
+    assert(ht != NULL);
+    return ht->elements;
+}
+
+bool is_ht_empty(const HashTable ht)
+{
+    assert(ht != NULL);
+    return ht->elements == 0;
+}
+
+// places the element at the bucket pos, moving the elements after it (if needed) further away
+// robin hood: an element takes the bucket of any element closer to its home bucket, which then moves on
+static inline void place(const HashTable ht, uint64_t pos, Pointer data, uint64_t hash_value, uint32_t dist, Pointer value)
+{
+    while (ht->buckets[pos].dist != 0)
+    {
+        if (ht->buckets[pos].dist < dist)  // the element is closer to its home bucket, swap them
+        {
+            const node tmp = ht->buckets[pos];
+            ht->buckets[pos] = (node){ data, hash_value, dist };
+            data = tmp.data;
+            hash_value = tmp.hash_value;
+            dist = tmp.dist;
+
+            if (ht->values != NULL)
+            {
+                const Pointer tmp_value = ht->values[pos];
+                ht->values[pos] = value;
+                value = tmp_value;
+            }
+        }
+        pos = next_bucket(ht, pos);
+        dist++;
+    }
+
+    // empty bucket found
+    ht->buckets[pos] = (node){ data, hash_value, dist };
+    if (ht->values != NULL)
+        ht->values[pos] = value;
+}
+
+static void rehash(const HashTable ht, const uint64_t capacity)
+{
+    // save previous buckets
+    node* old_buckets = ht->buckets;
+    Pointer* old_values = ht->values;
+    const uint64_t old_capacity = ht->capacity;
+
+    allocate_buckets(ht, capacity, old_values != NULL);
+    ht->rehashes++;
+
+    // start rehash operation
+    for (uint64_t i = 0; i < old_capacity; i++)
+    {
+        if (old_buckets[i].dist != 0)
+        {
+            const uint64_t hash_value = old_buckets[i].hash_value;
+            place(ht, home_bucket(ht, hash_value), old_buckets[i].data, hash_value, 1, old_values != NULL ? old_values[i] : NULL);
+        }
+    }
+    free(old_buckets);
+    free(old_values);
+}
+
+// returns the bucket holding the value, inserting it if it does not exist (and setting inserted)
+static inline uint64_t insert_bucket(const HashTable ht, const Pointer value, const uint64_t hash_value, bool* inserted)
+{
+    if ((float)(ht->elements + 1) > MAX_LOAD_FACTOR * ht->capacity)  // max load factor exceeded, start rehash
+        rehash(ht, 2*ht->capacity);
+    
+    uint64_t pos = home_bucket(ht, hash_value);
+
+    // the elements of a bucket are sorted by their distance from their home buckets, so the value
+    // either exists before an element closer to its home bucket than the value would be, or it does not exist
+    uint32_t dist = 1;
+    for (; ht->buckets[pos].dist >= dist; pos = next_bucket(ht, pos), dist++)
+    {
+        // check to see if value already exists in the hash table
+        if (ht->buckets[pos].hash_value == hash_value && ht->compare(ht->buckets[pos].data, value) == 0)
+        {
+            count_lookup(ht, dist);
+            *inserted = false;
+            return pos;
+        }
+    }
+    count_lookup(ht, dist);
+
+    // insert the value at the bucket, moving the rest of the elements
+    place(ht, pos, value, hash_value, dist, NULL);
+    ht->elements++;  // value inserted, increment the number of elements in the hash table
+
+    *inserted = true;
+    return pos;
+}
+
+// inserts the value with the given hash value, returns true if it was inserted
+static inline bool insert_hashed(const HashTable ht, const Pointer value, const uint64_t hash_value)
+{
+    bool inserted;
+    insert_bucket(ht, value, hash_value, &inserted);
+
+    // if the value already exists and a destroy function exists, destroy the value
+    if (!inserted && ht->destroy != NULL)
+        ht->destroy(value);
+
+    return inserted;
+}
+
+bool hash_insert(const HashTable ht, const Pointer value)
+{
+    assert(ht != NULL);
+    return insert_hashed(ht, value, hash_of(ht, value));
+}
+
+Pointer* hash_map_get_or_insert(const HashTable ht, const Pointer key, bool* inserted)
+{
+    assert(ht != NULL && ht->values != NULL && inserted != NULL);
+
+    const uint64_t pos = insert_bucket(ht, key, hash_of(ht, key), inserted);
+
+    // if the key already exists and a destroy function exists, destroy the key
+    if (!(*inserted) && ht->destroy != NULL)
+        ht->destroy(key);
+    
+    return ht->values + pos;
+}
+
+bool hash_map_put(const HashTable ht, const Pointer key, const Pointer value)
+{
+    bool inserted;
+    Pointer* slot = hash_map_get_or_insert(ht, key, &inserted);
+
+    // the key already exists, destroy its old value
+    if (!inserted && ht->destroy_value != NULL && *slot != value)
+        ht->destroy_value(*slot);
+    
+    *slot = value;
+    return inserted;
+}
+
+// returns the bucket in which the value exists
+// if it does not exist, returns the capacity of the hash table
+static inline uint64_t find_bucket(const HashTable ht, const Pointer value, const uint64_t hash_value)
+{
+    // stop at the first element closer to its home bucket than the value would be
+    uint64_t pos = home_bucket(ht, hash_value);
+    uint32_t dist = 1;
+    for (; ht->buckets[pos].dist >= dist; pos = next_bucket(ht, pos), dist++)
+    {
+        if (ht->buckets[pos].hash_value == hash_value && ht->compare(ht->buckets[pos].data, value) == 0)
+        {
+            count_lookup(ht, dist);
+            return pos;
+        }
+    }
+
+    // value does not exist
+    count_lookup(ht, dist);
+    return ht->capacity;
+}
+
+bool hash_remove(const HashTable ht, const Pointer value)
+{
+    if (is_ht_empty(ht))  // empty hash table - nothing to remove
+        return false;
+    
+    // find the potential bucket the value exists in
+    uint64_t pos = find_bucket(ht, value, hash_of(ht, value));
+    if (pos == ht->capacity)  // value does not exist
+        return false;
+
+    // destroy the data, if a destroy function is given
+    if (ht->destroy != NULL)
+        ht->destroy(ht->buckets[pos].data);
+    if (ht->values != NULL && ht->destroy_value != NULL)
+        ht->destroy_value(ht->values[pos]);
+
+    // backward shift: move the following elements, that are not at their home bucket, one bucket back
+    for (uint64_t next = next_bucket(ht, pos); ht->buckets[next].dist > 1; pos = next, next = next_bucket(ht, next))
+    {
+        ht->buckets[pos] = ht->buckets[next];
+        ht->buckets[pos].dist--;
+        if (ht->values != NULL)
+            ht->values[pos] = ht->values[next];
+    }
+    ht->buckets[pos].dist = 0;  // mark the bucket as empty
+    ht->buckets[pos].data = NULL;
+
+    ht->elements--;  // value removed, decrement the number of elements in the hash table
+    return true;
+}
+
+Pointer* hash_map_get(const HashTable ht, const Pointer key)
+{
+    assert(ht != NULL && ht->values != NULL);
+
+    if (is_ht_empty(ht))  // hash table is empty, nothing to search
+        return NULL;
+
+    const uint64_t pos = find_bucket(ht, key, hash_of(ht, key));
+    return pos != ht->capacity ? ht->values + pos : NULL;
+}
+
+bool hash_exists(const HashTable ht, const Pointer value)
+{
+    if (is_ht_empty(ht))  // hash table is empty, nothing to search
+        return false;
+
+    return find_bucket(ht, value, hash_of(ht, value)) != ht->capacity;
+}
+
+Pointer hash_find(const HashTable ht, const Pointer value)
+{
+    if (is_ht_empty(ht))  // hash table is empty, nothing to search
+        return NULL;
+
+    const uint64_t pos = find_bucket(ht, value, hash_of(ht, value));
+    return pos != ht->capacity ? ht->buckets[pos].data : NULL;
+}
+
+// a single search finds either the element or the bucket to insert the value at
+bool hash_get_or_insert(const HashTable ht, const Pointer value, Pointer* existing)
+{
+    assert(ht != NULL && existing != NULL);
+
+    bool inserted;
+    const uint64_t pos = insert_bucket(ht, value, hash_of(ht, value), &inserted);
+    *existing = ht->buckets[pos].data;
+    return inserted;
+}
+
+// sets bit i of the result bitmap (if given) to b
+static inline void set_result(uint64_t* result, const uint64_t i, const bool b)
+{
+    if (result == NULL) return;
+
+    const uint64_t mask = (uint64_t)1 << (i % 64);
+    result[i / 64] = b ? (result[i / 64] | mask) : (result[i / 64] & ~mask);
+}
+
+// computes the hash values of the values [start, end) and prefetches the home bucket of each
+static inline void prefetch_batch(const HashTable ht, const Pointer* values, const uint64_t start, const uint64_t end, uint64_t* hashes)
+{
+    for (uint64_t i = start; i < end; i++)
+    {
+        hashes[i - start] = hash_of(ht, values[i]);
+        __builtin_prefetch(&(ht->buckets[home_bucket(ht, hashes[i - start])]));
+    }
+}
+
+uint64_t hash_exists_many(const HashTable ht, const Pointer* values, const uint64_t n, uint64_t* result)
+{
+    assert(ht != NULL && (values != NULL || n == 0));
+
+    uint64_t found = 0;
+    uint64_t hashes[BATCH_SIZE];
+    for (uint64_t start = 0; start < n; start += BATCH_SIZE)
+    {
+        const uint64_t end = start + BATCH_SIZE < n ? start + BATCH_SIZE : n;
+        prefetch_batch(ht, values, start, end, hashes);
+
+        for (uint64_t i = start; i < end; i++)
+        {
+            const bool exists = !is_ht_empty(ht) && find_bucket(ht, values[i], hashes[i - start]) != ht->capacity;
+            set_result(result, i, exists);
+            found += exists;
+        }
+    }
+    return found;
+}
+
+uint64_t hash_insert_many(const HashTable ht, const Pointer* values, const uint64_t n, uint64_t* result)
+{
+    assert(ht != NULL && (values != NULL || n == 0));
+
+    uint64_t inserted = 0;
+    uint64_t hashes[BATCH_SIZE];
+    for (uint64_t start = 0; start < n; start += BATCH_SIZE)
+    {
+        const uint64_t end = start + BATCH_SIZE < n ? start + BATCH_SIZE : n;
+        prefetch_batch(ht, values, start, end, hashes);
+
+        for (uint64_t i = start; i < end; i++)
+        {
+            const bool ins = insert_hashed(ht, values[i], hashes[i - start]);
+            set_result(result, i, ins);
+            inserted += ins;
+        }
+    }
+    return inserted;
+}
+
+void hash_compact(const HashTable ht)
+{
+    assert(ht != NULL);  // nothing to compact
+}
+
+void hash_reserve(const HashTable ht, const uint64_t n)
+{
+    assert(ht != NULL);
+
+    // the smallest capacity that holds n elements within the max load factor
+    uint64_t capacity = MIN_CAPACITY;
+    while (n > MAX_LOAD_FACTOR * capacity)
+        capacity *= 2;
+
+    if (capacity > ht->capacity)
+        rehash(ht, capacity);
+}
+
+DestroyFunc hash_set_destroy(const HashTable ht, const DestroyFunc new_destroy_func)
+{
+    assert(ht != NULL);
+
+    DestroyFunc old_destroy_func = ht->destroy;
+    ht->destroy = new_destroy_func;
+    return old_destroy_func;
+}
+
+void hash_stats(const HashTable ht, struct ht_stats* stats)
+{
+    assert(ht != NULL && stats != NULL);
+    memset(stats, 0, sizeof(struct ht_stats));
+
+    stats->elements = ht->elements;
+    stats->buckets = ht->capacity;
+    stats->load_factor = (double)ht->elements / ht->capacity;
+    stats->bytes = sizeof(hash_table) + ht->capacity * (sizeof(node) + (ht->values != NULL ? sizeof(Pointer) : 0));
+    stats->rehashes = ht->rehashes;
+    stats->lookups = ht->lookups;
+    stats->probes = ht->probes;
+
+    // an element is found after dist probes
+    for (uint64_t i = 0; i < ht->capacity; i++)
+    {
+        const uint32_t dist = ht->buckets[i].dist;
+        if (dist != 0)
+            stats->histogram[dist < HT_HISTOGRAM_SIZE ? dist : HT_HISTOGRAM_SIZE - 1]++;
+    }
+}
+
+// a scan cursor keeps the bucket to continue from, along with the (low 16 bits of the) number of rehashes when it was
+// returned, so a cursor to buckets that have been reallocated since then starts over
+#define CURSOR_POS_BITS 48
+#define make_cursor(ht, pos) (((ht)->rehashes << CURSOR_POS_BITS) | (pos))
+#define cursor_pos(ht, cursor) \
+    ((cursor) >> CURSOR_POS_BITS == ((ht)->rehashes & 0xFFFF) ? (cursor) & ((1ull << CURSOR_POS_BITS) - 1) : 0)
+
+void hash_foreach(const HashTable ht, void (*visit)(Pointer value, void* context), void* context)
+{
+    assert(ht != NULL && visit != NULL);
+
+    for (uint64_t i = 0; i < ht->capacity; i++)
+        if (ht->buckets[i].dist != 0) visit(ht->buckets[i].data, context);
+}
+
+// moves the iterator to the first element from bucket pos onwards and returns it, NULL if there is none
+static inline Pointer iter_seek(hash_iter* it, uint64_t pos)
+{
+    const HashTable ht = it->ht;
+    while (pos < ht->capacity && ht->buckets[pos].dist == 0) pos++;
+
+    it->pos = pos;
+    return pos < ht->capacity ? ht->buckets[pos].data : NULL;
+}
+
+Pointer hash_iter_begin(const HashTable ht, hash_iter* it)
+{
+    assert(ht != NULL && it != NULL);
+
+    it->ht = ht;
+    it->node = NULL;
+    return iter_seek(it, 0);
+}
+
+Pointer hash_iter_next(hash_iter* it)
+{
+    assert(it != NULL && it->ht != NULL);
+    return it->pos < it->ht->capacity ? iter_seek(it, it->pos + 1) : NULL;
+}
+
+Pointer* hash_iter_value(const hash_iter* it)
+{
+    assert(it != NULL && it->ht->values != NULL && it->pos < it->ht->capacity);
+    return &(it->ht->values[it->pos]);
+}
+
+// the elements never move before their home bucket: removals move the elements after the removed one a bucket back,
+// but only within a run of (non empty) buckets, so a call continues up to an empty bucket and the home buckets of the
+// elements after the cursor are not before it
+// elements that wrap around to the first buckets, past the end, are visited (again) by the last call
+uint64_t hash_scan(const HashTable ht, const uint64_t cursor, const uint64_t count, void (*visit)(Pointer value, void* context), void* context)
+{
+    assert(ht != NULL && visit != NULL && count != 0);
+
+    uint64_t pos = cursor_pos(ht, cursor);
+    for (const uint64_t end = pos + count; pos < ht->capacity && (pos < end || ht->buckets[pos].dist != 0); pos++)
+        if (ht->buckets[pos].dist != 0) visit(ht->buckets[pos].data, context);
+
+    if (pos < ht->capacity)
+        return make_cursor(ht, pos);
+
+    // the elements at the start whose home bucket is after their bucket
+    for (pos = 0; pos < ht->capacity && ht->buckets[pos].dist > pos + 1; pos++)
+        visit(ht->buckets[pos].data, context);
+    return 0;
+}
+
+void hash_destroy(const HashTable ht)
+{
+    assert(ht != NULL);
+
+    // if a destroy function exists & there are elements, destroy the data (and values)
+    const DestroyFunc destroy_value = ht->values != NULL ? ht->destroy_value : NULL;
+    if ((ht->destroy != NULL || destroy_value != NULL) && ht->elements != 0)
+    {
+        for (uint64_t i = 0; i < ht->capacity; i++)
+        {
+            if (ht->buckets[i].dist != 0)
+            {
+                if (ht->destroy != NULL) ht->destroy(ht->buckets[i].data);
+                if (destroy_value != NULL) destroy_value(ht->values[i]);
+            }
+        }
+    }
+    
+    free(ht->buckets);
+    free(ht->values);
+    free(ht);
+}
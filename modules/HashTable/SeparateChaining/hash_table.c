@@ -1,17 +1,34 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <stdatomic.h>
+#include <pthread.h>
 #include "hash_table.h"
 
 // when max load factor is exceeded, rehashing operation occurs
 #define MAX_LOAD_FACTOR 0.8
 
+// number of values the batch operations process together
+#define BATCH_SIZE 16
+
+// rehashing is incremental: every insertion and removal moves this many buckets to the new buckets
+// the old buckets are emptied long before the new ones exceed the max load factor
+#define REHASH_STEP 16
+
+// a concurrent hash table is split into this many shards (a power of 2), each with its own lock
+#define SHARD_BITS 6
+#define NUM_OF_SHARDS (1 << SHARD_BITS)
+
+#define CACHE_LINE 64
+
 // bucket
 typedef struct node
 {
     Pointer data;         // pointer to the data we are storing
-    uint32_t hash_value;  // hash value of the data
+    uint64_t hash_value;  // hash value of the data
     struct node* next;    // next element in the bucket (NULL if it's the last)
+    Pointer value[];      // value associated with the data, only allocated in map mode
 }
 node;
 
@@ -19,13 +36,43 @@ typedef struct hash_table
 {
     node** buckets;       // buckets (lists) storing the data
     uint8_t capacity;     // the capacity of the hash table - index to the "hash_sizes" array
+    uint64_t recip;       // reciprocal of the capacity, used to find the buckets without divisions
+    node** old_buckets;   // buckets of the previous capacity while rehashing, NULL if not rehashing
+    uint64_t old_recip;   // reciprocal of the previous capacity
+    uint64_t rehash_index;  // the old buckets before this index have been moved to the new ones
     uint64_t elements;    // number of elements in the hash table
     HashFunc hash;        // function that hashes an element into a positive integer
+    HashFunc64 hash64;    // function that hashes an element into a 64-bit integer, used instead of hash if given
     CompareFunc compare;  // function that compares the elements
     DestroyFunc destroy;  // function that destroys the elements, NULL if not
+    DestroyFunc destroy_value;  // function that destroys the values in map mode, NULL if not
+    bool is_map;                // true if every element (key) is associated with a value
+    struct concurrent* concurrent;  // shards of a concurrent hash table, NULL if not concurrent
+    uint64_t rehashes;    // number of rehashes
+    uint64_t lookups;     // number of searches (counted with HT_PROBE_STATS)
+    uint64_t probes;      // number of nodes checked by the searches (counted with HT_PROBE_STATS)
 }
 hash_table;
 
+// shard of a concurrent hash table: a hash table of its own, protected by a read-write lock
+// every shard has its own cache line(s), so that threads using different shards do not slow each other down
+typedef struct shard
+{
+    pthread_rwlock_t lock;
+    HashTable ht;
+}
+__attribute__((aligned(CACHE_LINE))) shard;
+
+typedef struct concurrent
+{
+    shard shards[NUM_OF_SHARDS];
+    atomic_uint_fast64_t elements;  // number of elements, updated while holding the lock of the shard that changed
+}
+concurrent;
+
+// the shard of a hash value, found by the high bits of its low 32 bits after a multiplication so that it does not depend on the bucket
+#define get_shard(ht, hash_value) (&((ht)->concurrent->shards[(uint32_t)((hash_value) * 0x9E3779B9u) >> (32 - SHARD_BITS)]))
+
 // available number of buckets, preferably prime numbers since it has been proven they have better behavior
 static uint64_t hash_sizes[] =
     { 67, 131, 263, 509, 1021, 2053, 4093, 8179, 16369, 32749, 65521, 131071, 262147, 524287, 1048573, 2097143,
@@ -36,26 +83,117 @@ static uint64_t hash_sizes[] =
     144115188075855859, 288230376151711717, 576460752303423433, 1152921504606846883, 2305843009213693951, 4611686018427387847 };
 
 #define get_hash(i) (hash_sizes[i])
+#define LAST_SIZE ((uint8_t)(sizeof(hash_sizes) / sizeof(hash_sizes[0]) - 1))
+
+// fast modulo (Lemire et al., "Faster Remainder by Direct Computation")
+// hash % size is computed with multiplications, using the precomputed reciprocal of the size
+// for 32-bit hash values, sizes that do not fit in 32 bits (reciprocal 0) leave them as they are
+#define reciprocal(size) ((size) <= UINT32_MAX ? UINT64_MAX / (size) + 1 : 0)
+
+static inline uint32_t fast_mod(const uint32_t hash_value, const uint64_t recip, const uint64_t size)
+{
+    if (recip == 0) return hash_value;
+    return (uint32_t)(((__uint128_t)(recip * hash_value) * size) >> 64);
+}
+
+// 64-bit hash values are mapped to [0, size) by the high bits of hash_value * size (Lemire's "fastrange")
+// it needs no reciprocal and reaches every bucket of any size, but it relies on the high bits of the hash values
+// being well mixed, so it is only used for the 64-bit hash functions (32-bit ones use the exact modulo)
+static inline uint64_t fast_range(const uint64_t hash_value, const uint64_t size)
+{
+    return (uint64_t)(((__uint128_t)hash_value * size) >> 64);
+}
+
+#define hash_of(ht, value) ((ht)->hash64 != NULL ? (ht)->hash64(value) : (uint64_t)(ht)->hash(value))
+#define map_hash(ht, hash_value, recip, size) \
+    ((ht)->hash64 != NULL ? fast_range(hash_value, size) : fast_mod((uint32_t)(hash_value), recip, size))
+
+#define get_bucket(ht, hash_value) map_hash(ht, hash_value, (ht)->recip, get_hash((ht)->capacity))
+#define get_old_bucket(ht, hash_value) map_hash(ht, hash_value, (ht)->old_recip, get_hash((ht)->capacity-1))
+
+#define is_rehashing(ht) ((ht)->old_buckets != NULL)
+
+// counts a search that checked the given number of nodes
+// the searches of a concurrent hash table share the lock of the shard, so the counters are updated atomically
+#ifdef HT_PROBE_STATS
+#define count_lookup(ht, checked) (__atomic_fetch_add(&(ht)->lookups, 1, __ATOMIC_RELAXED), \
+                                   __atomic_fetch_add(&(ht)->probes, (checked), __ATOMIC_RELAXED))
+#else
+#define count_lookup(ht, checked) ((void)0)
+#endif
 
 // function prototypes
 static inline void rehash(const HashTable ht);
-static inline bool hash_search(const HashTable ht, const Pointer value, uint32_t* hash_value);
-
-HashTable hash_create(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy)
+static void rehash_step(const HashTable ht);
+static inline node* hash_search(const HashTable ht, const Pointer value, uint64_t* hash_value);
+static inline node* find_node(const HashTable ht, const Pointer value, const uint64_t hash_value);
+static bool concurrent_insert(const HashTable ht, const Pointer value, const uint64_t hash_value);
+static bool concurrent_remove(const HashTable ht, const Pointer value, const uint64_t hash_value);
+static bool concurrent_exists(const HashTable ht, const Pointer value, const uint64_t hash_value);
+static Pointer concurrent_find(const HashTable ht, const Pointer value, const uint64_t hash_value);
+static bool concurrent_get_or_insert(const HashTable ht, const Pointer value, const uint64_t hash_value, Pointer* existing);
+
+// creates the hash table with the hash function, or the 64-bit one, that is given
+static HashTable create(const HashFunc hash, const HashFunc64 hash64, const CompareFunc compare, const DestroyFunc destroy)
 {
-    assert(hash != NULL && compare != NULL);  // a hash and compare function needs to be given
+    assert((hash != NULL || hash64 != NULL) && compare != NULL);  // a hash and compare function needs to be given
     
     HashTable ht = malloc(sizeof(hash_table));
     assert(ht != NULL);  // allocation failure
 
     ht->capacity = 0;
+    ht->recip = reciprocal(get_hash(ht->capacity));
     ht->buckets = calloc(sizeof(node), get_hash(ht->capacity));  // allocate memory for the buckets
     assert(ht->buckets != NULL);  // allocation failure
+    ht->old_buckets = NULL;
 
     ht->elements = 0;
     ht->hash = hash;
+    ht->hash64 = hash64;
     ht->compare = compare;
     ht->destroy = destroy;
+    ht->destroy_value = NULL;
+    ht->is_map = false;
+    ht->concurrent = NULL;
+    ht->rehashes = ht->lookups = ht->probes = 0;
+
+    return ht;
+}
+
+HashTable hash_create(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert(hash != NULL);
+    return create(hash, NULL, compare, destroy);
+}
+
+HashTable hash_create_with_capacity(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy, const uint64_t expected)
+{
+    HashTable ht = hash_create(hash, compare, destroy);
+    hash_reserve(ht, expected);
+    ht->rehashes = 0;  // sizing the buckets of a new hash table is not a rehash
+    return ht;
+}
+
+HashTable hash_create64(const HashFunc64 hash, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert(hash != NULL);
+    return create(NULL, hash, compare, destroy);
+}
+
+HashTable hash_map_create(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy_key, const DestroyFunc destroy_value)
+{
+    HashTable ht = hash_create(hash, compare, destroy_key);
+    ht->destroy_value = destroy_value;
+    ht->is_map = true;
+
+    return ht;
+}
+
+HashTable hash_map_create64(const HashFunc64 hash, const CompareFunc compare, const DestroyFunc destroy_key, const DestroyFunc destroy_value)
+{
+    HashTable ht = hash_create64(hash, compare, destroy_key);
+    ht->destroy_value = destroy_value;
+    ht->is_map = true;
 
     return ht;
 }
@@ -63,174 +201,799 @@ HashTable hash_create(const HashFunc hash, const CompareFunc compare, const Dest
 uint64_t hash_size(const HashTable ht)
 {
     assert(ht != NULL);
+    if (ht->concurrent != NULL)
+        return atomic_load(&ht->concurrent->elements);
+    
     return ht->elements;
 }
 
 bool is_ht_empty(const HashTable ht)
 {
-    assert(ht != NULL);
-    return ht->elements == 0;
+    return hash_size(ht) == 0;
 }
 
-bool hash_insert(const HashTable ht, const Pointer value)
+// inserts the value, that does not exist, with the given hash value and returns its node
+static inline node* insert_node(const HashTable ht, const Pointer value, const uint64_t hash_value)
 {
-    // check to see if value already exists in the hash table
-    uint32_t hash_value = 0;
-    if (hash_search(ht, value, &hash_value))  // value already exists
-    {
-        if (ht->destroy != NULL) ht->destroy(value);
-        return false;
-    }
-
-    if (((float)ht->elements / get_hash(ht->capacity)) > MAX_LOAD_FACTOR)  // max load factor exceeded, try to rehash
+    if (is_rehashing(ht))  // continue rehashing
+        rehash_step(ht);
+    else if (((float)ht->elements / get_hash(ht->capacity)) > MAX_LOAD_FACTOR)  // max load factor exceeded, try to rehash
     {
-        if (get_hash(ht->capacity) != hash_sizes[sizeof(hash_sizes) / sizeof(hash_sizes[0]) - 1])  // if a new, available, size exists
+        if (ht->capacity != LAST_SIZE)  // if a new, available, size exists
             rehash(ht);  // rehash
     }
     
-    // insert value
-    node* new_node = malloc(sizeof(node));
+    // insert value, with room for a (NULL) value in map mode
+    node* new_node = malloc(sizeof(node) + (ht->is_map ? sizeof(Pointer) : 0));
     assert(new_node != NULL);  // allocation failure
 
     // fill the node's contents
     new_node->data = value;
     new_node->hash_value = hash_value;
+    if (ht->is_map)
+        new_node->value[0] = NULL;
 
     // insert value at the start of the bucket
-    const uint32_t bucket = hash_value % get_hash(ht->capacity);
+    const uint64_t bucket = get_bucket(ht, hash_value);
     new_node->next = ht->buckets[bucket];
     ht->buckets[bucket] = new_node;
 
     ht->elements++;  // value inserted, increment the number of elements in the hash table
+    return new_node;
+}
+
+// inserts the value with the given hash value, returns true if it was inserted
+static inline bool insert_hashed(const HashTable ht, const Pointer value, const uint64_t hash_value)
+{
+    // check to see if value already exists in the hash table
+    if (find_node(ht, value, hash_value) != NULL)  // value already exists
+    {
+        if (ht->destroy != NULL) ht->destroy(value);
+        return false;
+    }
+
+    insert_node(ht, value, hash_value);
     return true;
 }
 
+bool hash_insert(const HashTable ht, const Pointer value)
+{
+    if (ht->concurrent != NULL)
+        return concurrent_insert(ht, value, hash_of(ht, value));
+    
+    return insert_hashed(ht, value, hash_of(ht, value));
+}
+
+Pointer* hash_map_get_or_insert(const HashTable ht, const Pointer key, bool* inserted)
+{
+    assert(ht != NULL && ht->is_map && inserted != NULL);
+
+    // a single hash for both the search and the insertion
+    uint64_t hash_value = 0;
+    node* bkt = hash_search(ht, key, &hash_value);
+
+    if (bkt != NULL)  // key already exists
+    {
+        if (ht->destroy != NULL) ht->destroy(key);
+        *inserted = false;
+        return bkt->value;
+    }
+
+    *inserted = true;
+    return insert_node(ht, key, hash_value)->value;
+}
+
+bool hash_map_put(const HashTable ht, const Pointer key, const Pointer value)
+{
+    bool inserted;
+    Pointer* slot = hash_map_get_or_insert(ht, key, &inserted);
+
+    // the key already exists, destroy its old value
+    if (!inserted && ht->destroy_value != NULL && *slot != value)
+        ht->destroy_value(*slot);
+    
+    *slot = value;
+    return inserted;
+}
+
+Pointer* hash_map_get(const HashTable ht, const Pointer key)
+{
+    assert(ht != NULL && ht->is_map);
+
+    uint64_t hash_value = 0;
+    node* bkt = hash_search(ht, key, &hash_value);
+    return bkt != NULL ? bkt->value : NULL;
+}
+
+// starts rehashing, the elements are moved to the new buckets a few buckets at a time
 static inline void rehash(HashTable ht)
 {
-    node** old_buckets = ht->buckets;  // save previous buckets
+    // save previous buckets
+    ht->old_buckets = ht->buckets;
+    ht->old_recip = ht->recip;
+    ht->rehash_index = 0;
 
-    uint8_t old_capacity = ht->capacity;
     (ht->capacity)++;  // get the next size
+    ht->recip = reciprocal(get_hash(ht->capacity));
+    ht->rehashes++;
 
     // create the new number of buckets
     ht->buckets = calloc(sizeof(node), get_hash(ht->capacity));
     assert(ht->buckets != NULL);  // allocation failure
+}
 
-    // start rehash operation
-    for (uint64_t i = 0; i < get_hash(old_capacity); i++)
+// moves the nodes of an old bucket to the new buckets
+static inline void move_chain(const HashTable ht, node* bkt)
+{
+    while (bkt != NULL)
     {
-        node* bkt = old_buckets[i];
-    
-        while (bkt != NULL)
+        node* next = bkt->next;
+        
+        // reuse the bucket
+        const uint64_t bucket = get_bucket(ht, bkt->hash_value);
+        bkt->next = ht->buckets[bucket];
+        ht->buckets[bucket] = bkt;
+
+        bkt = next;
+    }
+}
+
+// moves the next few old buckets to the new buckets
+static void rehash_step(const HashTable ht)
+{
+    const uint64_t old_size = get_hash(ht->capacity-1);
+
+    for (uint32_t i = 0; i < REHASH_STEP && ht->rehash_index < old_size; i++, ht->rehash_index++)
+        move_chain(ht, ht->old_buckets[ht->rehash_index]);
+
+    if (ht->rehash_index == old_size)  // all buckets moved, rehashing is complete
+    {
+        free(ht->old_buckets);
+        ht->old_buckets = NULL;
+    }
+}
+
+// returns the address of the link to the node holding the value, NULL if it does not exist
+// while rehashing, the value may still be in the old buckets
+static inline node** find_link(const HashTable ht, const Pointer value, const uint64_t hash_value)
+{
+    uint64_t checked = 0;  // number of nodes checked
+
+    // search for the value in the bucket
+    for (node** bkt = &(ht->buckets[get_bucket(ht, hash_value)]); *bkt != NULL; bkt = &((*bkt)->next))
+    {
+        checked++;
+        if ((*bkt)->hash_value == hash_value && ht->compare(value, (*bkt)->data) == 0)  // value found
         {
-            node* next = bkt->next;
-            
-            // reuse the bucket
-            const uint32_t bucket = bkt->hash_value % get_hash(ht->capacity);
-            bkt->next = ht->buckets[bucket];
-            ht->buckets[bucket] = bkt;
+            count_lookup(ht, checked);
+            return bkt;
+        }
+    }
 
-            bkt = next;
+    // while rehashing, the value may be in an old bucket that has not been moved yet
+    if (is_rehashing(ht) && get_old_bucket(ht, hash_value) >= ht->rehash_index)
+    {
+        for (node** bkt = &(ht->old_buckets[get_old_bucket(ht, hash_value)]); *bkt != NULL; bkt = &((*bkt)->next))
+        {
+            checked++;
+            if ((*bkt)->hash_value == hash_value && ht->compare(value, (*bkt)->data) == 0)  // value found
+            {
+                count_lookup(ht, checked);
+                return bkt;
+            }
         }
     }
-    free(old_buckets);
+
+    count_lookup(ht, checked);
+    return NULL;
 }
 
-bool hash_remove(const HashTable ht, const Pointer value)
+// removes the value with the given hash value, returns true if it was removed
+static inline bool remove_hashed(const HashTable ht, const Pointer value, const uint64_t hash_value)
 {
     if (is_ht_empty(ht))  // hash table is empty, nothing to search
         return false;
     
-    // hash to the find the potential bucket the value belongs to
-    uint32_t hash_value = ht->hash(value) % get_hash(ht->capacity);
+    if (is_rehashing(ht))  // continue rehashing
+        rehash_step(ht);
+    
+    // search the bucket the value belongs to
+    node** bkt = find_link(ht, value, hash_value);
+    if (bkt == NULL)  // value does not exist
+        return false;
+    
+    node* tmp = *bkt;
+    (*bkt) = (*bkt)->next;
+
+    // if a destroy function exists, destroy the value
+    if (ht->destroy != NULL)
+        ht->destroy(tmp->data);
+    if (ht->is_map && ht->destroy_value != NULL)
+        ht->destroy_value(tmp->value[0]);
+    
+    free(tmp);
+    ht->elements--;  // value removed, decrement the number of elements in the hash table
+    return true;
+}
+
+bool hash_remove(const HashTable ht, const Pointer value)
+{
+    if (ht->concurrent != NULL)
+        return concurrent_remove(ht, value, hash_of(ht, value));
+    
+    return remove_hashed(ht, value, hash_of(ht, value));
+}
+
+bool hash_exists(const HashTable ht, const Pointer value)
+{
+    if (ht->concurrent != NULL)
+        return concurrent_exists(ht, value, hash_of(ht, value));
+    
+    uint64_t tmp = 0;
+    return hash_search(ht, value, &tmp) != NULL;
+}
+
+Pointer hash_find(const HashTable ht, const Pointer value)
+{
+    if (ht->concurrent != NULL)
+        return concurrent_find(ht, value, hash_of(ht, value));
+
+    uint64_t tmp = 0;
+    node* bkt = hash_search(ht, value, &tmp);
+    return bkt != NULL ? bkt->data : NULL;
+}
+
+// returns the node holding the value, inserting the value if it does not exist (and setting inserted)
+static inline node* get_or_insert_node(const HashTable ht, const Pointer value, const uint64_t hash_value, bool* inserted)
+{
+    node* bkt = find_node(ht, value, hash_value);
+    *inserted = bkt == NULL;
+    return bkt != NULL ? bkt : insert_node(ht, value, hash_value);
+}
 
-    node** bkt = &(ht->buckets[hash_value]);
+bool hash_get_or_insert(const HashTable ht, const Pointer value, Pointer* existing)
+{
+    assert(ht != NULL && existing != NULL);
+
+    // a single hash for both the search and the insertion
+    const uint64_t hash_value = hash_of(ht, value);
+    if (ht->concurrent != NULL)
+        return concurrent_get_or_insert(ht, value, hash_value, existing);
+
+    bool inserted;
+    *existing = get_or_insert_node(ht, value, hash_value, &inserted)->data;
+    return inserted;
+}
+
+// sets bit i of the result bitmap (if given) to b
+static inline void set_result(uint64_t* result, const uint64_t i, const bool b)
+{
+    if (result == NULL) return;
+
+    const uint64_t mask = (uint64_t)1 << (i % 64);
+    result[i / 64] = b ? (result[i / 64] | mask) : (result[i / 64] & ~mask);
+}
+
+// computes the hash values of the values [start, end) and prefetches their buckets, along with the first node of each bucket
+static inline void prefetch_batch(const HashTable ht, const Pointer* values, const uint64_t start, const uint64_t end, uint64_t* hashes)
+{
+    for (uint64_t i = start; i < end; i++)
+    {
+        hashes[i - start] = hash_of(ht, values[i]);
+        __builtin_prefetch(&(ht->buckets[get_bucket(ht, hashes[i - start])]));
+        if (is_rehashing(ht))
+            __builtin_prefetch(&(ht->old_buckets[get_old_bucket(ht, hashes[i - start])]));
+    }
     
-    // search the bucket for the value
-    while (*bkt != NULL)
+    // the buckets have been requested, their first nodes can be requested as well
+    for (uint64_t i = start; i < end; i++)
+        __builtin_prefetch(ht->buckets[get_bucket(ht, hashes[i - start])]);
+}
+
+uint64_t hash_exists_many(const HashTable ht, const Pointer* values, const uint64_t n, uint64_t* result)
+{
+    assert(ht != NULL && (values != NULL || n == 0));
+
+    uint64_t found = 0;
+    if (ht->concurrent != NULL)  // the values belong to different shards, search them one by one
     {
-        Pointer bkt_value = (*bkt)->data;
-        
-        if (ht->compare(value, bkt_value) == 0)  // value found
+        for (uint64_t i = 0; i < n; i++)
         {
-            node* tmp = *bkt;
-            (*bkt) = (*bkt)->next;
+            const bool exists = hash_exists(ht, values[i]);
+            set_result(result, i, exists);
+            found += exists;
+        }
+        return found;
+    }
 
-            // if a destroy function exists, destroy the value
-            if (ht->destroy != NULL)
-                ht->destroy(tmp->data);
-            
-            free(tmp);
-            ht->elements--;  // value removed, decrement the number of elements in the hash table
-            return true;
+    uint64_t hashes[BATCH_SIZE];
+    for (uint64_t start = 0; start < n; start += BATCH_SIZE)
+    {
+        const uint64_t end = start + BATCH_SIZE < n ? start + BATCH_SIZE : n;
+        prefetch_batch(ht, values, start, end, hashes);
+
+        for (uint64_t i = start; i < end; i++)
+        {
+            const bool exists = find_node(ht, values[i], hashes[i - start]) != NULL;
+            set_result(result, i, exists);
+            found += exists;
         }
-        else  // search next value
-            bkt = &((*bkt)->next);
     }
-    return false;
+    return found;
 }
 
-bool hash_exists(const HashTable ht, const Pointer value)
+uint64_t hash_insert_many(const HashTable ht, const Pointer* values, const uint64_t n, uint64_t* result)
 {
-    uint32_t tmp = 0;
-    return hash_search(ht, value, &tmp);
+    assert(ht != NULL && (values != NULL || n == 0));
+
+    uint64_t inserted = 0;
+    if (ht->concurrent != NULL)  // the values belong to different shards, insert them one by one
+    {
+        for (uint64_t i = 0; i < n; i++)
+        {
+            const bool ins = hash_insert(ht, values[i]);
+            set_result(result, i, ins);
+            inserted += ins;
+        }
+        return inserted;
+    }
+
+    uint64_t hashes[BATCH_SIZE];
+    for (uint64_t start = 0; start < n; start += BATCH_SIZE)
+    {
+        const uint64_t end = start + BATCH_SIZE < n ? start + BATCH_SIZE : n;
+        prefetch_batch(ht, values, start, end, hashes);
+
+        for (uint64_t i = start; i < end; i++)
+        {
+            const bool ins = insert_hashed(ht, values[i], hashes[i - start]);
+            set_result(result, i, ins);
+            inserted += ins;
+        }
+    }
+    return inserted;
 }
 
-static inline bool hash_search(const HashTable ht, const Pointer value, uint32_t* hash_value)
+// returns the node holding the value, with the given hash value, NULL if it does not exist
+static inline node* find_node(const HashTable ht, const Pointer value, const uint64_t hash_value)
 {
-    *hash_value = ht->hash(value);
     if (is_ht_empty(ht))  // hash table is empty, nothing to search
-        return false;
+        return NULL;
     
-    node* bkt = ht->buckets[*hash_value % get_hash(ht->capacity)];
-    
-    // search for the value in the bucket h
-    while (bkt != NULL)
+    node** bkt = find_link(ht, value, hash_value);
+    return bkt != NULL ? *bkt : NULL;
+}
+
+// returns the node holding the value, NULL if it does not exist
+static inline node* hash_search(const HashTable ht, const Pointer value, uint64_t* hash_value)
+{
+    *hash_value = hash_of(ht, value);
+    return find_node(ht, value, *hash_value);
+}
+
+void hash_compact(const HashTable ht)
+{
+    assert(ht != NULL);  // nothing to compact
+}
+
+// returns the smallest capacity (index to the "hash_sizes" array) that holds n elements within the max load factor
+static inline uint8_t capacity_for(const uint64_t n)
+{
+    uint8_t capacity = 0;
+    while (n > MAX_LOAD_FACTOR * get_hash(capacity) && capacity != LAST_SIZE)
+        capacity++;
+    return capacity;
+}
+
+// moves every element to the buckets of the given capacity at once (completing a rehash in progress first)
+static void resize(const HashTable ht, const uint8_t capacity)
+{
+    while (is_rehashing(ht))
+        rehash_step(ht);
+
+    node** old_buckets = ht->buckets;
+    const uint64_t old_size = get_hash(ht->capacity);
+
+    ht->capacity = capacity;
+    ht->recip = reciprocal(get_hash(capacity));
+    ht->rehashes++;
+
+    ht->buckets = calloc(sizeof(node*), get_hash(capacity));
+    assert(ht->buckets != NULL);  // allocation failure
+
+    for (uint64_t i = 0; i < old_size; i++)
+        move_chain(ht, old_buckets[i]);
+    free(old_buckets);
+}
+
+void hash_reserve(const HashTable ht, const uint64_t n)
+{
+    assert(ht != NULL);
+
+    if (ht->concurrent != NULL)  // every shard gets its part, with some room since they are not filled evenly
     {
-        Pointer bkt_value = bkt->data;
-        if (ht->compare(value, bkt_value) == 0)  // value found
-            return true;
-        
-        bkt = bkt->next;
+        for (uint32_t i = 0; i < NUM_OF_SHARDS; i++)
+        {
+            shard* s = &(ht->concurrent->shards[i]);
+            pthread_rwlock_wrlock(&s->lock);
+            hash_reserve(s->ht, n / NUM_OF_SHARDS + n / NUM_OF_SHARDS / 8);
+            pthread_rwlock_unlock(&s->lock);
+        }
+        return;
     }
 
-    return false;
+    const uint8_t capacity = capacity_for(n);
+    if (capacity > ht->capacity)
+        resize(ht, capacity);
 }
 
 DestroyFunc hash_set_destroy(const HashTable ht, const DestroyFunc new_destroy_func)
 {
     assert(ht != NULL);
 
+    if (ht->concurrent != NULL)  // the shards destroy the elements
+    {
+        for (uint32_t i = 0; i < NUM_OF_SHARDS; i++)
+        {
+            shard* s = &(ht->concurrent->shards[i]);
+            pthread_rwlock_wrlock(&s->lock);
+            hash_set_destroy(s->ht, new_destroy_func);
+            pthread_rwlock_unlock(&s->lock);
+        }
+    }
+
     DestroyFunc old_destroy_func = ht->destroy;
     ht->destroy = new_destroy_func;
     return old_destroy_func;
 }
 
+// destroys the nodes of the buckets [start, end) and returns their number
+static uint64_t destroy_buckets(const HashTable ht, node** buckets, const uint64_t start, const uint64_t end)
+{
+    uint64_t destroyed = 0;
+    for (uint64_t i = start; i < end && destroyed < ht->elements; i++)
+    {
+        node* bkt = buckets[i];
+        while (bkt != NULL)
+        {
+            node* tmp = bkt;
+            bkt = bkt->next;
+
+            // if a destroy function exists, destroy the data
+            if (ht->destroy != NULL)  ht->destroy(tmp->data);
+            if (ht->is_map && ht->destroy_value != NULL)  ht->destroy_value(tmp->value[0]);
+            
+            free(tmp);
+            destroyed++;
+        }
+    }
+    return destroyed;
+}
+
 void hash_destroy(const HashTable ht)
 {
     assert(ht != NULL);
 
-    // destroy the buckets
-    if (ht->elements != 0)
+    if (ht->concurrent != NULL)  // destroy the shards
     {
-        for (uint64_t i = 0 ;; i++)
+        for (uint32_t i = 0; i < NUM_OF_SHARDS; i++)
         {
-            node* bkt = ht->buckets[i];
-            while (bkt != NULL)
-            {
-                node* tmp = bkt;
-                bkt = bkt->next;
-
-                // if a destroy function exists, destroy the data
-                if (ht->destroy != NULL)  ht->destroy(tmp->data);
-                
-                free(tmp);
-                --(ht->elements);
-            }
-            if (ht->elements == 0) break;  // all elements deleted
+            hash_destroy(ht->concurrent->shards[i].ht);
+            pthread_rwlock_destroy(&(ht->concurrent->shards[i].lock));
         }
+        free(ht->concurrent);
+        free(ht);
+        return;
     }
+
+    // destroy the buckets, as well as the old ones that have not been moved yet
+    if (is_rehashing(ht))
+    {
+        ht->elements -= destroy_buckets(ht, ht->old_buckets, ht->rehash_index, get_hash(ht->capacity-1));
+        free(ht->old_buckets);
+    }
+    destroy_buckets(ht, ht->buckets, 0, get_hash(ht->capacity));
     
     free(ht->buckets);
     free(ht);
 }
+
+// adds the chain lengths of the buckets [start, end) to the histogram
+static void add_chains(node** buckets, const uint64_t start, const uint64_t end, uint64_t* histogram)
+{
+    for (uint64_t i = start; i < end; i++)
+    {
+        uint64_t length = 0;
+        for (node* bkt = buckets[i]; bkt != NULL; bkt = bkt->next)
+            length++;
+        histogram[length < HT_HISTOGRAM_SIZE ? length : HT_HISTOGRAM_SIZE - 1]++;
+    }
+}
+
+// adds the statistics of the hash table (its own buckets, not its shards') to stats
+static void add_stats(const HashTable ht, struct ht_stats* stats)
+{
+    stats->elements += ht->elements;
+    stats->buckets += get_hash(ht->capacity);
+    stats->bytes += sizeof(hash_table) + sizeof(node*) * get_hash(ht->capacity) +
+                    ht->elements * (sizeof(node) + (ht->is_map ? sizeof(Pointer) : 0));
+    stats->rehashes += ht->rehashes;
+    stats->lookups += __atomic_load_n(&ht->lookups, __ATOMIC_RELAXED);
+    stats->probes += __atomic_load_n(&ht->probes, __ATOMIC_RELAXED);
+
+    add_chains(ht->buckets, 0, get_hash(ht->capacity), stats->histogram);
+    if (is_rehashing(ht))  // the old buckets are allocated until rehashing completes
+    {
+        stats->bytes += sizeof(node*) * get_hash(ht->capacity-1);
+        add_chains(ht->old_buckets, ht->rehash_index, get_hash(ht->capacity-1), stats->histogram);
+    }
+}
+
+void hash_stats(const HashTable ht, struct ht_stats* stats)
+{
+    assert(ht != NULL && stats != NULL);
+    memset(stats, 0, sizeof(struct ht_stats));
+
+    if (ht->concurrent == NULL)
+        add_stats(ht, stats);
+    else  // the elements are at the shards, the hash table itself has no buckets
+    {
+        stats->bytes += sizeof(hash_table) + sizeof(concurrent);
+        for (uint32_t i = 0; i < NUM_OF_SHARDS; i++)
+        {
+            shard* s = &(ht->concurrent->shards[i]);
+            pthread_rwlock_rdlock(&s->lock);
+            add_stats(s->ht, stats);
+            pthread_rwlock_unlock(&s->lock);
+        }
+    }
+
+    stats->load_factor = (double)stats->elements / stats->buckets;
+}
+
+// a scan cursor keeps the bucket to continue from, along with the (low 16 bits of the) number of rehashes when it was
+// returned, so a cursor to buckets that have been reallocated since then starts over
+#define CURSOR_POS_BITS 48
+#define make_cursor(ht, pos) (((ht)->rehashes << CURSOR_POS_BITS) | (pos))
+#define cursor_pos(ht, cursor) \
+    ((cursor) >> CURSOR_POS_BITS == ((ht)->rehashes & 0xFFFF) ? (cursor) & ((1ull << CURSOR_POS_BITS) - 1) : 0)
+
+// a scan cursor of a concurrent hash table also keeps the shard, at the high bits of the bucket
+#define SHARD_CURSOR_SHIFT (CURSOR_POS_BITS - SHARD_BITS)
+#define SHARD_CURSOR_MASK ((uint64_t)(NUM_OF_SHARDS - 1) << SHARD_CURSOR_SHIFT)
+
+// visits the elements of the buckets [start, end)
+static void visit_chains(node** buckets, const uint64_t start, const uint64_t end, void (*visit)(Pointer value, void* context), void* context)
+{
+    for (uint64_t i = start; i < end; i++)
+        for (node* bkt = buckets[i]; bkt != NULL; bkt = bkt->next)
+            visit(bkt->data, context);
+}
+
+// visits the elements of the hash table (its own buckets, not its shards')
+static void foreach(const HashTable ht, void (*visit)(Pointer value, void* context), void* context)
+{
+    visit_chains(ht->buckets, 0, get_hash(ht->capacity), visit, context);
+    if (is_rehashing(ht))  // the old buckets that have not been moved yet
+        visit_chains(ht->old_buckets, ht->rehash_index, get_hash(ht->capacity-1), visit, context);
+}
+
+void hash_foreach(const HashTable ht, void (*visit)(Pointer value, void* context), void* context)
+{
+    assert(ht != NULL && visit != NULL);
+
+    if (ht->concurrent == NULL)
+        foreach(ht, visit, context);
+    else  // the elements are at the shards
+    {
+        for (uint32_t i = 0; i < NUM_OF_SHARDS; i++)
+        {
+            shard* s = &(ht->concurrent->shards[i]);
+            pthread_rwlock_rdlock(&s->lock);
+            foreach(s->ht, visit, context);
+            pthread_rwlock_unlock(&s->lock);
+        }
+    }
+}
+
+// the iteration visits the buckets, followed by the old buckets while rehashing
+#define iter_end(ht) (get_hash((ht)->capacity) + (is_rehashing(ht) ? get_hash((ht)->capacity-1) : 0))
+
+// returns the chain of the bucket pos of the iteration (NULL for the old buckets that have been moved)
+static inline node* iter_chain(const HashTable ht, const uint64_t pos)
+{
+    const uint64_t size = get_hash(ht->capacity);
+    if (pos < size)
+        return ht->buckets[pos];
+    return pos - size >= ht->rehash_index ? ht->old_buckets[pos - size] : NULL;
+}
+
+// moves the iterator to the first element from bucket pos onwards and returns it, NULL if there is none
+static Pointer iter_seek(hash_iter* it, uint64_t pos)
+{
+    node* bkt = NULL;
+    while (pos < iter_end(it->ht) && (bkt = iter_chain(it->ht, pos)) == NULL) pos++;
+
+    it->pos = pos;
+    it->node = bkt;
+    return bkt != NULL ? bkt->data : NULL;
+}
+
+Pointer hash_iter_begin(const HashTable ht, hash_iter* it)
+{
+    assert(ht != NULL && it != NULL);
+    assert(ht->concurrent == NULL);  // not supported by concurrent hash tables
+
+    it->ht = ht;
+    return iter_seek(it, 0);
+}
+
+Pointer hash_iter_next(hash_iter* it)
+{
+    assert(it != NULL && it->ht != NULL);
+
+    if (it->node == NULL)  // iteration is over
+        return NULL;
+
+    node* next = ((node*)it->node)->next;
+    if (next == NULL)  // the rest of the bucket has been visited
+        return iter_seek(it, it->pos + 1);
+
+    it->node = next;
+    return next->data;
+}
+
+Pointer* hash_iter_value(const hash_iter* it)
+{
+    assert(it != NULL && it->ht->is_map && it->node != NULL);
+    return ((node*)it->node)->value;
+}
+
+// while rehashing, elements move from the old buckets to the new ones between the calls, so the old buckets are
+// visited first: an element that moves before its old bucket is visited is found at the new buckets later
+// the scan does not move any element itself, the cursor counts the old buckets (skipped once the rehash is complete)
+// followed by the new ones
+// (starting a rehash changes the number of rehashes, so the scan starts over)
+static uint64_t scan(const HashTable ht, const uint64_t cursor, const uint64_t count, void (*visit)(Pointer value, void* context), void* context)
+{
+    const uint64_t old_size = ht->capacity != 0 ? get_hash(ht->capacity-1) : 0;
+    const uint64_t size = old_size + get_hash(ht->capacity);
+
+    uint64_t pos = cursor_pos(ht, cursor);
+    if (pos < old_size && !is_rehashing(ht))  // every element is at the new buckets
+        pos = old_size;
+
+    const uint64_t end = pos + count < size ? pos + count : size;
+    if (pos < old_size)  // the old buckets that have not been moved yet
+        visit_chains(ht->old_buckets, pos > ht->rehash_index ? pos : ht->rehash_index, end < old_size ? end : old_size, visit, context);
+    if (end > old_size)
+        visit_chains(ht->buckets, (pos > old_size ? pos : old_size) - old_size, end - old_size, visit, context);
+
+    return end < size ? make_cursor(ht, end) : 0;
+}
+
+uint64_t hash_scan(const HashTable ht, const uint64_t cursor, const uint64_t count, void (*visit)(Pointer value, void* context), void* context)
+{
+    assert(ht != NULL && visit != NULL && count != 0);
+
+    if (ht->concurrent == NULL)
+        return scan(ht, cursor, count, visit, context);
+
+    // the shards are scanned one after the other, the scan of a shard only reads it
+    uint32_t i = (cursor & SHARD_CURSOR_MASK) >> SHARD_CURSOR_SHIFT;
+    shard* s = &(ht->concurrent->shards[i]);
+
+    pthread_rwlock_rdlock(&s->lock);
+    uint64_t next = scan(s->ht, cursor & ~SHARD_CURSOR_MASK, count, visit, context);
+    pthread_rwlock_unlock(&s->lock);
+
+    if (next == 0)  // the shard is over, continue from the start of the next one
+    {
+        if (++i == NUM_OF_SHARDS)
+            return 0;
+    }
+    return next | ((uint64_t)i << SHARD_CURSOR_SHIFT);
+}
+
+//////////////////////////////
+// concurrent hash table    //
+//////////////////////////////
+
+// creates the concurrent hash table with the hash function, or the 64-bit one, that is given
+static HashTable create_concurrent(const HashFunc hash, const HashFunc64 hash64, const CompareFunc compare, const DestroyFunc destroy)
+{
+    // the hash table only keeps the functions, the elements are stored at the shards, so it has no buckets
+    HashTable ht = create(hash, hash64, compare, destroy);
+    free(ht->buckets);
+    ht->buckets = NULL;
+
+    ht->concurrent = aligned_alloc(CACHE_LINE, sizeof(concurrent));
+    assert(ht->concurrent != NULL);  // allocation failure
+
+    for (uint32_t i = 0; i < NUM_OF_SHARDS; i++)
+    {
+        pthread_rwlock_init(&(ht->concurrent->shards[i].lock), NULL);
+        ht->concurrent->shards[i].ht = create(hash, hash64, compare, destroy);
+    }
+    atomic_init(&ht->concurrent->elements, 0);
+
+    return ht;
+}
+
+HashTable hash_create_concurrent(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert(hash != NULL);
+    return create_concurrent(hash, NULL, compare, destroy);
+}
+
+HashTable hash_create_concurrent64(const HashFunc64 hash, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert(hash != NULL);
+    return create_concurrent(NULL, hash, compare, destroy);
+}
+
+// every shard rehashes on its own, while holding its lock, so a rehash only blocks the threads using that shard
+static bool concurrent_insert(const HashTable ht, const Pointer value, const uint64_t hash_value)
+{
+    shard* s = get_shard(ht, hash_value);
+    
+    pthread_rwlock_wrlock(&s->lock);
+    const bool inserted = insert_hashed(s->ht, value, hash_value);
+    if (inserted)
+        atomic_fetch_add(&ht->concurrent->elements, 1);
+    pthread_rwlock_unlock(&s->lock);
+
+    return inserted;
+}
+
+static bool concurrent_remove(const HashTable ht, const Pointer value, const uint64_t hash_value)
+{
+    shard* s = get_shard(ht, hash_value);
+    
+    pthread_rwlock_wrlock(&s->lock);
+    const bool removed = remove_hashed(s->ht, value, hash_value);
+    if (removed)
+        atomic_fetch_sub(&ht->concurrent->elements, 1);
+    pthread_rwlock_unlock(&s->lock);
+
+    return removed;
+}
+
+// searching does not change the shard (rehashing only advances on insertions and removals), so readers share the lock
+static bool concurrent_exists(const HashTable ht, const Pointer value, const uint64_t hash_value)
+{
+    shard* s = get_shard(ht, hash_value);
+    
+    pthread_rwlock_rdlock(&s->lock);
+    const bool exists = find_node(s->ht, value, hash_value) != NULL;
+    pthread_rwlock_unlock(&s->lock);
+
+    return exists;
+}
+
+static Pointer concurrent_find(const HashTable ht, const Pointer value, const uint64_t hash_value)
+{
+    shard* s = get_shard(ht, hash_value);
+    
+    pthread_rwlock_rdlock(&s->lock);
+    node* bkt = find_node(s->ht, value, hash_value);
+    const Pointer data = bkt != NULL ? bkt->data : NULL;
+    pthread_rwlock_unlock(&s->lock);
+
+    return data;
+}
+
+// the search and the insertion hold the lock together, so only one of the threads inserting equal values succeeds
+static bool concurrent_get_or_insert(const HashTable ht, const Pointer value, const uint64_t hash_value, Pointer* existing)
+{
+    shard* s = get_shard(ht, hash_value);
+    bool inserted;
+
+    pthread_rwlock_wrlock(&s->lock);
+    *existing = get_or_insert_node(s->ht, value, hash_value, &inserted)->data;
+    if (inserted)
+        atomic_fetch_add(&ht->concurrent->elements, 1);
+    pthread_rwlock_unlock(&s->lock);
+
+    return inserted;
+}
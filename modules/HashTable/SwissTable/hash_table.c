@@ -0,0 +1,702 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "hash_table.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// the hash table is split into groups of slots, every slot has a 1 byte control byte
+// all the control bytes of a group are checked at once (using SSE2 where available)
+#define GROUP_SIZE 16
+
+// minimum number of slots (a power of 2, at least one group)
+#define MIN_CAPACITY 16
+
+// control bytes
+// a full slot stores the 7 lower bits of its value's hash (tag), so the high bit distinguishes them
+#define EMPTY   ((int8_t)-128)  // 0b10000000
+#define DELETED ((int8_t)-2)    // 0b11111110
+
+// when max load factor (7/8) is exceeded, rehashing operation occurs
+// deleted slots count towards it, since they also have to be searched through
+#define max_elements(capacity) ((capacity) - (capacity)/8)
+
+// number of values the batch operations process together
+#define BATCH_SIZE 16
+
+typedef struct hash_table
+{
+    int8_t* ctrl;         // control bytes of the slots, followed by a copy of the first group's
+    Pointer* data;        // slots storing the data
+    Pointer* values;      // values of the slots' data in map mode (NULL if not a map)
+    uint64_t capacity;    // the number of slots - a power of 2
+    uint64_t elements;    // number of elements currently stored in the hash table
+    uint64_t growth_left; // number of empty slots that can be filled before rehashing
+    bool scanning;        // a scan is in progress, so the deleted slots are cleaned up without moving the elements
+    HashFunc hash;        // function that hashes an element into a positive integer 
+    HashFunc64 hash64;    // function that hashes an element into a 64-bit integer, used instead of hash if given
+    CompareFunc compare;  // function that compares the elements
+    DestroyFunc destroy;  // function that destroys the elements, NULL if not
+    DestroyFunc destroy_value;  // function that destroys the values in map mode, NULL if not
+    uint64_t rehashes;    // number of rehashes
+    uint64_t lookups;     // number of searches (counted with HT_PROBE_STATS)
+    uint64_t probes;      // number of groups checked by the searches (counted with HT_PROBE_STATS)
+}
+hash_table;
+
+// mixes the hash value so that all of its bits affect both the position and the tag
+static inline uint64_t mix(const uint64_t hash_value)
+{
+    uint64_t h = hash_value * 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 32);
+}
+
+// the mixed hash value of an element
+#define hash_of(ht, value) mix((ht)->hash64 != NULL ? (ht)->hash64(value) : (uint64_t)(ht)->hash(value))
+
+// counts a search that checked the given number of groups
+#ifdef HT_PROBE_STATS
+#define count_lookup(ht, checked) ((ht)->lookups++, (ht)->probes += (checked))
+#else
+#define count_lookup(ht, checked) ((void)0)
+#endif
+
+#define hash_pos(h) ((h) >> 7)
+#define hash_tag(h) ((int8_t)((h) & 0x7F))
+
+////////////////////////////
+// group matching         //
+////////////////////////////
+// every function returns a bitmask with bit i set if the i-th control byte of the group matches
+
+#ifdef __SSE2__
+
+static inline uint32_t match_tag(const int8_t* group, const int8_t tag)
+{
+    const __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag)));
+}
+
+static inline uint32_t match_empty(const int8_t* group)
+{
+    const __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(EMPTY)));
+}
+
+// empty and deleted slots are the only ones with the high bit set
+static inline uint32_t match_empty_or_deleted(const int8_t* group)
+{
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+}
+
+#else
+
+static inline uint32_t match_tag(const int8_t* group, const int8_t tag)
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < GROUP_SIZE; i++)
+        mask |= (uint32_t)(group[i] == tag) << i;
+    return mask;
+}
+
+static inline uint32_t match_empty(const int8_t* group)
+{
+    return match_tag(group, EMPTY);
+}
+
+static inline uint32_t match_empty_or_deleted(const int8_t* group)
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < GROUP_SIZE; i++)
+        mask |= (uint32_t)(group[i] < 0) << i;
+    return mask;
+}
+
+#endif
+
+// the groups are probed quadratically (triangular numbers), which, for a power of 2 capacity, visits every group
+#define next_group(pos, step, mask) (((pos) + ((step) += GROUP_SIZE)) & (mask))
+
+// sets the control byte of a slot, as well as its copy if it is in the first group
+static inline void set_ctrl(const HashTable ht, const uint64_t i, const int8_t c)
+{
+    ht->ctrl[i] = c;
+    if (i < GROUP_SIZE)
+        ht->ctrl[ht->capacity + i] = c;
+}
+
+// allocates the slots of the hash table
+static inline void allocate_slots(const HashTable ht, const uint64_t capacity, const bool is_map)
+{
+    ht->capacity = capacity;
+    ht->growth_left = max_elements(capacity);
+    
+    ht->ctrl = malloc(capacity + GROUP_SIZE);
+    assert(ht->ctrl != NULL);  // allocation failure
+    memset(ht->ctrl, EMPTY, capacity + GROUP_SIZE);
+
+    ht->data = malloc(sizeof(Pointer) * capacity);
+    assert(ht->data != NULL);  // allocation failure
+
+    ht->values = NULL;
+    if (is_map)
+    {
+        ht->values = malloc(sizeof(Pointer) * capacity);
+        assert(ht->values != NULL);  // allocation failure
+    }
+}
+
+// creates the hash table with the hash function, or the 64-bit one, that is given
+static HashTable create(const HashFunc hash, const HashFunc64 hash64, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert((hash != NULL || hash64 != NULL) && compare != NULL);  // a hash and compare function needs to be given
+    
+    HashTable ht = malloc(sizeof(hash_table));
+    assert(ht != NULL);  // allocation failure
+
+    allocate_slots(ht, MIN_CAPACITY, false);
+    
+    ht->elements = 0;
+    ht->scanning = false;
+    ht->rehashes = ht->lookups = ht->probes = 0;
+    ht->hash = hash;
+    ht->hash64 = hash64;
+    ht->compare = compare;
+    ht->destroy = destroy;
+    ht->destroy_value = NULL;
+
+    return ht;
+}
+
+HashTable hash_create(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert(hash != NULL);
+    return create(hash, NULL, compare, destroy);
+}
+
+HashTable hash_create_with_capacity(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy, const uint64_t expected)
+{
+    HashTable ht = hash_create(hash, compare, destroy);
+    hash_reserve(ht, expected);
+    ht->rehashes = 0;  // sizing the buckets of a new hash table is not a rehash
+    return ht;
+}
+
+HashTable hash_create64(const HashFunc64 hash, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert(hash != NULL);
+    return create(NULL, hash, compare, destroy);
+}
+
+// turns the hash table into a map
+static HashTable make_map(const HashTable ht, const DestroyFunc destroy_value)
+{
+    ht->values = malloc(sizeof(Pointer) * ht->capacity);  // allocate memory for the values
+    assert(ht->values != NULL);  // allocation failure
+    ht->destroy_value = destroy_value;
+
+    return ht;
+}
+
+HashTable hash_map_create(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy_key, const DestroyFunc destroy_value)
+{
+    return make_map(hash_create(hash, compare, destroy_key), destroy_value);
+}
+
+HashTable hash_map_create64(const HashFunc64 hash, const CompareFunc compare, const DestroyFunc destroy_key, const DestroyFunc destroy_value)
+{
+    return make_map(hash_create64(hash, compare, destroy_key), destroy_value);
+}
+
+uint64_t hash_size(const HashTable ht)
+{
+    assert(ht != NULL);
+    return ht->elements;
+}
+
+bool is_ht_empty(const HashTable ht)
+{
+    assert(ht != NULL);
+    return ht->elements == 0;
+}
+
+// returns the slot in which the value exists
+// if it does not exist, returns the capacity of the hash table
+static inline uint64_t find_slot(const HashTable ht, const Pointer value, const uint64_t h)
+{
+    const uint64_t mask = ht->capacity-1;
+    const int8_t tag = hash_tag(h);
+
+    for (uint64_t pos = hash_pos(h) & mask, step = 0, groups = 1 ;; pos = next_group(pos, step, mask), groups++)
+    {
+        const int8_t* group = ht->ctrl + pos;
+
+        // compare only the values whose tag matches
+        for (uint32_t match = match_tag(group, tag); match != 0; match &= match - 1)
+        {
+            const uint64_t i = (pos + __builtin_ctz(match)) & mask;
+            if (ht->compare(ht->data[i], value) == 0)
+            {
+                count_lookup(ht, groups);
+                return i;
+            }
+        }
+
+        // the value would have been inserted at the empty slot, so it does not exist
+        if (match_empty(group) != 0)
+        {
+            count_lookup(ht, groups);
+            return ht->capacity;
+        }
+    }
+}
+
+// returns the first empty or deleted slot of the value's probe sequence
+static inline uint64_t find_free_slot(const HashTable ht, const uint64_t h)
+{
+    const uint64_t mask = ht->capacity-1;
+
+    for (uint64_t pos = hash_pos(h) & mask, step = 0 ;; pos = next_group(pos, step, mask))
+    {
+        const uint32_t match = match_empty_or_deleted(ht->ctrl + pos);
+        if (match != 0)
+            return (pos + __builtin_ctz(match)) & mask;
+    }
+}
+
+// empties the deleted slots that no element's search passes through, without moving the elements
+// (the rest of them are in the groups that the search for an element checks before the one it is found in, where an
+// empty slot would end it)
+static void drop_deleted(const HashTable ht)
+{
+    const uint64_t mask = ht->capacity-1;
+    uint64_t* needed = calloc(ht->capacity / 64 + 1, sizeof(uint64_t));
+    assert(needed != NULL);  // allocation failure
+
+    for (uint64_t i = 0; i < ht->capacity; i++)
+    {
+        if (ht->ctrl[i] < 0)  // not a full slot
+            continue;
+
+        // the groups before the first one that contains the slot
+        const uint64_t h = hash_of(ht, ht->data[i]);
+        for (uint64_t pos = hash_pos(h) & mask, step = 0; ((i - pos) & mask) >= GROUP_SIZE; pos = next_group(pos, step, mask))
+        {
+            for (uint64_t j = 0; j < GROUP_SIZE; j++)
+                needed[((pos + j) & mask) / 64] |= (uint64_t)1 << (((pos + j) & mask) % 64);
+        }
+    }
+
+    for (uint64_t i = 0; i < ht->capacity; i++)
+    {
+        if (ht->ctrl[i] == DELETED && !(needed[i / 64] >> (i % 64) & 1))
+        {
+            set_ctrl(ht, i, EMPTY);
+            ht->growth_left++;
+        }
+    }
+    free(needed);
+}
+
+// moves the elements to new slots, dropping the deleted ones
+static void rehash(const HashTable ht, const uint64_t capacity)
+{
+    // save previous slots
+    int8_t* old_ctrl = ht->ctrl;
+    Pointer* old_data = ht->data;
+    Pointer* old_values = ht->values;
+    const uint64_t old_capacity = ht->capacity;
+
+    allocate_slots(ht, capacity, old_values != NULL);
+    ht->rehashes++;
+
+    // start rehash operation
+    for (uint64_t i = 0; i < old_capacity; i++)
+    {
+        if (old_ctrl[i] >= 0)  // full slot
+        {
+            const uint64_t h = hash_of(ht, old_data[i]), pos = find_free_slot(ht, h);
+            set_ctrl(ht, pos, hash_tag(h));
+            ht->data[pos] = old_data[i];
+            if (old_values != NULL)
+                ht->values[pos] = old_values[i];
+        }
+    }
+    ht->growth_left -= ht->elements;
+
+    free(old_ctrl);
+    free(old_data);
+    free(old_values);
+}
+
+// returns the slot holding the value, inserting it if it does not exist (and setting inserted)
+// (h is the mixed hash value of the value)
+static inline uint64_t insert_slot(const HashTable ht, const Pointer value, const uint64_t h, bool* inserted)
+{
+    // check to see if value already exists in the hash table
+    uint64_t pos = find_slot(ht, value, h);
+    if (pos != ht->capacity)
+    {
+        *inserted = false;
+        return pos;
+    }
+
+    pos = find_free_slot(ht, h);
+
+    // an empty slot has to be filled but the max load factor would be exceeded, start rehash
+    // the table grows only if it is more than half full, otherwise it is full of deleted slots and keeps its size
+    if (ht->growth_left == 0 && ht->ctrl[pos] == EMPTY)
+    {
+        // while a scan is in progress the deleted slots are emptied in place instead, since a rehash starts it over
+        // (unless the table has to grow, or only few of them can be emptied)
+        const uint64_t max = max_elements(ht->capacity);
+        if (ht->scanning && ht->elements <= max/2)
+            drop_deleted(ht);
+        if (ht->growth_left < max/4)
+            rehash(ht, ht->elements > max/2 ? 2*ht->capacity : ht->capacity);
+        pos = find_free_slot(ht, h);
+    }
+
+    if (ht->ctrl[pos] == EMPTY)
+        ht->growth_left--;
+    
+    set_ctrl(ht, pos, hash_tag(h));
+    ht->data[pos] = value;
+    if (ht->values != NULL)
+        ht->values[pos] = NULL;
+    ht->elements++;  // value inserted, increment the number of elements in the hash table
+
+    *inserted = true;
+    return pos;
+}
+
+// inserts the value with the given mixed hash value, returns true if it was inserted
+static inline bool insert_hashed(const HashTable ht, const Pointer value, const uint64_t h)
+{
+    bool inserted;
+    insert_slot(ht, value, h, &inserted);
+
+    // if the value already exists and a destroy function exists, destroy the value
+    if (!inserted && ht->destroy != NULL)
+        ht->destroy(value);
+
+    return inserted;
+}
+
+bool hash_insert(const HashTable ht, const Pointer value)
+{
+    assert(ht != NULL);
+    return insert_hashed(ht, value, hash_of(ht, value));
+}
+
+Pointer* hash_map_get_or_insert(const HashTable ht, const Pointer key, bool* inserted)
+{
+    assert(ht != NULL && ht->values != NULL && inserted != NULL);
+
+    const uint64_t pos = insert_slot(ht, key, hash_of(ht, key), inserted);
+
+    // if the key already exists and a destroy function exists, destroy the key
+    if (!(*inserted) && ht->destroy != NULL)
+        ht->destroy(key);
+    
+    return ht->values + pos;
+}
+
+bool hash_map_put(const HashTable ht, const Pointer key, const Pointer value)
+{
+    bool inserted;
+    Pointer* slot = hash_map_get_or_insert(ht, key, &inserted);
+
+    // the key already exists, destroy its old value
+    if (!inserted && ht->destroy_value != NULL && *slot != value)
+        ht->destroy_value(*slot);
+    
+    *slot = value;
+    return inserted;
+}
+
+bool hash_remove(const HashTable ht, const Pointer value)
+{
+    if (is_ht_empty(ht))  // empty hash table - nothing to remove
+        return false;
+    
+    // find the potential slot the value exists in
+    const uint64_t pos = find_slot(ht, value, hash_of(ht, value));
+    if (pos == ht->capacity)  // value does not exist
+        return false;
+
+    // destroy the data, if a destroy function is given
+    if (ht->destroy != NULL)
+        ht->destroy(ht->data[pos]);
+    if (ht->values != NULL && ht->destroy_value != NULL)
+        ht->destroy_value(ht->values[pos]);
+
+    // if no group containing the slot was ever full, no search went past it, so it can be marked as empty
+    // the groups are found from the empty slots right before and after it
+    const uint64_t mask = ht->capacity-1;
+    const uint32_t empty_before = match_empty(ht->ctrl + ((pos - GROUP_SIZE) & mask));
+    const uint32_t empty_after = match_empty(ht->ctrl + pos);
+    const bool never_full = empty_before != 0 && empty_after != 0 &&
+                            (uint32_t)(__builtin_ctz(empty_after) + __builtin_clz(empty_before << 16)) < GROUP_SIZE;
+
+    if (never_full)
+    {
+        set_ctrl(ht, pos, EMPTY);
+        ht->growth_left++;
+    }
+    else
+        set_ctrl(ht, pos, DELETED);  // mark the slot as deleted
+    
+    ht->elements--;  // value removed, decrement the number of elements in the hash table
+    return true;
+}
+
+Pointer* hash_map_get(const HashTable ht, const Pointer key)
+{
+    assert(ht != NULL && ht->values != NULL);
+
+    if (is_ht_empty(ht))  // hash table is empty, nothing to search
+        return NULL;
+
+    const uint64_t pos = find_slot(ht, key, hash_of(ht, key));
+    return pos != ht->capacity ? ht->values + pos : NULL;
+}
+
+bool hash_exists(const HashTable ht, const Pointer value)
+{
+    if (is_ht_empty(ht))  // hash table is empty, nothing to search
+        return false;
+
+    return find_slot(ht, value, hash_of(ht, value)) != ht->capacity;
+}
+
+Pointer hash_find(const HashTable ht, const Pointer value)
+{
+    if (is_ht_empty(ht))  // hash table is empty, nothing to search
+        return NULL;
+
+    const uint64_t pos = find_slot(ht, value, hash_of(ht, value));
+    return pos != ht->capacity ? ht->data[pos] : NULL;
+}
+
+// a single hash for both the search and the insertion
+bool hash_get_or_insert(const HashTable ht, const Pointer value, Pointer* existing)
+{
+    assert(ht != NULL && existing != NULL);
+
+    bool inserted;
+    const uint64_t pos = insert_slot(ht, value, hash_of(ht, value), &inserted);
+    *existing = ht->data[pos];
+    return inserted;
+}
+
+// sets bit i of the result bitmap (if given) to b
+static inline void set_result(uint64_t* result, const uint64_t i, const bool b)
+{
+    if (result == NULL) return;
+
+    const uint64_t mask = (uint64_t)1 << (i % 64);
+    result[i / 64] = b ? (result[i / 64] | mask) : (result[i / 64] & ~mask);
+}
+
+// computes the hash values of the values [start, end) and prefetches the first group of each, along with its slots
+static inline void prefetch_batch(const HashTable ht, const Pointer* values, const uint64_t start, const uint64_t end, uint64_t* hashes)
+{
+    for (uint64_t i = start; i < end; i++)
+    {
+        hashes[i - start] = hash_of(ht, values[i]);
+
+        const uint64_t pos = hash_pos(hashes[i - start]) & (ht->capacity-1);
+        __builtin_prefetch(ht->ctrl + pos);
+        __builtin_prefetch(ht->data + pos);
+    }
+}
+
+uint64_t hash_exists_many(const HashTable ht, const Pointer* values, const uint64_t n, uint64_t* result)
+{
+    assert(ht != NULL && (values != NULL || n == 0));
+
+    uint64_t found = 0;
+    uint64_t hashes[BATCH_SIZE];
+    for (uint64_t start = 0; start < n; start += BATCH_SIZE)
+    {
+        const uint64_t end = start + BATCH_SIZE < n ? start + BATCH_SIZE : n;
+        prefetch_batch(ht, values, start, end, hashes);
+
+        for (uint64_t i = start; i < end; i++)
+        {
+            const bool exists = !is_ht_empty(ht) && find_slot(ht, values[i], hashes[i - start]) != ht->capacity;
+            set_result(result, i, exists);
+            found += exists;
+        }
+    }
+    return found;
+}
+
+uint64_t hash_insert_many(const HashTable ht, const Pointer* values, const uint64_t n, uint64_t* result)
+{
+    assert(ht != NULL && (values != NULL || n == 0));
+
+    uint64_t inserted = 0;
+    uint64_t hashes[BATCH_SIZE];
+    for (uint64_t start = 0; start < n; start += BATCH_SIZE)
+    {
+        const uint64_t end = start + BATCH_SIZE < n ? start + BATCH_SIZE : n;
+        prefetch_batch(ht, values, start, end, hashes);
+
+        for (uint64_t i = start; i < end; i++)
+        {
+            const bool ins = insert_hashed(ht, values[i], hashes[i - start]);
+            set_result(result, i, ins);
+            inserted += ins;
+        }
+    }
+    return inserted;
+}
+
+void hash_compact(const HashTable ht)
+{
+    assert(ht != NULL);
+
+    // every slot that is neither full nor counted by growth_left is deleted
+    if (ht->elements + ht->growth_left != max_elements(ht->capacity))
+        rehash(ht, ht->capacity);
+}
+
+void hash_reserve(const HashTable ht, const uint64_t n)
+{
+    assert(ht != NULL);
+
+    // the smallest capacity that holds n elements within the max load factor
+    uint64_t capacity = MIN_CAPACITY;
+    while (n > max_elements(capacity))
+        capacity *= 2;
+
+    if (capacity > ht->capacity)
+        rehash(ht, capacity);
+}
+
+DestroyFunc hash_set_destroy(const HashTable ht, const DestroyFunc new_destroy_func)
+{
+    assert(ht != NULL);
+
+    DestroyFunc old_destroy_func = ht->destroy;
+    ht->destroy = new_destroy_func;
+    return old_destroy_func;
+}
+
+void hash_stats(const HashTable ht, struct ht_stats* stats)
+{
+    assert(ht != NULL && stats != NULL);
+    memset(stats, 0, sizeof(struct ht_stats));
+
+    stats->elements = ht->elements;
+    stats->buckets = ht->capacity;
+    stats->load_factor = (double)ht->elements / ht->capacity;
+    stats->bytes = sizeof(hash_table) + ht->capacity + GROUP_SIZE +
+                   ht->capacity * (sizeof(Pointer) + (ht->values != NULL ? sizeof(Pointer) : 0));
+    stats->rehashes = ht->rehashes;
+    stats->lookups = ht->lookups;
+    stats->probes = ht->probes;
+
+    const uint64_t mask = ht->capacity-1;
+    for (uint64_t i = 0; i < ht->capacity; i++)
+    {
+        if (ht->ctrl[i] == DELETED)
+            stats->tombstones++;
+        else if (ht->ctrl[i] >= 0)  // full slot, count the groups probed until its group
+        {
+            uint64_t groups = 1;
+            for (uint64_t pos = hash_pos(hash_of(ht, ht->data[i])) & mask, step = 0; ((i - pos) & mask) >= GROUP_SIZE;
+                 pos = next_group(pos, step, mask))
+                groups++;
+            stats->histogram[groups < HT_HISTOGRAM_SIZE ? groups : HT_HISTOGRAM_SIZE - 1]++;
+        }
+    }
+}
+
+// a scan cursor keeps the slot to continue from, along with the (low 16 bits of the) number of rehashes when it was
+// returned, so a cursor to slots that have been reallocated since then starts over
+#define CURSOR_POS_BITS 48
+#define make_cursor(ht, pos) (((ht)->rehashes << CURSOR_POS_BITS) | (pos))
+#define cursor_pos(ht, cursor) \
+    ((cursor) >> CURSOR_POS_BITS == ((ht)->rehashes & 0xFFFF) ? (cursor) & ((1ull << CURSOR_POS_BITS) - 1) : 0)
+
+void hash_foreach(const HashTable ht, void (*visit)(Pointer value, void* context), void* context)
+{
+    assert(ht != NULL && visit != NULL);
+
+    for (uint64_t i = 0; i < ht->capacity; i++)
+        if (ht->ctrl[i] >= 0) visit(ht->data[i], context);
+}
+
+// moves the iterator to the first element from slot pos onwards and returns it, NULL if there is none
+static inline Pointer iter_seek(hash_iter* it, uint64_t pos)
+{
+    const HashTable ht = it->ht;
+    while (pos < ht->capacity && ht->ctrl[pos] < 0) pos++;
+
+    it->pos = pos;
+    return pos < ht->capacity ? ht->data[pos] : NULL;
+}
+
+Pointer hash_iter_begin(const HashTable ht, hash_iter* it)
+{
+    assert(ht != NULL && it != NULL);
+
+    it->ht = ht;
+    it->node = NULL;
+    return iter_seek(it, 0);
+}
+
+Pointer hash_iter_next(hash_iter* it)
+{
+    assert(it != NULL && it->ht != NULL);
+    return it->pos < it->ht->capacity ? iter_seek(it, it->pos + 1) : NULL;
+}
+
+Pointer* hash_iter_value(const hash_iter* it)
+{
+    assert(it != NULL && it->ht->values != NULL && it->pos < it->ht->capacity);
+    return &(it->ht->values[it->pos]);
+}
+
+// the elements stay at their slots until the next rehash
+uint64_t hash_scan(const HashTable ht, const uint64_t cursor, const uint64_t count, void (*visit)(Pointer value, void* context), void* context)
+{
+    assert(ht != NULL && visit != NULL && count != 0);
+
+    uint64_t pos = cursor_pos(ht, cursor);
+    for (const uint64_t end = pos + count; pos < end && pos < ht->capacity; pos++)
+        if (ht->ctrl[pos] >= 0) visit(ht->data[pos], context);
+
+    ht->scanning = pos < ht->capacity;
+    return pos < ht->capacity ? make_cursor(ht, pos) : 0;
+}
+
+void hash_destroy(const HashTable ht)
+{
+    assert(ht != NULL);
+
+    // if a destroy function exists & there are elements, destroy the data (and values)
+    const DestroyFunc destroy_value = ht->values != NULL ? ht->destroy_value : NULL;
+    if ((ht->destroy != NULL || destroy_value != NULL) && ht->elements != 0)
+    {
+        for (uint64_t i = 0; i < ht->capacity; i++)
+        {
+            if (ht->ctrl[i] >= 0)  // full slot
+            {
+                if (ht->destroy != NULL) ht->destroy(ht->data[i]);
+                if (destroy_value != NULL) destroy_value(ht->values[i]);
+            }
+        }
+    }
+    
+    free(ht->ctrl);
+    free(ht->data);
+    free(ht->values);
+    free(ht);
+}
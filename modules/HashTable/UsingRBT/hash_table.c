@@ -1,59 +1,167 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include "hash_table.h"
 // red-black tree's include file (note that it might need to be updated according to its path)
 #include "../../RedBlackTree/RedBlackTree.h"
 
-#define FIXED_SIZE 3     // minimum number of elements in the array before inserting them at a rbt
-#define OVERFLOW_SIZE 4  // size at which elements are inserted at a rbt (FIXED_SIZE+1)
+#define FIXED_SIZE 3      // maximum number of elements in the array, more are inserted at a rbt (treeify)
+#define UNTREEIFY_SIZE 2  // when a rbt is left with this many elements, they are moved back to an array
+
+// when the load factor exceeds the max load factor, the number of buckets (approximately) doubles
+// when it drops below the min load factor, it is (approximately) halved
+#define MAX_LOAD_FACTOR 1.0
+#define MIN_LOAD_FACTOR 0.25
+
+// number of values the batch operations process together
+#define BATCH_SIZE 16
 
 // bucket
+// its elements are either at the array or, if there are more than FIXED_SIZE, at the rbt
 typedef struct node
 {
-    RBTree rbt;      // red-black tree
-    Pointer* data;   // array
-    uint8_t arr_el;  // number of elements in the array (if it is equal to FIXED_SIZE, the elements are in the rbt)
+    RBTree rbt;                     // red-black tree, NULL if the elements are at the array
+    Pointer data[FIXED_SIZE];       // array (NULL marks an empty spot)
+    uint32_t hashes[FIXED_SIZE];    // hash values of the array's elements, compared before calling the compare function
+    uint8_t arr_el;                 // number of elements in the array
 }
 node;
 
 typedef struct hash_table
 {
-    node* buckets;        // buckets (red-black trees) storing the data
-    uint64_t capacity;    // number of buckets
+    node* buckets;        // buckets storing the data
+    Pointer* values;      // values of the arrays' elements in map mode, FIXED_SIZE per bucket (NULL if not a map)
+    uint8_t capacity;     // the capacity of the hash table - index to the "hash_sizes" array
+    uint64_t recip;       // reciprocal of the capacity, used to find the buckets without divisions
     uint64_t elements;    // number of elements in the hash table
+    bool scanning;        // a scan is in progress, so the hash table does not shrink
     HashFunc hash;        // function that hashes an element into a positive integer
+    HashFunc64 hash64;    // function that hashes an element into a 64-bit integer, used instead of hash if given
     CompareFunc compare;  // function that compares the elements
     DestroyFunc destroy;  // function that destroys the elements, NULL if not
+    DestroyFunc destroy_value;  // function that destroys the values in map mode, NULL if not
+    bool is_map;                // true if every element (key) is associated with a value
+    uint64_t rehashes;    // number of rehashes
+    uint64_t lookups;     // number of searches (counted with HT_PROBE_STATS)
+    uint64_t probes;      // number of elements compared by the searches (counted with HT_PROBE_STATS)
 }
 hash_table;
 
-HashTable hash_create(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy)
+// available number of buckets, preferably prime numbers since it has been proven they have better behavior
+static uint64_t hash_sizes[] =
+    { 29, 67, 131, 263, 509, 1021, 2053, 4093, 8179, 16369, 32749, 65521, 131071, 262147, 524287, 1048573, 2097143,
+    4194301, 8388593, 16777213, 33554467, 67108879, 134217757, 268435459, 536870923, 1073741827, 2147483647, 4294967291 };
+
+#define get_hash(i) (hash_sizes[i])
+#define LAST_SIZE ((uint8_t)(sizeof(hash_sizes) / sizeof(hash_sizes[0]) - 1))
+
+// fast modulo (Lemire et al., "Faster Remainder by Direct Computation")
+// hash % size is computed with multiplications, using the precomputed reciprocal of the size
+static inline uint32_t fast_mod(const uint32_t hash_value, const uint64_t recip, const uint64_t size)
 {
-    assert(hash != NULL && compare != NULL);  // a hash and compare function needs to be given
-    
-    HashTable ht = malloc(sizeof(hash_table));
-    assert(ht != NULL);  // allocation failure
+    return (uint32_t)(((__uint128_t)(recip * hash_value) * size) >> 64);
+}
+
+// the number of buckets fits in 32 bits, so 64-bit hash values are folded to 32 bits, all of which affect the bucket
+static inline uint32_t fold(const uint64_t hash_value)
+{
+    return (uint32_t)(hash_value ^ (hash_value >> 32));
+}
+
+#define hash_of(ht, value) ((ht)->hash64 != NULL ? fold((ht)->hash64(value)) : (uint32_t)(ht)->hash(value))
+
+#define get_bucket(ht, hash_value) (&((ht)->buckets[fast_mod(hash_value, (ht)->recip, get_hash((ht)->capacity))]))
+
+// counts a search that compared the given number of elements
+#ifdef HT_PROBE_STATS
+#define count_lookup(ht, checked) ((ht)->lookups++, (ht)->probes += (checked))
+#else
+#define count_lookup(ht, checked) ((void)0)
+#endif
+
+// elements compared by a search of a rbt, approximated by the height of a perfectly balanced tree
+#define rbt_height(rbt) (64 - __builtin_clzll(rbt_size(rbt)))
 
-    ht->capacity = NUM_OF_BUCKETS;
+// approximate size of a rbt (handle) and of one of its nodes (data, color and 3 links), which are opaque
+#define RBT_SIZE (6 * sizeof(Pointer))
+#define RBT_NODE_SIZE (5 * sizeof(Pointer))
 
-    ht->buckets = calloc(sizeof(node), NUM_OF_BUCKETS);  // allocate memory for the buckets
+// value of the i-th element of the bucket's array, in map mode
+#define value_at(ht, bkt, i) ((ht)->values[((bkt) - (ht)->buckets) * FIXED_SIZE + (i)])
+
+// allocates the (empty) buckets
+static inline void allocate_buckets(const HashTable ht, const uint8_t capacity)
+{
+    ht->capacity = capacity;
+    ht->recip = UINT64_MAX / get_hash(capacity) + 1;
+
+    ht->buckets = calloc(sizeof(node), get_hash(capacity));
     assert(ht->buckets != NULL);  // allocation failure
 
-    // allocate memory for the buckets
-    for(uint64_t i = 0; i < NUM_OF_BUCKETS; i++)
+    ht->values = NULL;
+    if (ht->is_map)
     {
-        ht->buckets[i].data = calloc(sizeof(Pointer), FIXED_SIZE);
-        assert(ht->buckets[i].data != NULL);  // allocation failure
+        ht->values = malloc(sizeof(Pointer) * FIXED_SIZE * get_hash(capacity));
+        assert(ht->values != NULL);  // allocation failure
     }
+}
+
+static HashTable create_table(const HashFunc hash, const HashFunc64 hash64, const CompareFunc compare, const DestroyFunc destroy,
+                              const DestroyFunc destroy_value, const bool is_map)
+{
+    assert((hash != NULL || hash64 != NULL) && compare != NULL);  // a hash and compare function needs to be given
+    
+    HashTable ht = malloc(sizeof(hash_table));
+    assert(ht != NULL);  // allocation failure
+
+    ht->is_map = is_map;
+    allocate_buckets(ht, 0);
 
-    ht->capacity = NUM_OF_BUCKETS;
     ht->elements = 0;
+    ht->scanning = false;
+    ht->rehashes = ht->lookups = ht->probes = 0;
     
     // initialize functions
     ht->compare = compare;
     ht->destroy = destroy;
+    ht->destroy_value = destroy_value;
     ht->hash = hash;
+    ht->hash64 = hash64;
+
+    return ht;
+}
+
+HashTable hash_create(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert(hash != NULL);
+    return create_table(hash, NULL, compare, destroy, NULL, false);
+}
+
+HashTable hash_create_with_capacity(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy, const uint64_t expected)
+{
+    HashTable ht = hash_create(hash, compare, destroy);
+    hash_reserve(ht, expected);
+    ht->rehashes = 0;  // sizing the buckets of a new hash table is not a rehash
+    return ht;
+}
+
+HashTable hash_create64(const HashFunc64 hash, const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert(hash != NULL);
+    return create_table(NULL, hash, compare, destroy, NULL, false);
+}
+
+HashTable hash_map_create(const HashFunc hash, const CompareFunc compare, const DestroyFunc destroy_key, const DestroyFunc destroy_value)
+{
+    assert(hash != NULL);
+    return create_table(hash, NULL, compare, destroy_key, destroy_value, true);
+}
+
+HashTable hash_map_create64(const HashFunc64 hash, const CompareFunc compare, const DestroyFunc destroy_key, const DestroyFunc destroy_value)
+{
+    assert(hash != NULL);
+    return create_table(NULL, hash, compare, destroy_key, destroy_value, true);
 }
 
 uint64_t hash_size(const HashTable ht)
@@ -68,68 +176,231 @@ bool is_ht_empty(const HashTable ht)
     return ht->elements == 0;
 }
 
-bool hash_insert(const HashTable ht, const Pointer value)
+// places the element (and its value in map mode) at an empty spot of the bucket's array and returns the address of its value
+static inline Pointer* array_insert(const HashTable ht, node* bkt, const Pointer data, const uint32_t hash_value, const Pointer value)
 {
-    assert(ht != NULL);
+    uint8_t i = 0;
+    while (bkt->data[i] != NULL) i++;
 
-    // find the potential bucket the value belongs to
-    uint64_t bucket = ht->hash(value) % ht->capacity;
-    
-    // insert at the rbt
-    if (ht->buckets[bucket].arr_el == OVERFLOW_SIZE)
+    bkt->data[i] = data;
+    bkt->hashes[i] = hash_value;
+    bkt->arr_el++;
+    if (!ht->is_map) return NULL;
+
+    value_at(ht, bkt, i) = value;
+    return &value_at(ht, bkt, i);
+}
+
+// returns the index of the value in the bucket's array, FIXED_SIZE if it does not exist
+// the compare function is only called for the elements with the same hash value
+static inline uint8_t array_find(const HashTable ht, const node* bkt, const Pointer value, const uint32_t hash_value)
+{
+    uint8_t i = 0;
+    while (i < FIXED_SIZE && (bkt->data[i] == NULL || bkt->hashes[i] != hash_value || ht->compare(bkt->data[i], value) != 0))
+        i++;
+    count_lookup(ht, i < FIXED_SIZE ? i + 1 : FIXED_SIZE);
+    return i;
+}
+
+// inserts the element (and its value in map mode), that does not exist, at the bucket's rbt and returns the address of its value
+static inline Pointer* rbt_bucket_insert(const HashTable ht, node* bkt, const Pointer data, const Pointer value)
+{
+    if (!ht->is_map)
     {
-        if (rbt_insert(ht->buckets[bucket].rbt, value))
-        {
-            ht->elements++;  // value inserted, increment the number of elements in the hash table
-            return true;
-        }
+        rbt_insert(bkt->rbt, data);
+        return NULL;
     }
-    else  // insert at the array
+
+    bool inserted;
+    Pointer* slot = rbt_map_get_or_insert(bkt->rbt, data, &inserted);
+    *slot = value;
+    return slot;
+}
+
+// moves the elements of the array to a rbt
+// the values are destroyed by the hash table, so that the elements can be moved out of the rbt as well
+static void treeify(const HashTable ht, node* bkt)
+{
+    bkt->rbt = ht->is_map ? rbt_map_create(ht->compare, ht->destroy, NULL) : rbt_create(ht->compare, ht->destroy);
+
+    for (uint8_t i = 0; i < FIXED_SIZE; i++)
     {
-        // search to see if value already exists
-        int empty_space = -1;
-        for (uint8_t i = 0; i < FIXED_SIZE; i++)
+        if (bkt->data[i] != NULL)
+            rbt_bucket_insert(ht, bkt, bkt->data[i], ht->is_map ? value_at(ht, bkt, i) : NULL);
+        bkt->data[i] = NULL;
+    }
+    bkt->arr_el = 0;
+}
+
+// destroys the rbt of the bucket, without destroying its elements
+static inline void free_rbt(node* bkt)
+{
+    rbt_set_destroy(bkt->rbt, NULL);
+    rbt_destroy(bkt->rbt);
+    bkt->rbt = NULL;
+}
+
+// moves the elements of the rbt back to an array
+static void untreeify(const HashTable ht, node* bkt)
+{
+    for (RBTreeNode n = rbt_first(bkt->rbt); n != NULL; n = rbt_find_next(n))
+        array_insert(ht, bkt, rbt_node_value(n), hash_of(ht, rbt_node_value(n)), ht->is_map ? *rbt_map_node_value(n) : NULL);
+    
+    free_rbt(bkt);
+}
+
+// inserts the element (and its value in map mode), that does not exist, at the bucket and returns the address of its value
+static Pointer* bucket_insert(const HashTable ht, node* bkt, const Pointer data, const uint32_t hash_value, const Pointer value)
+{
+    if (bkt->rbt == NULL && bkt->arr_el == FIXED_SIZE)  // overflow
+        treeify(ht, bkt);
+
+    return bkt->rbt != NULL ? rbt_bucket_insert(ht, bkt, data, value) : array_insert(ht, bkt, data, hash_value, value);
+}
+
+// moves the elements to a new number of buckets
+static void rehash(const HashTable ht, const uint8_t new_capacity)
+{
+    // save previous buckets
+    node* old_buckets = ht->buckets;
+    Pointer* old_values = ht->values;
+    const uint64_t old_size = get_hash(ht->capacity);
+    
+    allocate_buckets(ht, new_capacity);
+    ht->rehashes++;
+
+    // start rehash operation
+    for (uint64_t i = 0; i < old_size; i++)
+    {
+        node* bkt = &(old_buckets[i]);
+        if (bkt->rbt != NULL)
         {
-            if (ht->buckets[bucket].data[i] == NULL)
+            for (RBTreeNode n = rbt_first(bkt->rbt); n != NULL; n = rbt_find_next(n))
             {
-                if (empty_space == -1)
-                    empty_space = i;
-            }
-            else if (ht->compare(ht->buckets[bucket].data[i], value) == 0)  // value already exists
-            {
-                // if a destroy function exists, destroy the value
-                if (ht->destroy != NULL)
-                    ht->destroy(value);
-                return false;
+                const Pointer data = rbt_node_value(n);
+                const uint32_t hash_value = hash_of(ht, data);
+                bucket_insert(ht, get_bucket(ht, hash_value), data, hash_value, ht->is_map ? *rbt_map_node_value(n) : NULL);
             }
+            free_rbt(bkt);
         }
-
-        // value does not already exist, insert operation
-        ht->buckets[bucket].arr_el++;
-
-        if (ht->buckets[bucket].arr_el == OVERFLOW_SIZE)  // overflow
+        else
         {
-            // move all the elemenets to a rbt
-            ht->buckets[bucket].rbt = rbt_create(ht->compare, ht->destroy);
-            for (uint8_t i = 0; i < FIXED_SIZE; i++)
+            // the hash values of the array's elements are known
+            for (uint8_t j = 0; j < FIXED_SIZE; j++)
             {
-                if (ht->buckets[bucket].data[i] != NULL)
-                    rbt_insert(ht->buckets[bucket].rbt, ht->buckets[bucket].data[i]);
+                if (bkt->data[j] != NULL)
+                    bucket_insert(ht, get_bucket(ht, bkt->hashes[j]), bkt->data[j], bkt->hashes[j],
+                                  ht->is_map ? old_values[i * FIXED_SIZE + j] : NULL);
             }
-            rbt_insert(ht->buckets[bucket].rbt, value);
-
-            // data has now been moved to a rbt, no need for the array anymore
-            free(ht->buckets[bucket].data);
         }
+    }
+    free(old_buckets);
+    free(old_values);
+}
+
+// returns the address of the value's slot in the bucket (its value in map mode), inserting the value if it does not exist
+// if existing is given, the stored element is returned there and an existing value is not destroyed
+static Pointer* insert_value(const HashTable ht, const Pointer value, const uint32_t hash_value, bool* inserted, Pointer* existing)
+{
+    // max load factor exceeded, rehash to more buckets
+    if ((float)ht->elements >= MAX_LOAD_FACTOR * get_hash(ht->capacity) && ht->capacity != LAST_SIZE)
+        rehash(ht, ht->capacity + 1);
+    
+    // find the potential bucket the value belongs to
+    node* bkt = get_bucket(ht, hash_value);
+    
+    // insert at the rbt (which destroys the value if it already exists)
+    if (bkt->rbt != NULL)
+    {
+        count_lookup(ht, rbt_height(bkt->rbt));
+        Pointer* slot = NULL;
+        if (existing != NULL)
+            *inserted = rbt_get_or_insert(bkt->rbt, value, existing);
+        else if (ht->is_map)
+            slot = rbt_map_get_or_insert(bkt->rbt, value, inserted);
         else
-            ht->buckets[bucket].data[empty_space] = value;
+            *inserted = rbt_insert(bkt->rbt, value);
         
-        ht->elements++;  // value inserted, increment the number of elements in the hash table
-        return true;
+        if (*inserted) ht->elements++;  // value inserted, increment the number of elements in the hash table
+        return slot;
     }
 
-    // value already exists in the hash table
-    return false;
+    // search to see if value already exists
+    const uint8_t i = array_find(ht, bkt, value, hash_value);
+    if (i != FIXED_SIZE)  // value already exists
+    {
+        // if a destroy function exists, destroy the value (unless the existing element is asked for)
+        if (existing != NULL)
+            *existing = bkt->data[i];
+        else if (ht->destroy != NULL)
+            ht->destroy(value);
+        
+        *inserted = false;
+        return ht->is_map ? &value_at(ht, bkt, i) : NULL;
+    }
+    *inserted = true;
+    if (existing != NULL)
+        *existing = value;
+
+    // value does not already exist, insert operation
+    ht->elements++;  // value inserted, increment the number of elements in the hash table
+    return bucket_insert(ht, bkt, value, hash_value, NULL);
+}
+
+// inserts the value with the given hash value, returns true if it was inserted
+static inline bool insert_hashed(const HashTable ht, const Pointer value, const uint32_t hash_value)
+{
+    bool inserted;
+    insert_value(ht, value, hash_value, &inserted, NULL);
+    return inserted;
+}
+
+bool hash_insert(const HashTable ht, const Pointer value)
+{
+    assert(ht != NULL);
+    return insert_hashed(ht, value, hash_of(ht, value));
+}
+
+Pointer* hash_map_get_or_insert(const HashTable ht, const Pointer key, bool* inserted)
+{
+    assert(ht != NULL && ht->is_map && inserted != NULL);
+    return insert_value(ht, key, hash_of(ht, key), inserted, NULL);
+}
+
+bool hash_map_put(const HashTable ht, const Pointer key, const Pointer value)
+{
+    bool inserted;
+    Pointer* slot = hash_map_get_or_insert(ht, key, &inserted);
+
+    // the key already exists, destroy its old value
+    if (!inserted && ht->destroy_value != NULL && *slot != value)
+        ht->destroy_value(*slot);
+    
+    *slot = value;
+    return inserted;
+}
+
+Pointer* hash_map_get(const HashTable ht, const Pointer key)
+{
+    assert(ht != NULL && ht->is_map);
+
+    if (is_ht_empty(ht))  // hash table is empty, nothing to search
+        return NULL;
+    
+    // find the potential bucket the key exists in
+    const uint32_t hash_value = hash_of(ht, key);
+    node* bkt = get_bucket(ht, hash_value);
+    
+    // search the rbt
+    if (bkt->rbt != NULL)
+    {
+        count_lookup(ht, rbt_height(bkt->rbt));
+        return rbt_map_get(bkt->rbt, key);
+    }
+    
+    // search the array
+    const uint8_t i = array_find(ht, bkt, key, hash_value);
+    return i != FIXED_SIZE ? &value_at(ht, bkt, i) : NULL;
 }
 
 bool hash_remove(const HashTable ht, const Pointer value)
@@ -138,75 +409,196 @@ bool hash_remove(const HashTable ht, const Pointer value)
         return false;
     
     // find the potential bucket the value exists in
-    uint64_t bucket = ht->hash(value) % ht->capacity;
+    const uint32_t hash_value = hash_of(ht, value);
+    node* bkt = get_bucket(ht, hash_value);
 
-    if (ht->buckets[bucket].arr_el == OVERFLOW_SIZE)
+    if (bkt->rbt != NULL)
     {
-        if (rbt_remove(ht->buckets[bucket].rbt, value))
+        count_lookup(ht, rbt_height(bkt->rbt));
+
+        // the values are not destroyed by the rbt
+        if (ht->is_map && ht->destroy_value != NULL)
         {
-            ht->elements--;  // value removed, decrement the number of elements in the hash table
-            return true;
+            Pointer* slot = rbt_map_get(bkt->rbt, value);
+            if (slot != NULL)
+                ht->destroy_value(*slot);
         }
+        if (!rbt_remove(bkt->rbt, value))
+            return false;
+
+        // few elements left, move them back to an array
+        if (rbt_size(bkt->rbt) == UNTREEIFY_SIZE)
+            untreeify(ht, bkt);
     }
     else
     {
         // search for the value
-        bool found = false;
-        uint8_t i = 0;
-        for (i = 0; i < FIXED_SIZE; i++)
-        {
-            if (ht->buckets[bucket].data[i] != NULL && ht->compare(ht->buckets[bucket].data[i], value) == 0)
-            {
-                found = true;
-                break;
-            }
-        }
-        if (found)  // value found
-        {
-            // if a destroy function exists, destroy the value
-            if (ht->destroy != NULL)
-                ht->destroy(ht->buckets[bucket].data[i]);
-            
-            ht->buckets[bucket].data[i] = NULL;  // mark the spot empty
-            ht->buckets[bucket].arr_el--;
-            ht->elements--;  // value removed, decrement the number of elements in the hash table
-            return true;
-        }
+        const uint8_t i = array_find(ht, bkt, value, hash_value);
+        if (i == FIXED_SIZE)  // value does not exist in the hash table
+            return false;
+        
+        // if a destroy function exists, destroy the value
+        if (ht->destroy != NULL)
+            ht->destroy(bkt->data[i]);
+        if (ht->is_map && ht->destroy_value != NULL)
+            ht->destroy_value(value_at(ht, bkt, i));
+        
+        bkt->data[i] = NULL;  // mark the spot empty
+        bkt->arr_el--;
     }
+    ht->elements--;  // value removed, decrement the number of elements in the hash table
+    
+    // min load factor exceeded, rehash to fewer buckets
+    // (unless a scan is in progress, which a rehash starts over, it shrinks at a removal after the scan)
+    if ((float)ht->elements < MIN_LOAD_FACTOR * get_hash(ht->capacity) && ht->capacity != 0 && !ht->scanning)
+        rehash(ht, ht->capacity - 1);
     
-    // value does not exist in the hash table
-    return false;
+    return true;
 }
 
-bool hash_exists(const HashTable ht, const Pointer value)
+// returns true if the value, with the given hash value, exists in the hash table
+static inline bool exists_hashed(const HashTable ht, const Pointer value, const uint32_t hash_value)
 {
     if (is_ht_empty(ht))  // hash table is empty, nothing to search
         return false;
     
     // find the potential bucket the value exists in
-    uint64_t bucket = ht->hash(value) % ht->capacity;
+    node* bkt = get_bucket(ht, hash_value);
     
     // search the rbt
-    if (ht->buckets[bucket].arr_el == OVERFLOW_SIZE)
-        return rbt_exists(ht->buckets[bucket].rbt, value);
-    else  // search the array
+    if (bkt->rbt != NULL)
     {
-        for (uint8_t i = 0; i < FIXED_SIZE; i++)
+        count_lookup(ht, rbt_height(bkt->rbt));
+        return rbt_exists(bkt->rbt, value);
+    }
+    
+    // search the array
+    return array_find(ht, bkt, value, hash_value) != FIXED_SIZE;
+}
+
+bool hash_exists(const HashTable ht, const Pointer value)
+{
+    return exists_hashed(ht, value, hash_of(ht, value));
+}
+
+// returns the element of the bucket that is equal to value, NULL if it does not exist
+static inline Pointer bucket_find(const HashTable ht, const node* bkt, const Pointer value, const uint32_t hash_value)
+{
+    if (bkt->rbt != NULL)
+    {
+        count_lookup(ht, rbt_height(bkt->rbt));
+        const RBTreeNode n = rbt_find_node(bkt->rbt, value);
+        return n != NULL ? rbt_node_value(n) : NULL;
+    }
+    
+    const uint8_t i = array_find(ht, bkt, value, hash_value);
+    return i != FIXED_SIZE ? bkt->data[i] : NULL;
+}
+
+Pointer hash_find(const HashTable ht, const Pointer value)
+{
+    if (is_ht_empty(ht))  // hash table is empty, nothing to search
+        return NULL;
+
+    const uint32_t hash_value = hash_of(ht, value);
+    return bucket_find(ht, get_bucket(ht, hash_value), value, hash_value);
+}
+
+bool hash_get_or_insert(const HashTable ht, const Pointer value, Pointer* existing)
+{
+    assert(ht != NULL && existing != NULL);
+
+    bool inserted;
+    insert_value(ht, value, hash_of(ht, value), &inserted, existing);
+    return inserted;
+}
+
+// sets bit i of the result bitmap (if given) to b
+static inline void set_result(uint64_t* result, const uint64_t i, const bool b)
+{
+    if (result == NULL) return;
+
+    const uint64_t mask = (uint64_t)1 << (i % 64);
+    result[i / 64] = b ? (result[i / 64] | mask) : (result[i / 64] & ~mask);
+}
+
+// computes the hash values of the values [start, end) and prefetches the bucket of each
+static inline void prefetch_batch(const HashTable ht, const Pointer* values, const uint64_t start, const uint64_t end, uint32_t* hashes)
+{
+    for (uint64_t i = start; i < end; i++)
+    {
+        hashes[i - start] = hash_of(ht, values[i]);
+        __builtin_prefetch(get_bucket(ht, hashes[i - start]));
+    }
+}
+
+uint64_t hash_exists_many(const HashTable ht, const Pointer* values, const uint64_t n, uint64_t* result)
+{
+    assert(ht != NULL && (values != NULL || n == 0));
+
+    uint64_t found = 0;
+    uint32_t hashes[BATCH_SIZE];
+    for (uint64_t start = 0; start < n; start += BATCH_SIZE)
+    {
+        const uint64_t end = start + BATCH_SIZE < n ? start + BATCH_SIZE : n;
+        prefetch_batch(ht, values, start, end, hashes);
+
+        for (uint64_t i = start; i < end; i++)
+        {
+            const bool exists = exists_hashed(ht, values[i], hashes[i - start]);
+            set_result(result, i, exists);
+            found += exists;
+        }
+    }
+    return found;
+}
+
+uint64_t hash_insert_many(const HashTable ht, const Pointer* values, const uint64_t n, uint64_t* result)
+{
+    assert(ht != NULL && (values != NULL || n == 0));
+
+    uint64_t inserted = 0;
+    uint32_t hashes[BATCH_SIZE];
+    for (uint64_t start = 0; start < n; start += BATCH_SIZE)
+    {
+        const uint64_t end = start + BATCH_SIZE < n ? start + BATCH_SIZE : n;
+        prefetch_batch(ht, values, start, end, hashes);
+
+        for (uint64_t i = start; i < end; i++)
         {
-            if (ht->buckets[bucket].data[i] != NULL && ht->compare(ht->buckets[bucket].data[i], value) == 0)
-                return true;  // value found
+            const bool ins = insert_hashed(ht, values[i], hashes[i - start]);
+            set_result(result, i, ins);
+            inserted += ins;
         }
     }
-    return false;  // value not found
+    return inserted;
+}
+
+void hash_compact(const HashTable ht)
+{
+    assert(ht != NULL);  // nothing to compact
+}
+
+void hash_reserve(const HashTable ht, const uint64_t n)
+{
+    assert(ht != NULL);
+
+    // the smallest capacity that holds n elements within the max load factor
+    uint8_t capacity = 0;
+    while (n > MAX_LOAD_FACTOR * get_hash(capacity) && capacity != LAST_SIZE)
+        capacity++;
+
+    if (capacity > ht->capacity)
+        rehash(ht, capacity);
 }
 
 DestroyFunc hash_set_destroy(const HashTable ht, const DestroyFunc new_destroy_func)
 {
     assert(ht != NULL);
 
-    for (uint64_t i = 0; i < ht->capacity; i++)
+    for (uint64_t i = 0; i < get_hash(ht->capacity); i++)
     {
-        if (ht->buckets[i].arr_el == OVERFLOW_SIZE)  // elements are at a rbt in this bucket
+        if (ht->buckets[i].rbt != NULL)  // elements are at a rbt in this bucket
             rbt_set_destroy(ht->buckets[i].rbt, new_destroy_func);
     }
     
@@ -215,25 +607,164 @@ DestroyFunc hash_set_destroy(const HashTable ht, const DestroyFunc new_destroy_f
     return old_destroy_func;
 }
 
+void hash_stats(const HashTable ht, struct ht_stats* stats)
+{
+    assert(ht != NULL && stats != NULL);
+    memset(stats, 0, sizeof(struct ht_stats));
+
+    const uint64_t size = get_hash(ht->capacity);
+    stats->elements = ht->elements;
+    stats->buckets = size;
+    stats->load_factor = (double)ht->elements / size;
+    stats->bytes = sizeof(hash_table) + size * (sizeof(node) + (ht->is_map ? FIXED_SIZE * sizeof(Pointer) : 0));
+    stats->rehashes = ht->rehashes;
+    stats->lookups = ht->lookups;
+    stats->probes = ht->probes;
+
+    for (uint64_t i = 0; i < size; i++)
+    {
+        const node* bkt = &(ht->buckets[i]);
+        uint64_t length = bkt->arr_el;
+        if (bkt->rbt != NULL)
+        {
+            length = rbt_size(bkt->rbt);
+            stats->bytes += RBT_SIZE + length * (RBT_NODE_SIZE + (ht->is_map ? sizeof(Pointer) : 0));
+        }
+        stats->histogram[length < HT_HISTOGRAM_SIZE ? length : HT_HISTOGRAM_SIZE - 1]++;
+    }
+}
+
+// a scan cursor keeps the bucket to continue from, along with the (low 16 bits of the) number of rehashes when it was
+// returned, so a cursor to buckets that have been reallocated since then starts over
+#define CURSOR_POS_BITS 48
+#define make_cursor(ht, pos) (((ht)->rehashes << CURSOR_POS_BITS) | (pos))
+#define cursor_pos(ht, cursor) \
+    ((cursor) >> CURSOR_POS_BITS == ((ht)->rehashes & 0xFFFF) ? (cursor) & ((1ull << CURSOR_POS_BITS) - 1) : 0)
+
+// visits the elements of the bucket
+static inline void visit_bucket(const node* bkt, void (*visit)(Pointer value, void* context), void* context)
+{
+    if (bkt->rbt != NULL)
+    {
+        for (RBTreeNode n = rbt_first(bkt->rbt); n != NULL; n = rbt_find_next(n))
+            visit(rbt_node_value(n), context);
+    }
+    else
+    {
+        for (uint8_t i = 0; i < FIXED_SIZE; i++)
+            if (bkt->data[i] != NULL) visit(bkt->data[i], context);
+    }
+}
+
+void hash_foreach(const HashTable ht, void (*visit)(Pointer value, void* context), void* context)
+{
+    assert(ht != NULL && visit != NULL);
+
+    for (uint64_t i = 0; i < get_hash(ht->capacity); i++)
+        visit_bucket(&(ht->buckets[i]), visit, context);
+}
+
+// moves the iterator to the first element from spot pos (bucket * FIXED_SIZE + index in the array) onwards and
+// returns it, NULL if there is none - the elements of a rbt are at the first spot of their bucket
+static Pointer iter_seek(hash_iter* it, uint64_t pos)
+{
+    const HashTable ht = it->ht;
+    const uint64_t end = get_hash(ht->capacity) * FIXED_SIZE;
+
+    it->node = NULL;
+    for (; pos < end; pos++)
+    {
+        const node* bkt = &(ht->buckets[pos / FIXED_SIZE]);
+        if (bkt->rbt != NULL)
+        {
+            if (pos % FIXED_SIZE == 0)
+            {
+                it->node = rbt_first(bkt->rbt);
+                break;
+            }
+        }
+        else if (bkt->data[pos % FIXED_SIZE] != NULL)
+            break;
+    }
+
+    it->pos = pos;
+    if (pos == end)
+        return NULL;
+    return it->node != NULL ? rbt_node_value(it->node) : ht->buckets[pos / FIXED_SIZE].data[pos % FIXED_SIZE];
+}
+
+Pointer hash_iter_begin(const HashTable ht, hash_iter* it)
+{
+    assert(ht != NULL && it != NULL);
+
+    it->ht = ht;
+    return iter_seek(it, 0);
+}
+
+Pointer hash_iter_next(hash_iter* it)
+{
+    assert(it != NULL && it->ht != NULL);
+
+    if (it->node != NULL)  // next element of the rbt, or of the next bucket
+    {
+        it->node = rbt_find_next(it->node);
+        return it->node != NULL ? rbt_node_value(it->node) : iter_seek(it, it->pos + FIXED_SIZE);
+    }
+    return it->pos < get_hash(it->ht->capacity) * FIXED_SIZE ? iter_seek(it, it->pos + 1) : NULL;
+}
+
+Pointer* hash_iter_value(const hash_iter* it)
+{
+    assert(it != NULL && it->ht->is_map && it->pos < get_hash(it->ht->capacity) * FIXED_SIZE);
+    return it->node != NULL ? rbt_map_node_value(it->node) : &(it->ht->values[it->pos]);
+}
+
+// the elements stay at their buckets until the next rehash
+uint64_t hash_scan(const HashTable ht, const uint64_t cursor, const uint64_t count, void (*visit)(Pointer value, void* context), void* context)
+{
+    assert(ht != NULL && visit != NULL && count != 0);
+
+    const uint64_t size = get_hash(ht->capacity);
+    uint64_t pos = cursor_pos(ht, cursor);
+    for (const uint64_t end = pos + count; pos < end && pos < size; pos++)
+        visit_bucket(&(ht->buckets[pos]), visit, context);
+
+    ht->scanning = pos < size;
+    return pos < size ? make_cursor(ht, pos) : 0;
+}
+
 void hash_destroy(const HashTable ht)
 {
     assert(ht != NULL);
 
-    for (uint64_t i = 0; i < ht->capacity; i++)
+    const DestroyFunc destroy_value = ht->is_map ? ht->destroy_value : NULL;
+    for (uint64_t i = 0; i < get_hash(ht->capacity); i++)
     {
-        if (ht->buckets[i].arr_el != OVERFLOW_SIZE && ht->destroy != NULL)
+        node* bkt = &(ht->buckets[i]);
+        if (bkt->rbt != NULL)  // elements are at a rbt
+        {
+            // the values are not destroyed by the rbt
+            if (destroy_value != NULL)
+            {
+                for (RBTreeNode n = rbt_first(bkt->rbt); n != NULL; n = rbt_find_next(n))
+                    destroy_value(*rbt_map_node_value(n));
+            }
+            rbt_destroy(bkt->rbt);
+        }
+        else  // elements are at the array
         {
             for (uint8_t j = 0; j < FIXED_SIZE; j++)
             {
-                if (ht->buckets[i].data[j] != NULL)
-                    ht->destroy(ht->buckets[i].data[j]);
+                if (bkt->data[j] == NULL) continue;
+
+                if (ht->destroy != NULL)
+                    ht->destroy(bkt->data[j]);
+                if (destroy_value != NULL)
+                    destroy_value(value_at(ht, bkt, j));
             }
         }
-        if (ht->buckets[i].arr_el == OVERFLOW_SIZE)  // elements are at a rbt
-            rbt_destroy(ht->buckets[i].rbt);
-        else  // elements are at an array
-            free(ht->buckets[i].data);
     }
     free(ht->buckets);
+    free(ht->values);
     free(ht);
 }
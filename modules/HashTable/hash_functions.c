@@ -81,3 +81,128 @@ unsigned int hash_int3(Pointer value)
     hash = (hash ^ 0xb55a4f09) ^ (hash >> 16);
     return hash;
 }
+
+///////////////////////////
+// wyhash hash functions //
+///////////////////////////
+// word-at-a-time hashing based on wyhash (final version 4, public domain)
+// source: https://github.com/wangyi-fudan/wyhash
+// -every step multiplies two 64-bit words to a 128-bit product and folds it back with xor,
+//  so each input bit affects every output bit after a single round
+
+// default secret of wyhash
+static const uint64_t secret[4] = { 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+                                    0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull };
+
+static uint64_t hash_seed = 0x9e3779b97f4a7c15ull;
+
+void hash_set_seed(uint64_t seed) { hash_seed = seed; }
+
+uint64_t hash_get_seed(void) { return hash_seed; }
+
+// 64x64 -> 128 bit multiplication, folded back to 64 bits
+static inline uint64_t mix(uint64_t a, uint64_t b)
+{
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+// unaligned reads (memcpy compiles to a single load)
+static inline uint64_t read64(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint64_t read32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+// reads 1 to 3 bytes
+static inline uint64_t read_small(const uint8_t* p, size_t len)
+{
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+}
+
+static inline uint64_t wyhash(const void* data, size_t len, uint64_t seed)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t a, b;
+
+    seed ^= mix(seed ^ secret[0], secret[1]);
+    if (len <= 16)
+    {
+        if (len >= 4)
+        {
+            // two (possibly overlapping) 4-byte reads from each end cover all the bytes
+            size_t off = (len >> 3) << 2;
+            a = (read32(p) << 32) | read32(p + off);
+            b = (read32(p + len - 4) << 32) | read32(p + len - 4 - off);
+        }
+        else if (len > 0)
+        {
+            a = read_small(p, len);
+            b = 0;
+        }
+        else
+            a = b = 0;
+    }
+    else
+    {
+        size_t i = len;
+        if (i > 48)
+        {
+            // 3 independent lanes of 16 bytes, so the multiplications can run in parallel
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mix(read64(p) ^ secret[1], read64(p + 8) ^ seed);
+                see1 = mix(read64(p + 16) ^ secret[2], read64(p + 24) ^ see1);
+                see2 = mix(read64(p + 32) ^ secret[3], read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16)
+        {
+            seed = mix(read64(p) ^ secret[1], read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        // the last 16 bytes (overlapping the previous block if needed)
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+
+    a ^= secret[1];
+    b ^= seed;
+    __uint128_t r = (__uint128_t)a * b;
+    a = (uint64_t)r;
+    b = (uint64_t)(r >> 64);
+    return mix(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
+uint64_t hash_bytes(const void* data, size_t len, uint64_t seed)
+{
+    return wyhash(data, len, seed);
+}
+
+// strlen is vectorized by the C library, the hashing itself is word-at-a-time
+uint64_t hash_string64(Pointer value)
+{
+    const char* str = (*((const char**)value));
+    return wyhash(str, strlen(str), hash_seed);
+}
+
+unsigned int hash_string4(Pointer value)
+{
+    const char* str = (*((const char**)value));
+    uint64_t hash = wyhash(str, strlen(str), hash_seed);
+    return (unsigned int)(hash ^ (hash >> 32));
+}
+
+uint64_t hash_int64(Pointer value)
+{
+    uint64_t val = (uint32_t)(*((int*)value));
+    uint64_t hash = mix(val ^ hash_seed ^ secret[0], secret[1]);
+    return mix(hash ^ secret[2], val ^ secret[3]);
+}
+
+unsigned int hash_int4(Pointer value)
+{
+    uint64_t hash = hash_int64(value);
+    return (unsigned int)(hash ^ (hash >> 32));
+}
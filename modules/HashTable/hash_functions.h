@@ -1,13 +1,40 @@
 #pragma once  // include at most once
 
+#include <stddef.h>
+#include <stdint.h>
+
 typedef void* Pointer;
 
 // hashes an integer
 unsigned int hash_int1(Pointer);
 unsigned int hash_int2(Pointer);
 unsigned int hash_int3(Pointer);
+unsigned int hash_int4(Pointer);  // seeded, multiply-mix (wyhash) integer hash
 
 // hashes a string
 unsigned int hash_string1(Pointer);
 unsigned int hash_string2(Pointer);
 unsigned int hash_string3(Pointer);
+unsigned int hash_string4(Pointer);  // seeded, word-at-a-time (wyhash) string hash
+
+///////////////////////////
+// 64-bit hash functions //
+///////////////////////////
+// same as hash_int4/hash_string4 but they return the full 64-bit hash
+uint64_t hash_int64(Pointer);
+uint64_t hash_string64(Pointer);
+
+// hashes len bytes starting at data with the given seed
+// -word-at-a-time: reads 8 bytes at a time, no alignment requirements
+uint64_t hash_bytes(const void* data, size_t len, uint64_t seed);
+
+//////////////////////
+// hashing seed     //
+//////////////////////
+// the seeded functions (hash_int4, hash_string4, hash_int64, hash_string64) use a process-wide seed
+// setting it to a random value at startup makes the hashes unpredictable to an attacker (hash flooding)
+// -change it only while no hash table or bloom filter that uses these functions holds any elements
+void hash_set_seed(uint64_t seed);
+
+// returns the current process-wide seed
+uint64_t hash_get_seed(void);
@@ -0,0 +1,230 @@
+#pragma once  // include at most once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+// type-specialized hash tables
+// HT_DEFINE(name, key_t, hash_expr, eq_expr) generates a hash table storing key_t elements by value
+// -hash_expr(key) returns the (64-bit) hash value of a key
+// -eq_expr(a, b) returns true if the keys a and b are equal
+// both are expanded in place (a macro or an inline function), so unlike the Pointer-based hash table, hashing
+// and comparing need no function calls and can be optimized along with the rest of the operation
+//
+// the generated functions (name_create, name_insert, name_find, name_exists, name_remove, name_size,
+// name_destroy) are static inline, so every file can define the tables it needs, and there is no library to link
+// the elements are records: hash and compare only their key fields to map keys to the rest of the record
+//
+// the table is a robin hood hash table, like HashTable/RobinHood (linear probing, backward shift deletion)
+
+// when max load factor is exceeded, rehashing operation occurs
+#define HT_MAX_LOAD_FACTOR 0.9
+
+// initial number of buckets (a power of 2)
+#define HT_MIN_CAPACITY 32
+
+//////////////////////////////
+// provided hash functions  //
+//////////////////////////////
+
+// hashes an integer (murmur3's 64-bit finalizer)
+static inline uint64_t ht_hash_int(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+    return key;
+}
+
+// hashes a string, 8 bytes at a time
+static inline uint64_t ht_hash_string(const char* key)
+{
+    size_t len = strlen(key);
+    uint64_t hash = len * 0x9E3779B97F4A7C15ull, word;
+
+    for (; len >= 8; key += 8, len -= 8)
+    {
+        memcpy(&word, key, 8);
+        hash = ht_hash_int(hash ^ word);
+    }
+    word = 0;
+    memcpy(&word, key, len);
+    return ht_hash_int(hash ^ word);
+}
+
+// equality of integers (or any type that can be compared with ==)
+#define ht_eq(a, b) ((a) == (b))
+
+// equality of strings
+#define ht_eq_string(a, b) (strcmp((a), (b)) == 0)
+
+//////////////////////////////
+// template                 //
+//////////////////////////////
+// every bucket keeps the 32 high bits of the mixed hash value of its key (tag): the home bucket is its first
+// log2(capacity) bits, so rehashing does not need to hash the keys again, and the tags are compared before the keys
+// (there can be at most 2^32 buckets)
+
+#define HT_DEFINE(name, key_t, hash_expr, eq_expr)                                                           \
+                                                                                                              \
+typedef struct name##_bucket                                                                                  \
+{                                                                                                             \
+    key_t key;       /* the element */                                                                        \
+    uint32_t tag;    /* high bits of the element's mixed hash value */                                        \
+    uint32_t dist;   /* distance of the bucket from the element's home bucket + 1, 0 if the bucket is empty */ \
+}                                                                                                             \
+name##_bucket;                                                                                                \
+                                                                                                              \
+typedef struct name##_table                                                                                   \
+{                                                                                                             \
+    name##_bucket* buckets;  /* buckets storing the elements */                                               \
+    uint64_t capacity;       /* the number of buckets - a power of 2 */                                       \
+    uint8_t shift;           /* 32 - log2(capacity), used to find the home buckets from the tags */          \
+    uint64_t elements;       /* number of elements currently stored in the hash table */                      \
+}                                                                                                             \
+name##_table;                                                                                                 \
+                                                                                                              \
+typedef name##_table* name;                                                                                   \
+                                                                                                              \
+/* the tag of a key, fibonacci hashing spreads the bits of the hash value to the high bits */                 \
+static inline uint32_t name##_tag(const key_t key)                                                            \
+{                                                                                                             \
+    return (uint32_t)(((uint64_t)(hash_expr(key)) * 0x9E3779B97F4A7C15ull) >> 32);                            \
+}                                                                                                             \
+                                                                                                              \
+static inline void name##_allocate(const name ht, const uint64_t capacity)                                    \
+{                                                                                                             \
+    assert(capacity <= ((uint64_t)1 << 32));  /* the tags address at most 2^32 buckets */                     \
+    ht->capacity = capacity;                                                                                  \
+    ht->shift = 32 - __builtin_ctzll(capacity);                                                               \
+                                                                                                              \
+    ht->buckets = calloc(sizeof(name##_bucket), capacity);                                                    \
+    assert(ht->buckets != NULL);  /* allocation failure */                                                    \
+}                                                                                                             \
+                                                                                                              \
+/* creates hash table */                                                                                      \
+static inline name name##_create(void)                                                                        \
+{                                                                                                             \
+    name ht = malloc(sizeof(name##_table));                                                                   \
+    assert(ht != NULL);  /* allocation failure */                                                             \
+                                                                                                              \
+    name##_allocate(ht, HT_MIN_CAPACITY);                                                                     \
+    ht->elements = 0;                                                                                         \
+    return ht;                                                                                                \
+}                                                                                                             \
+                                                                                                              \
+/* returns the number of elements in the hash table */                                                       \
+static inline uint64_t name##_size(const name ht)                                                             \
+{                                                                                                             \
+    return ht->elements;                                                                                      \
+}                                                                                                             \
+                                                                                                              \
+/* places the element at the bucket pos, moving the elements closer to their home bucket further away */      \
+static inline void name##_place(const name ht, uint64_t pos, key_t key, uint32_t tag, uint32_t dist)          \
+{                                                                                                             \
+    while (ht->buckets[pos].dist != 0)                                                                        \
+    {                                                                                                         \
+        if (ht->buckets[pos].dist < dist)  /* swap them */                                                    \
+        {                                                                                                     \
+            const name##_bucket tmp = ht->buckets[pos];                                                       \
+            ht->buckets[pos] = (name##_bucket){ key, tag, dist };                                             \
+            key = tmp.key;                                                                                    \
+            tag = tmp.tag;                                                                                    \
+            dist = tmp.dist;                                                                                  \
+        }                                                                                                     \
+        pos = (pos + 1) & (ht->capacity - 1);                                                                 \
+        dist++;                                                                                               \
+    }                                                                                                         \
+    ht->buckets[pos] = (name##_bucket){ key, tag, dist };                                                     \
+}                                                                                                             \
+                                                                                                              \
+static void name##_rehash(const name ht)                                                                      \
+{                                                                                                             \
+    name##_bucket* old_buckets = ht->buckets;                                                                 \
+    const uint64_t old_capacity = ht->capacity;                                                               \
+                                                                                                              \
+    name##_allocate(ht, 2*old_capacity);                                                                      \
+    for (uint64_t i = 0; i < old_capacity; i++)                                                               \
+    {                                                                                                         \
+        if (old_buckets[i].dist != 0)                                                                         \
+            name##_place(ht, old_buckets[i].tag >> ht->shift, old_buckets[i].key, old_buckets[i].tag, 1);     \
+    }                                                                                                         \
+    free(old_buckets);                                                                                        \
+}                                                                                                             \
+                                                                                                              \
+/* returns the bucket holding the key, the capacity if it does not exist */                                   \
+static inline uint64_t name##_find_bucket(const name ht, const key_t key, const uint32_t tag)                 \
+{                                                                                                             \
+    uint64_t pos = tag >> ht->shift;                                                                          \
+    for (uint32_t dist = 1; ht->buckets[pos].dist >= dist; pos = (pos + 1) & (ht->capacity - 1), dist++)     \
+    {                                                                                                         \
+        if (ht->buckets[pos].tag == tag && (eq_expr(ht->buckets[pos].key, key)))                              \
+            return pos;                                                                                       \
+    }                                                                                                         \
+    return ht->capacity;                                                                                      \
+}                                                                                                             \
+                                                                                                              \
+/* inserts the key, returns true if it was inserted, false if it already exists */                            \
+static inline bool name##_insert(const name ht, const key_t key)                                              \
+{                                                                                                             \
+    if ((float)(ht->elements + 1) > HT_MAX_LOAD_FACTOR * ht->capacity)  /* max load factor exceeded */        \
+        name##_rehash(ht);                                                                                    \
+                                                                                                              \
+    const uint32_t tag = name##_tag(key);                                                                     \
+    uint64_t pos = tag >> ht->shift;                                                                          \
+    uint32_t dist = 1;                                                                                        \
+    for (; ht->buckets[pos].dist >= dist; pos = (pos + 1) & (ht->capacity - 1), dist++)                       \
+    {                                                                                                         \
+        if (ht->buckets[pos].tag == tag && (eq_expr(ht->buckets[pos].key, key)))  /* already exists */        \
+            return false;                                                                                     \
+    }                                                                                                         \
+                                                                                                              \
+    name##_place(ht, pos, key, tag, dist);                                                                    \
+    ht->elements++;                                                                                           \
+    return true;                                                                                              \
+}                                                                                                             \
+                                                                                                              \
+/* returns the address of the stored element equal to key, NULL if it does not exist */                       \
+/* the address remains valid until the hash table is modified */                                              \
+static inline key_t* name##_find(const name ht, const key_t key)                                              \
+{                                                                                                             \
+    const uint64_t pos = name##_find_bucket(ht, key, name##_tag(key));                                       \
+    return pos != ht->capacity ? &(ht->buckets[pos].key) : NULL;                                              \
+}                                                                                                             \
+                                                                                                              \
+/* returns true if the key exists in the hash table, false otherwise */                                       \
+static inline bool name##_exists(const name ht, const key_t key)                                              \
+{                                                                                                             \
+    return name##_find_bucket(ht, key, name##_tag(key)) != ht->capacity;                                      \
+}                                                                                                             \
+                                                                                                              \
+/* removes the key, returns true if it was removed, false if it does not exist */                             \
+static inline bool name##_remove(const name ht, const key_t key)                                              \
+{                                                                                                             \
+    uint64_t pos = name##_find_bucket(ht, key, name##_tag(key));                                              \
+    if (pos == ht->capacity)  /* key does not exist */                                                        \
+        return false;                                                                                         \
+                                                                                                              \
+    /* backward shift: move the following elements, that are not at their home bucket, one bucket back */    \
+    for (uint64_t next = (pos + 1) & (ht->capacity - 1); ht->buckets[next].dist > 1;                          \
+         pos = next, next = (next + 1) & (ht->capacity - 1))                                                  \
+    {                                                                                                         \
+        ht->buckets[pos] = ht->buckets[next];                                                                 \
+        ht->buckets[pos].dist--;                                                                              \
+    }                                                                                                         \
+    ht->buckets[pos].dist = 0;  /* mark the bucket as empty */                                                \
+                                                                                                              \
+    ht->elements--;                                                                                           \
+    return true;                                                                                              \
+}                                                                                                             \
+                                                                                                              \
+/* destroys the memory used by the hash table (the elements are stored by value, nothing else is freed) */    \
+static inline void name##_destroy(const name ht)                                                              \
+{                                                                                                             \
+    free(ht->buckets);                                                                                        \
+    free(ht);                                                                                                 \
+}
@@ -1,6 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
 #include "RedBlackTree.h"
 
 // source: http://staff.ustc.edu.cn/~csli/graduate/algorithms/book6/chap14.htm
@@ -18,6 +21,7 @@ typedef struct tnode
     COLORS col;  // represents the color of the node (Red/Black)
 
     struct tnode *left, *right, *parent;
+    Pointer value[];  // value associated with the data, only allocated in map mode
 }
 tnode;
 typedef struct tnode* RBTreeNode;
@@ -28,6 +32,8 @@ struct Set
     uint64_t size;        // number of elements in the tree
     CompareFunc compare;  // function that compares the elements - dictates the order of the elements
     DestroyFunc destroy;  // function that destroys the elements, NULL if not
+    DestroyFunc destroy_value;  // function that destroys the values in map mode, NULL if not
+    bool is_map;                // true if every element (key) is associated with a value
 };
 
 // function prototypes
@@ -36,9 +42,10 @@ static inline void left_rotation(RBTreeNode*, RBTreeNode*);
 static inline RBTreeNode find_successor(const RBTreeNode);
 static inline void shift_node(RBTreeNode*, const RBTreeNode, const RBTreeNode);
 static inline void fix_insert(RBTreeNode*, RBTreeNode*);
-static inline void fix_remove(RBTreeNode*, RBTreeNode*);
+static inline void fix_remove(RBTreeNode*, RBTreeNode, RBTreeNode);
 
-tnode NULLNode = {NULL, BLACK, NULL, NULL, NULL};  // dummy leaf node
+// leaves are NULL and always black
+#define color(node) ((node) == NULL ? BLACK : (node)->col)
 
 RBTree rbt_create(const CompareFunc compare, const DestroyFunc destroy)
 {
@@ -51,6 +58,17 @@ RBTree rbt_create(const CompareFunc compare, const DestroyFunc destroy)
     Tree->root = NULL;
     Tree->compare = compare;
     Tree->destroy = destroy;
+    Tree->destroy_value = NULL;
+    Tree->is_map = false;
+
+    return Tree;
+}
+
+RBTree rbt_map_create(const CompareFunc compare, const DestroyFunc destroy_key, const DestroyFunc destroy_value)
+{
+    RBTree Tree = rbt_create(compare, destroy_key);
+    Tree->destroy_value = destroy_value;
+    Tree->is_map = true;
 
     return Tree;
 }
@@ -67,15 +85,18 @@ bool is_rbt_empty(const RBTree Tree)
     return Tree->root == NULL;
 }
 
-// creates and returns node
-static inline RBTreeNode CreateNode()
+// creates and returns node, with room for a (NULL) value in map mode
+static inline RBTreeNode CreateNode(const RBTree Tree)
 {
-    RBTreeNode new_node = malloc(sizeof(tnode));
+    RBTreeNode new_node = malloc(sizeof(tnode) + (Tree->is_map ? sizeof(Pointer) : 0));
     assert(new_node != NULL);  // allocation failure
     
+    if (Tree->is_map)
+        new_node->value[0] = NULL;
+    
     new_node->col = RED;  // default color is red
-    new_node->left = &NULLNode;
-    new_node->right = &NULLNode;
+    new_node->left = NULL;
+    new_node->right = NULL;
     return new_node;
 }
 
@@ -85,7 +106,7 @@ RBTreeNode rbt_find_node(const RBTree Tree, const Pointer value)
     
     RBTreeNode node = Tree->root;
     
-    while (node != &NULLNode)
+    while (node != NULL)
     {
         int comp = Tree->compare(value, node->data);
         if (comp == 0)  // node->data == value
@@ -106,68 +127,229 @@ Pointer rbt_node_value(const RBTreeNode rbt_node)
     return rbt_node->data;
 }
 
-bool rbt_insert(const RBTree Tree, const Pointer value)
+// returns the node holding the value, inserting it if it does not exist (and setting inserted)
+static RBTreeNode insert_node(const RBTree Tree, const Pointer value, bool* inserted)
 {
-    assert(Tree != NULL);
-
     RBTreeNode* root = &(Tree->root);
-
-    RBTreeNode new_node = CreateNode();
-    assert(new_node != NULL);  // allocation failure
-    
-    new_node->data = value;
-    if (*root == NULL)  // empty tree
-    {
-        Tree->size = 1;
-        new_node->col = BLACK;  // root is black
-        new_node->parent = NULL;  // root's parent is NULL
-        *root = new_node;
-        return true;
-    }
     
     // standard BST insertion - by the end the node prev will 
     // be the parent of the node we will insert
     RBTreeNode prev = NULL, tmp = *root;
+    int prev_comp = 0;
 
-    int prev_comp, comp = Tree->compare(tmp->data, value);
-    while(true)
+    while (tmp != NULL)
     {
-        prev = tmp;
-        prev_comp = comp;
-
+        int comp = Tree->compare(tmp->data, value);
         if (comp == 0)  // value already exists
         {
-            free(new_node);
-
-            // if a destroy function exists, destroy the value
-            if (Tree->destroy != NULL)
-                Tree->destroy(value);
-            
-            return false;
+            *inserted = false;
+            return tmp;
         }
-        else if (comp < 0)  // tmp->data < value
+        
+        prev = tmp;
+        prev_comp = comp;
+
+        if (comp < 0)  // tmp->data < value
             tmp = tmp->right;
         else  // tmp->data >= value
             tmp = tmp->left;
-        
-        if (tmp != &NULLNode)
-            comp = Tree->compare(tmp->data, value);
-        else break;
     }
 
-    // save parent
-    new_node->parent = prev;
+    RBTreeNode new_node = CreateNode(Tree);
+    new_node->data = value;
+    new_node->parent = prev;  // save parent (NULL if the tree is empty)
 
-    if (prev_comp < 0)
+    if (prev == NULL)  // empty tree
+        *root = new_node;
+    else if (prev_comp < 0)
         prev->right = new_node;
     else
         prev->left = new_node;
 
     // fix possible violations
-    fix_insert(root, &new_node);  
+    RBTreeNode node = new_node;
+    fix_insert(root, &node);
 
     Tree->size++;  // value inserted, increment the number of elements in the tree
-    return true;
+    *inserted = true;
+    return new_node;
+}
+
+bool rbt_insert(const RBTree Tree, const Pointer value)
+{
+    assert(Tree != NULL);
+
+    bool inserted;
+    insert_node(Tree, value, &inserted);
+
+    // if the value already exists and a destroy function exists, destroy the value
+    if (!inserted && Tree->destroy != NULL)
+        Tree->destroy(value);
+    
+    return inserted;
+}
+
+bool rbt_get_or_insert(const RBTree Tree, const Pointer value, Pointer* existing)
+{
+    assert(Tree != NULL && existing != NULL);
+
+    bool inserted;
+    *existing = insert_node(Tree, value, &inserted)->data;
+    return inserted;
+}
+
+Pointer* rbt_map_get_or_insert(const RBTree Tree, const Pointer key, bool* inserted)
+{
+    assert(Tree != NULL && Tree->is_map && inserted != NULL);
+
+    RBTreeNode node = insert_node(Tree, key, inserted);
+
+    // if the key already exists and a destroy function exists, destroy the key
+    if (!(*inserted) && Tree->destroy != NULL)
+        Tree->destroy(key);
+    
+    return node->value;
+}
+
+bool rbt_map_put(const RBTree Tree, const Pointer key, const Pointer value)
+{
+    bool inserted;
+    Pointer* slot = rbt_map_get_or_insert(Tree, key, &inserted);
+
+    // the key already exists, destroy its old value
+    if (!inserted && Tree->destroy_value != NULL && *slot != value)
+        Tree->destroy_value(*slot);
+    
+    *slot = value;
+    return inserted;
+}
+
+Pointer* rbt_map_get(const RBTree Tree, const Pointer key)
+{
+    assert(Tree != NULL && Tree->is_map);
+
+    RBTreeNode node = rbt_find_node(Tree, key);
+    return node != NULL ? node->value : NULL;
+}
+
+Pointer* rbt_map_node_value(const RBTreeNode rbt_node)
+{
+    assert(rbt_node != NULL);
+    return rbt_node->value;
+}
+
+// returns the depth of the only, possibly, incomplete level of a balanced tree with n nodes
+static inline uint32_t bottom_level(uint64_t n)
+{
+    uint32_t level = 0;
+    for (n++; n > 1; n >>= 1)
+        level++;
+    
+    return level;
+}
+
+// links the (sorted) nodes in [start, end) into a balanced subtree and returns its root
+// only the nodes at the incomplete bottom level are colored red, so every path from the
+// root to a leaf passes through the same number of black nodes
+static RBTreeNode build_balanced(RBTreeNode* nodes, const uint64_t start, const uint64_t end, const RBTreeNode parent,
+                                 const uint32_t depth, const uint32_t red_depth)
+{
+    if (start == end)  // base case
+        return NULL;
+    
+    const uint64_t mid = start + (end - start)/2;
+    RBTreeNode node = nodes[mid];
+
+    node->parent = parent;
+    node->col = (depth == red_depth) ? RED : BLACK;
+    node->left = build_balanced(nodes, start, mid, node, depth+1, red_depth);
+    node->right = build_balanced(nodes, mid+1, end, node, depth+1, red_depth);
+
+    return node;
+}
+
+RBTree rbt_create_from_sorted(const CompareFunc compare, const DestroyFunc destroy, const Pointer* values, const uint64_t n)
+{
+    assert(values != NULL || n == 0);
+
+    RBTree Tree = rbt_create(compare, destroy);
+    if (n == 0) return Tree;
+
+    RBTreeNode* nodes = malloc(sizeof(RBTreeNode) * n);
+    assert(nodes != NULL);  // allocation failure
+
+    for (uint64_t i = 0; i < n; i++)
+    {
+        nodes[i] = CreateNode(Tree);
+        nodes[i]->data = values[i];
+    }
+
+    Tree->root = build_balanced(nodes, 0, n, NULL, 0, bottom_level(n));
+    Tree->size = n;
+
+    free(nodes);
+    return Tree;
+}
+
+uint64_t rbt_insert_sorted_batch(const RBTree Tree, const Pointer* values, const uint64_t n)
+{
+    assert(Tree != NULL);
+    assert(values != NULL || n == 0);
+
+    if (n == 0)  // nothing to insert
+        return 0;
+
+    // small batch, inserting the values one by one - O(n*log(size)) - is cheaper than rebuilding the tree - O(size+n)
+    if (Tree->size != 0 && n * bottom_level(Tree->size) < Tree->size)
+    {
+        uint64_t inserted = 0;
+        for (uint64_t i = 0; i < n; i++)
+            inserted += rbt_insert(Tree, values[i]);
+        
+        return inserted;
+    }
+
+    RBTreeNode* nodes = malloc(sizeof(RBTreeNode) * (Tree->size + n));
+    assert(nodes != NULL);  // allocation failure
+
+    // merge the (in order) nodes of the tree with the batch
+    uint64_t count = 0, inserted = 0, i = 0;
+    rbt_iter iter;
+    RBTreeNode node = rbt_iter_begin(Tree, &iter);
+    while (i < n)
+    {
+        const int comp = (node != NULL) ? Tree->compare(node->data, values[i]) : 1;
+
+        if (comp < 0)  // node->data < value, keep the node
+        {
+            nodes[count++] = node;
+            node = rbt_iter_next(&iter);
+        }
+        else if (comp == 0 || (count != 0 && Tree->compare(nodes[count-1]->data, values[i]) == 0))
+        {
+            // value already exists, in the tree or earlier in the batch
+            // if a destroy function exists, destroy it
+            if (Tree->destroy != NULL)
+                Tree->destroy(values[i]);
+            i++;
+        }
+        else  // node->data > value, insert the value
+        {
+            nodes[count] = CreateNode(Tree);
+            nodes[count++]->data = values[i++];
+            inserted++;
+        }
+    }
+
+    // the remaining nodes are all greater than the batch
+    for (; node != NULL; node = rbt_iter_next(&iter))
+        nodes[count++] = node;
+
+    Tree->root = build_balanced(nodes, 0, count, NULL, 0, bottom_level(count));
+    Tree->size = count;
+
+    free(nodes);
+    return inserted;
 }
 
 bool rbt_remove(RBTree Tree, Pointer value)
@@ -181,16 +363,19 @@ bool rbt_remove(RBTree Tree, Pointer value)
         return false;
     
     RBTreeNode node_to_be_deleted = tmp;
+    RBTreeNode parent;  // parent of tmp - tmp might be a (NULL) leaf, so it is kept separately
 
     COLORS col = tmp->col;   // save the color of the node that is about to be deleted
-    if (node_to_be_deleted->left == &NULLNode)
+    if (node_to_be_deleted->left == NULL)
     {
         tmp = node_to_be_deleted->right;
+        parent = node_to_be_deleted->parent;
         shift_node(root, node_to_be_deleted, node_to_be_deleted->right);
     }
-    else if (node_to_be_deleted->right == &NULLNode)
+    else if (node_to_be_deleted->right == NULL)
     {
         tmp = node_to_be_deleted->left;
+        parent = node_to_be_deleted->parent;
         shift_node(root, node_to_be_deleted, tmp);
     }
     else  // node has 2 children
@@ -200,12 +385,12 @@ bool rbt_remove(RBTree Tree, Pointer value)
         RBTreeNode successor = find_successor(node_to_be_deleted);
         col = successor->col;    // save the new color of the node
         tmp = successor->right;  // save the right child of the node we want to delete
-        successor->col = node_to_be_deleted->col;  // keep the color same
         
         if (successor->parent == node_to_be_deleted)   // successor's parent is the node that we want to delete
-            tmp->parent = successor;
+            parent = successor;
         else
         {
+            parent = successor->parent;
             shift_node(root, successor, successor->right);
             successor->right = node_to_be_deleted->right;
             successor->right->parent = successor;
@@ -214,15 +399,17 @@ bool rbt_remove(RBTree Tree, Pointer value)
         shift_node(root, node_to_be_deleted, successor);
         successor->left = node_to_be_deleted->left;
         successor->left->parent = successor;
-        successor->col = node_to_be_deleted->col;
+        successor->col = node_to_be_deleted->col;  // keep the color same
     }
 
     if (Tree->destroy != NULL)
         Tree->destroy(node_to_be_deleted->data);
+    if (Tree->is_map && Tree->destroy_value != NULL)
+        Tree->destroy_value(node_to_be_deleted->value[0]);
     free(node_to_be_deleted);
 
     if (col == BLACK)            // no violations if the node deleted is red
-        fix_remove(root, &tmp);  // if node is black, fix violations
+        fix_remove(root, tmp, parent);  // if node is black, fix violations
     
     Tree->size--;  // value removed, decrement the number of elements in the tree
     return true;
@@ -290,14 +477,16 @@ static inline void fix_insert(RBTreeNode* root, RBTreeNode* node)
 }
 
 // fix possible violations at removal
-static inline void fix_remove(RBTreeNode* root, RBTreeNode* node)
+// the node might be a (NULL) leaf, so its parent is given as well
+static inline void fix_remove(RBTreeNode* root, RBTreeNode node, RBTreeNode parent)
 {
-    while ((*node) != *root && (*node)->col == BLACK)
+    while (node != *root && color(node) == BLACK)
     {
         // S = sibling, n = node
-        if ((*node) == (*node)->parent->right)
+        // the sibling always exists, since the node's side is missing a black node
+        if (node == parent->right)
         {
-            RBTreeNode sibling = (*node)->parent->left;
+            RBTreeNode sibling = parent->left;
 
             // -CASE 1:
             // S is red. Since s must have black children, we can switch the colors
@@ -308,19 +497,20 @@ static inline void fix_remove(RBTreeNode* root, RBTreeNode* node)
             if (sibling->col == RED)
             {
                 sibling->col = BLACK;
-                (*node)->parent->col = RED; 
-                right_rotation(root, &((*node)->parent));
-                sibling = (*node)->parent->left;
+                parent->col = RED; 
+                right_rotation(root, &parent);
+                sibling = parent->left;
             }
 
             // -CASE 2:
             // S is black by now. If both of the children of s are black, since
             // s is black we make s red leaving only n with black color and s with
             // red. We then repeat the while loop with the parent as the node.
-            if (sibling->right->col == BLACK && sibling->left->col == BLACK)
+            if (color(sibling->right) == BLACK && color(sibling->left) == BLACK)
             {
                 sibling->col = RED;
-                (*node) = (*node)->parent;
+                node = parent;
+                parent = node->parent;
             }
             else
             {
@@ -330,12 +520,12 @@ static inline void fix_remove(RBTreeNode* root, RBTreeNode* node)
                 // perform a left rotation on the sibling without violating any of the
                 // red-black properties. The new sibling s of n is now a black node with
                 // a red left child, and thus case 3 is transformed into case 4.
-                if (sibling->left->col == BLACK)
+                if (color(sibling->left) == BLACK)
                 {
                     sibling->col = RED;
                     sibling->right->col = BLACK;
                     left_rotation(root, &sibling);
-                    sibling = (*node)->parent->left;
+                    sibling = parent->left;
                 }
 
                 // -CASE 4:
@@ -343,70 +533,88 @@ static inline void fix_remove(RBTreeNode* root, RBTreeNode* node)
                 // changes and performing a right rotation on its parent, we can remove the
                 // extra black on node without violating any of the red-black properties.
                 // We then terminate the loop by making the node the root.
-                sibling->col = (*node)->parent->col;
-                (*node)->parent->col = sibling->left->col = BLACK;
-                right_rotation(root, &((*node)->parent));
-                (*node) = (*root);  //  terminate
+                sibling->col = parent->col;
+                parent->col = sibling->left->col = BLACK;
+                right_rotation(root, &parent);
+                node = (*root);  //  terminate
             }
         }
         else  // node == parent->left
         {
             // The cases here are mirror of the previous ones, if we swap left with right.
-            RBTreeNode sibling = (*node)->parent->right;
+            RBTreeNode sibling = parent->right;
 
             // CASE 1
             if (sibling->col == RED)
             {
                 sibling->col = BLACK;
-                (*node)->parent->col = RED;
-                left_rotation(root, &((*node)->parent));
-                sibling = (*node)->parent->right;
+                parent->col = RED;
+                left_rotation(root, &parent);
+                sibling = parent->right;
             }
 
             // CASE 2
-            if (sibling->right->col == BLACK && sibling->left->col == BLACK)
+            if (color(sibling->right) == BLACK && color(sibling->left) == BLACK)
             {
                 sibling->col = RED;
-                (*node) = (*node)->parent;
+                node = parent;
+                parent = node->parent;
             }
             else
             {
                 // CASE 3
-                if (sibling->right->col == BLACK)
+                if (color(sibling->right) == BLACK)
                 {
                     sibling->col = RED;
                     sibling->left->col = BLACK;
                     right_rotation(root, &sibling);
-                    sibling = (*node)->parent->right;
+                    sibling = parent->right;
                 }
 
                 // CASE 4
-                sibling->col = (*node)->parent->col;
-                (*node)->parent->col = sibling->right->col = BLACK;
-                left_rotation(root, &((*node)->parent));
-                (*node) = (*root);  //  terminate
+                sibling->col = parent->col;
+                parent->col = sibling->right->col = BLACK;
+                left_rotation(root, &parent);
+                node = (*root);  //  terminate
             }
         }
     }
     
-    (*node)->col = BLACK;
+    if (node != NULL)
+        node->col = BLACK;
 }
 
-// destroys the nodes of the tree and their data, if a destroy function is given
-static void destroy_nodes(const RBTreeNode node, const DestroyFunc destroy_data)
+// destroys the nodes of the tree and their data (and values), if a destroy function is given
+// left children are rotated up until the node has none, then the node is destroyed and we move
+// to its right child, so every node is visited once without recursion or extra memory
+static void destroy_nodes(RBTreeNode node, const DestroyFunc destroy_data, const DestroyFunc destroy_value)
 {
-    if (node == &NULLNode)  // base case
-        return;
-
-    // first destroy the children, then the data
-    destroy_nodes(node->left, destroy_data);
-    destroy_nodes(node->right, destroy_data);
+    while (node != NULL)
+    {
+        if (node->left != NULL)
+        {
+            // right rotation, the left child takes the node's place
+            RBTreeNode left_child = node->left;
+            node->left = left_child->right;
+            left_child->right = node;
+            node = left_child;
+        }
+        else
+        {
+            RBTreeNode right_child = node->right;
 
-    // if a destroy function was given, destroy the data
-    if (destroy_data != NULL)
-        destroy_data(node->data);
-    
-    free(node);
+            // if a destroy function was given, destroy the data
+            if (destroy_data != NULL)
+                destroy_data(node->data);
+            
+            // in map mode, if a destroy function was given, destroy the value
+            if (destroy_value != NULL)
+                destroy_value(node->value[0]);
+            
+            free(node);
+            node = right_child;
+        }
+    }
 }
 
 void rbt_destroy(const RBTree Tree)
@@ -414,7 +622,7 @@ void rbt_destroy(const RBTree Tree)
     assert(Tree != NULL);
 
     if (Tree->root != NULL)
-        destroy_nodes(Tree->root, Tree->destroy);  // destroy the nodes
+        destroy_nodes(Tree->root, Tree->destroy, Tree->is_map ? Tree->destroy_value : NULL);  // destroy the nodes
     free(Tree);                                    // then the tree
 }
 
@@ -429,7 +637,7 @@ bool rbt_exists(const RBTree Tree, const Pointer value)
 static inline RBTreeNode node_max(const RBTreeNode node)
 {
     RBTreeNode tmp = node;
-    while (tmp->right != &NULLNode)
+    while (tmp->right != NULL)
         tmp = tmp->right;
 
     return tmp;
@@ -438,7 +646,7 @@ static inline RBTreeNode node_max(const RBTreeNode node)
 static inline RBTreeNode node_min(const RBTreeNode node)
 {
     RBTreeNode tmp = node;
-    while (tmp->left != &NULLNode)
+    while (tmp->left != NULL)
         tmp = tmp->left;
     
     return tmp;
@@ -456,7 +664,7 @@ static inline RBTreeNode find_successor(const RBTreeNode node)
 
 RBTreeNode rbt_find_previous(RBTreeNode target)
 {
-    if (target->left != &NULLNode)
+    if (target->left != NULL)
         return find_predecessor(target);
     
     // left tree does not exist, the next in order node is one of the ancestors
@@ -472,7 +680,7 @@ RBTreeNode rbt_find_previous(RBTreeNode target)
 
 RBTreeNode rbt_find_next(RBTreeNode target)
 {
-    if (target->right != &NULLNode)
+    if (target->right != NULL)
         return find_successor(target);
     
     // right tree does not exist, the previous in order node is one of the predecessors
@@ -486,6 +694,41 @@ RBTreeNode rbt_find_next(RBTreeNode target)
     return parent;
 }
 
+// pushes the node and its left descendants to the iterator's path
+static inline void iter_push_left(rbt_iter* iter, RBTreeNode node)
+{
+    for (; node != NULL; node = node->left)
+    {
+        assert(iter->top < RBT_MAX_HEIGHT);
+        iter->stack[(iter->top)++] = node;
+    }
+}
+
+RBTreeNode rbt_iter_begin(const RBTree Tree, rbt_iter* iter)
+{
+    assert(Tree != NULL && iter != NULL);
+
+    iter->top = 0;
+    if (Tree->size == 0) return NULL;
+
+    iter_push_left(iter, Tree->root);
+    return iter->stack[iter->top-1];
+}
+
+RBTreeNode rbt_iter_next(rbt_iter* iter)
+{
+    assert(iter != NULL);
+
+    if (iter->top == 0) return NULL;
+
+    // the current node is done, the next one is the lowest of its right subtree,
+    // or else the closest ancestor whose left subtree we just finished
+    RBTreeNode current = iter->stack[--(iter->top)];
+    iter_push_left(iter, current->right);
+
+    return (iter->top == 0) ? NULL : iter->stack[iter->top-1];
+}
+
 RBTreeNode rbt_first(const RBTree Tree)
 {
     assert(Tree != NULL);
@@ -523,7 +766,8 @@ static inline void shift_node(RBTreeNode* root, const RBTreeNode a, const RBTree
     else
         a->parent->left = b;
     
-    b->parent = a->parent;
+    if (b != NULL)
+        b->parent = a->parent;
 }
 
 // right rotation at node
@@ -532,7 +776,7 @@ static inline void right_rotation(RBTreeNode* root, RBTreeNode* node)
     RBTreeNode left_child = (*node)->left;
     (*node)->left = left_child->right;
 
-    if (left_child->right != &NULLNode)
+    if (left_child->right != NULL)
         left_child->right->parent = (*node);
     
     left_child->parent = (*node)->parent;
@@ -554,7 +798,7 @@ static inline void left_rotation(RBTreeNode* root, RBTreeNode* node)
     RBTreeNode right_child = (*node)->right;
     (*node)->right = right_child->left;
 
-    if (right_child->left != &NULLNode)
+    if (right_child->left != NULL)
         right_child->left->parent = (*node);
 
     right_child->parent = (*node)->parent;
@@ -569,3 +813,583 @@ static inline void left_rotation(RBTreeNode* root, RBTreeNode* node)
     right_child->left = (*node);
     (*node)->parent = right_child;
 }
+
+
+
+//////////////////////////////////////////
+// persistent (copy-on-write) versions  //
+//////////////////////////////////////////
+
+// Nodes can be shared by many versions, so they have no parent pointers and the trees are kept
+// left-leaning red-black, whose insertion and removal only walk down the path to the value.
+// Every node and value counts the links pointing to it - a node is only modified in place when
+// a single link points to it, meaning it was created by the update in progress, otherwise it is
+// copied first. Versions that are being read are therefore never modified.
+// source: https://sedgewick.io/wp-content/themes/sedgewick/papers/2008LLRB.pdf
+
+// value shared by the nodes that hold it
+typedef struct pvalue
+{
+    Pointer data;
+    _Atomic uint32_t refs;  // number of nodes holding the value
+}
+pvalue;
+
+typedef struct pnode
+{
+    pvalue* value;
+    struct pnode *left, *right;
+    _Atomic uint32_t refs;  // number of links (parent nodes or versions) pointing to the node
+    COLORS col;
+}
+pnode;
+
+struct rbt_version
+{
+    pnode* root;           // root node, NULL if the version is empty
+    uint64_t size;         // number of elements in the version
+    CompareFunc compare;   // function that compares the elements - dictates the order of the elements
+    DestroyFunc destroy;   // function that destroys the elements, NULL if not
+    _Atomic uint32_t refs; // number of handles to the version
+};
+
+#define is_red(node) ((node) != NULL && (node)->col == RED)
+
+static inline pnode* pnode_retain(pnode* node)
+{
+    if (node != NULL)
+        atomic_fetch_add_explicit(&node->refs, 1, memory_order_relaxed);
+    return node;
+}
+
+// drops a link to the node, destroying the node (and its value) when it was the last one
+static void pnode_release(pnode* node, const DestroyFunc destroy)
+{
+    if (node == NULL || atomic_fetch_sub_explicit(&node->refs, 1, memory_order_acq_rel) != 1)
+        return;
+
+    if (atomic_fetch_sub_explicit(&node->value->refs, 1, memory_order_acq_rel) == 1)
+    {
+        if (destroy != NULL)
+            destroy(node->value->data);
+        free(node->value);
+    }
+
+    pnode_release(node->left, destroy);
+    pnode_release(node->right, destroy);
+    free(node);
+}
+
+static inline pnode* pnode_create(const Pointer data)
+{
+    pnode* node = malloc(sizeof(pnode));
+    assert(node != NULL);  // allocation failure
+
+    node->value = malloc(sizeof(pvalue));
+    assert(node->value != NULL);  // allocation failure
+
+    node->value->data = data;
+    atomic_init(&node->value->refs, 1);
+    node->left = node->right = NULL;
+    atomic_init(&node->refs, 1);
+    node->col = RED;  // default color is red
+    return node;
+}
+
+// makes sure that the node pointed by the link can be modified, by copying it if it is shared
+static inline void own(pnode** link, const DestroyFunc destroy)
+{
+    pnode* node = *link;
+    if (node == NULL || atomic_load_explicit(&node->refs, memory_order_acquire) == 1)
+        return;
+
+    pnode* copy = malloc(sizeof(pnode));
+    assert(copy != NULL);  // allocation failure
+
+    copy->value = node->value;
+    atomic_fetch_add_explicit(&copy->value->refs, 1, memory_order_relaxed);
+    copy->left = pnode_retain(node->left);
+    copy->right = pnode_retain(node->right);
+    atomic_init(&copy->refs, 1);
+    copy->col = node->col;
+
+    pnode_release(node, destroy);
+    *link = copy;
+}
+
+// the rotations and color flips expect an owned node and take ownership of the children they modify
+static inline pnode* protate_left(pnode* node, const DestroyFunc destroy)
+{
+    own(&node->right, destroy);
+    pnode* right_child = node->right;
+
+    node->right = right_child->left;
+    right_child->left = node;
+    right_child->col = node->col;
+    node->col = RED;
+    return right_child;
+}
+
+static inline pnode* protate_right(pnode* node, const DestroyFunc destroy)
+{
+    own(&node->left, destroy);
+    pnode* left_child = node->left;
+
+    node->left = left_child->right;
+    left_child->right = node;
+    left_child->col = node->col;
+    node->col = RED;
+    return left_child;
+}
+
+static inline void flip_colors(pnode* node, const DestroyFunc destroy)
+{
+    own(&node->left, destroy);
+    own(&node->right, destroy);
+
+    node->col = !node->col;
+    node->left->col = !node->left->col;
+    node->right->col = !node->right->col;
+}
+
+// restores the left-leaning red-black properties on the way up
+static inline pnode* fix_up(pnode* node, const DestroyFunc destroy)
+{
+    if (is_red(node->right) && !is_red(node->left))
+        node = protate_left(node, destroy);
+    if (is_red(node->left) && is_red(node->left->left))
+        node = protate_right(node, destroy);
+    if (is_red(node->left) && is_red(node->right))
+        flip_colors(node, destroy);
+    
+    return node;
+}
+
+// inserts the value (that does not exist) at the owned subtree and returns its new root
+static pnode* pinsert(const RBTreeVersion version, pnode* node, const Pointer value)
+{
+    if (node == NULL)
+        return pnode_create(value);
+
+    if (version->compare(value, node->value->data) < 0)  // value < node->data
+    {
+        own(&node->left, version->destroy);
+        node->left = pinsert(version, node->left, value);
+    }
+    else  // value > node->data
+    {
+        own(&node->right, version->destroy);
+        node->right = pinsert(version, node->right, value);
+    }
+
+    return fix_up(node, version->destroy);
+}
+
+// makes the left child or one of its children red, so that we can remove from the left subtree
+static inline pnode* move_red_left(pnode* node, const DestroyFunc destroy)
+{
+    flip_colors(node, destroy);
+    if (is_red(node->right->left))
+    {
+        node->right = protate_right(node->right, destroy);
+        node = protate_left(node, destroy);
+        flip_colors(node, destroy);
+    }
+    return node;
+}
+
+// makes the right child or one of its children red, so that we can remove from the right subtree
+static inline pnode* move_red_right(pnode* node, const DestroyFunc destroy)
+{
+    flip_colors(node, destroy);
+    if (is_red(node->left->left))
+    {
+        node = protate_right(node, destroy);
+        flip_colors(node, destroy);
+    }
+    return node;
+}
+
+// removes the lowest value of the owned subtree and returns its new root
+static pnode* premove_min(pnode* node, const DestroyFunc destroy)
+{
+    if (node->left == NULL)
+    {
+        pnode_release(node, destroy);
+        return NULL;
+    }
+
+    if (!is_red(node->left) && !is_red(node->left->left))
+        node = move_red_left(node, destroy);
+
+    own(&node->left, destroy);
+    node->left = premove_min(node->left, destroy);
+    return fix_up(node, destroy);
+}
+
+// removes the value (that exists) from the owned subtree and returns its new root
+static pnode* premove(const RBTreeVersion version, pnode* node, const Pointer value)
+{
+    const DestroyFunc destroy = version->destroy;
+
+    if (version->compare(value, node->value->data) < 0)  // value < node->data
+    {
+        if (!is_red(node->left) && !is_red(node->left->left))
+            node = move_red_left(node, destroy);
+        
+        own(&node->left, destroy);
+        node->left = premove(version, node->left, value);
+    }
+    else  // value >= node->data
+    {
+        if (is_red(node->left))
+            node = protate_right(node, destroy);
+        
+        if (node->right == NULL)  // the value is at a leaf
+        {
+            pnode_release(node, destroy);
+            return NULL;
+        }
+
+        if (!is_red(node->right) && !is_red(node->right->left))
+            node = move_red_right(node, destroy);
+
+        if (version->compare(value, node->value->data) == 0)  // value found
+        {
+            // the successor's value takes the value's place and the successor is removed instead
+            pnode* successor = node->right;
+            while (successor->left != NULL)
+                successor = successor->left;
+            
+            pvalue* removed = node->value;
+            node->value = successor->value;
+            atomic_fetch_add_explicit(&node->value->refs, 1, memory_order_relaxed);
+            if (atomic_fetch_sub_explicit(&removed->refs, 1, memory_order_acq_rel) == 1)
+            {
+                if (destroy != NULL)
+                    destroy(removed->data);
+                free(removed);
+            }
+
+            own(&node->right, destroy);
+            node->right = premove_min(node->right, destroy);
+        }
+        else  // value > node->data
+        {
+            own(&node->right, destroy);
+            node->right = premove(version, node->right, value);
+        }
+    }
+
+    return fix_up(node, destroy);
+}
+
+// creates a new version sharing the root of the given one
+static inline RBTreeVersion version_copy(const RBTreeVersion version)
+{
+    RBTreeVersion new_version = malloc(sizeof(struct rbt_version));
+    assert(new_version != NULL);  // allocation failure
+
+    new_version->root = pnode_retain(version->root);
+    new_version->size = version->size;
+    new_version->compare = version->compare;
+    new_version->destroy = version->destroy;
+    atomic_init(&new_version->refs, 1);
+
+    return new_version;
+}
+
+RBTreeVersion rbt_persistent_create(const CompareFunc compare, const DestroyFunc destroy)
+{
+    assert(compare != NULL);  // a compare function needs to be given
+
+    RBTreeVersion version = malloc(sizeof(struct rbt_version));
+    assert(version != NULL);  // allocation failure
+
+    version->root = NULL;
+    version->size = 0;
+    version->compare = compare;
+    version->destroy = destroy;
+    atomic_init(&version->refs, 1);
+
+    return version;
+}
+
+bool rbt_version_exists(const RBTreeVersion version, const Pointer value)
+{
+    assert(version != NULL);
+
+    pnode* node = version->root;
+    while (node != NULL)
+    {
+        int comp = version->compare(value, node->value->data);
+        if (comp == 0)  // node->data == value
+            return true;
+        else if (comp < 0)  // value < node->data
+            node = node->left;
+        else  // value > node->data
+            node = node->right;
+    }
+
+    // value was not found
+    return false;
+}
+
+RBTreeVersion rbt_insert_persistent(const RBTreeVersion version, const Pointer value)
+{
+    assert(version != NULL);
+
+    if (rbt_version_exists(version, value))  // value already exists
+    {
+        // if a destroy function exists, destroy the value
+        if (version->destroy != NULL)
+            version->destroy(value);
+        
+        return rbt_version_retain(version);
+    }
+
+    RBTreeVersion new_version = version_copy(version);
+
+    own(&new_version->root, new_version->destroy);
+    new_version->root = pinsert(new_version, new_version->root, value);
+    new_version->root->col = BLACK;  // keep root black
+
+    new_version->size++;
+    return new_version;
+}
+
+RBTreeVersion rbt_remove_persistent(const RBTreeVersion version, const Pointer value)
+{
+    assert(version != NULL);
+
+    if (!rbt_version_exists(version, value))  // value does not exist
+        return rbt_version_retain(version);
+
+    RBTreeVersion new_version = version_copy(version);
+    
+    own(&new_version->root, new_version->destroy);
+    pnode* root = new_version->root;
+    if (!is_red(root->left) && !is_red(root->right))
+        root->col = RED;
+
+    new_version->root = premove(new_version, root, value);
+    if (new_version->root != NULL)
+        new_version->root->col = BLACK;  // keep root black
+
+    new_version->size--;
+    return new_version;
+}
+
+uint64_t rbt_version_size(const RBTreeVersion version)
+{
+    assert(version != NULL);
+    return version->size;
+}
+
+// visits the values of the subtree in order
+static void pnode_visit(const pnode* node, void (*visit)(Pointer, void*), void* context)
+{
+    if (node == NULL)  // base case
+        return;
+    
+    pnode_visit(node->left, visit, context);
+    visit(node->value->data, context);
+    pnode_visit(node->right, visit, context);
+}
+
+void rbt_version_foreach(const RBTreeVersion version, void (*visit)(Pointer, void*), void* context)
+{
+    assert(version != NULL && visit != NULL);
+    pnode_visit(version->root, visit, context);
+}
+
+RBTreeVersion rbt_version_retain(const RBTreeVersion version)
+{
+    assert(version != NULL);
+
+    atomic_fetch_add_explicit(&version->refs, 1, memory_order_relaxed);
+    return version;
+}
+
+void rbt_version_release(const RBTreeVersion version)
+{
+    assert(version != NULL);
+
+    if (atomic_fetch_sub_explicit(&version->refs, 1, memory_order_acq_rel) != 1)
+        return;
+
+    pnode_release(version->root, version->destroy);
+    free(version);
+}
+
+
+
+///////////////////////////////
+// concurrent access mode    //
+///////////////////////////////
+
+// The tree is a persistent version that writers replace, one at a time, with an updated one.
+// A reader adds itself to the reader count of the current phase (on its own cache line, so
+// readers do not contend with each other) before loading the version and removes itself when
+// done. After publishing a new version, the writer flips the phase twice and each time waits for
+// the readers of the previous phase to leave, so no reader can still be using the old version
+// when it is released.
+// source: https://www.kernel.org/doc/html/latest/RCU/whatisRCU.html
+
+#define READER_SLOTS 64  // number of reader counters, threads share them when there are more
+#define CACHE_LINE 64
+
+typedef struct reader_slot
+{
+    _Atomic uint64_t readers[2];  // number of readers in each phase
+    char padding[CACHE_LINE - 2*sizeof(uint64_t)];
+}
+reader_slot;
+
+struct rbt_concurrent
+{
+    reader_slot slots[READER_SLOTS];       // reader counters, first so that they are cache line aligned
+    _Atomic(RBTreeVersion) current;        // version currently read
+    _Atomic uint32_t phase;                // phase new readers join
+    pthread_mutex_t writer;                // serializes the writers
+};
+
+static _Atomic uint32_t next_slot = 0;        // slot given to the next thread that reads
+static _Thread_local int32_t reader_id = -1;  // slot of the thread
+
+static inline reader_slot* get_slot(const RBTreeConcurrent Tree)
+{
+    if (reader_id == -1)
+        reader_id = atomic_fetch_add(&next_slot, 1) % READER_SLOTS;
+    
+    return &(Tree->slots[reader_id]);
+}
+
+// marks the thread as reader of the current phase and returns the phase
+static inline uint32_t read_lock(const RBTreeConcurrent Tree, reader_slot* slot)
+{
+    const uint32_t phase = atomic_load(&Tree->phase);
+    atomic_fetch_add(&slot->readers[phase], 1);
+    return phase;
+}
+
+static inline void read_unlock(reader_slot* slot, const uint32_t phase)
+{
+    atomic_fetch_sub_explicit(&slot->readers[phase], 1, memory_order_release);
+}
+
+// waits until every reader that might have loaded the previous version is done
+static void wait_for_readers(const RBTreeConcurrent Tree)
+{
+    for (uint8_t flip = 0; flip < 2; flip++)
+    {
+        const uint32_t old_phase = atomic_fetch_xor(&Tree->phase, 1);
+        for (uint32_t i = 0; i < READER_SLOTS; i++)
+        {
+            while (atomic_load(&Tree->slots[i].readers[old_phase]) != 0)
+                sched_yield();
+        }
+    }
+}
+
+RBTreeConcurrent rbt_concurrent_create(const CompareFunc compare, const DestroyFunc destroy)
+{
+    size_t size = (sizeof(struct rbt_concurrent) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    RBTreeConcurrent Tree = aligned_alloc(CACHE_LINE, size);
+    assert(Tree != NULL);  // allocation failure
+
+    for (uint32_t i = 0; i < READER_SLOTS; i++)
+    {
+        atomic_init(&Tree->slots[i].readers[0], 0);
+        atomic_init(&Tree->slots[i].readers[1], 0);
+    }
+    atomic_init(&Tree->current, rbt_persistent_create(compare, destroy));
+    atomic_init(&Tree->phase, 0);
+    pthread_mutex_init(&Tree->writer, NULL);
+
+    return Tree;
+}
+
+// replaces the current version with the one returned by the update, returns true if the tree changed
+static bool concurrent_update(const RBTreeConcurrent Tree, const Pointer value, RBTreeVersion (*update)(const RBTreeVersion, const Pointer))
+{
+    pthread_mutex_lock(&Tree->writer);
+
+    RBTreeVersion old_version = atomic_load(&Tree->current);
+    RBTreeVersion new_version = update(old_version, value);
+
+    if (new_version->size == old_version->size)  // nothing changed
+    {
+        rbt_version_release(new_version);
+        pthread_mutex_unlock(&Tree->writer);
+        return false;
+    }
+
+    // publish the new version and release the old one once no reader uses it
+    atomic_store(&Tree->current, new_version);
+    wait_for_readers(Tree);
+    rbt_version_release(old_version);
+
+    pthread_mutex_unlock(&Tree->writer);
+    return true;
+}
+
+bool rbt_concurrent_insert(const RBTreeConcurrent Tree, const Pointer value)
+{
+    assert(Tree != NULL);
+    return concurrent_update(Tree, value, rbt_insert_persistent);
+}
+
+bool rbt_concurrent_remove(const RBTreeConcurrent Tree, const Pointer value)
+{
+    assert(Tree != NULL);
+    return concurrent_update(Tree, value, rbt_remove_persistent);
+}
+
+bool rbt_concurrent_exists(const RBTreeConcurrent Tree, const Pointer value)
+{
+    assert(Tree != NULL);
+
+    reader_slot* slot = get_slot(Tree);
+    const uint32_t phase = read_lock(Tree, slot);
+
+    const bool exists = rbt_version_exists(atomic_load(&Tree->current), value);
+
+    read_unlock(slot, phase);
+    return exists;
+}
+
+uint64_t rbt_concurrent_size(const RBTreeConcurrent Tree)
+{
+    assert(Tree != NULL);
+
+    reader_slot* slot = get_slot(Tree);
+    const uint32_t phase = read_lock(Tree, slot);
+
+    const uint64_t size = rbt_version_size(atomic_load(&Tree->current));
+
+    read_unlock(slot, phase);
+    return size;
+}
+
+RBTreeVersion rbt_concurrent_snapshot(const RBTreeConcurrent Tree)
+{
+    assert(Tree != NULL);
+
+    reader_slot* slot = get_slot(Tree);
+    const uint32_t phase = read_lock(Tree, slot);
+
+    RBTreeVersion version = rbt_version_retain(atomic_load(&Tree->current));
+
+    read_unlock(slot, phase);
+    return version;
+}
+
+void rbt_concurrent_destroy(const RBTreeConcurrent Tree)
+{
+    assert(Tree != NULL);
+
+    rbt_version_release(atomic_load(&Tree->current));
+    pthread_mutex_destroy(&Tree->writer);
+    free(Tree);
+}
@@ -23,9 +23,26 @@ typedef struct Set* RBTree;
 //           a destroy function (or NULL if you want to preserve the data)
 RBTree rbt_create(const CompareFunc, const DestroyFunc);
 
+// creates a perfectly balanced red-black tree out of an array of n values in linear time
+// -the values must be sorted in strictly ascending order (no duplicates), no comparisons are made
+// -requires a compare function
+//           a destroy function (or NULL if you want to preserve the data)
+RBTree rbt_create_from_sorted(const CompareFunc, const DestroyFunc, const Pointer*, const uint64_t);
+
 // returns true if the item is inserted, in any other case false
 bool rbt_insert(const RBTree, const Pointer);
 
+// inserts value if no equal element exists, searching for it only once
+// returns true if the value was inserted, false if an equal element exists - unlike rbt_insert, the value is not
+// destroyed then, and the stored element is returned at existing (set to value if it was inserted)
+bool rbt_get_or_insert(const RBTree, const Pointer value, Pointer* existing);
+
+// inserts an array of n values, sorted in ascending order, and returns the number of values inserted
+// values that already exist, or that are repeated in the batch, are destroyed (if a destroy function was given)
+// and inserted once, just like in rbt_insert
+// large batches are merged with the tree in linear time, small ones are inserted one by one
+uint64_t rbt_insert_sorted_batch(const RBTree, const Pointer*, const uint64_t);
+
 // returns true if the item is deleted, in any other case false
 bool rbt_remove(const RBTree, const Pointer);
 
@@ -66,3 +83,113 @@ RBTreeNode rbt_first(const RBTree);
 
 // returns the node with the highest value
 RBTreeNode rbt_last(const RBTree);
+
+//////////////////////////////
+// map mode                 //
+//////////////////////////////
+// a tree in map mode associates every element (key) with a value, stored in the key's node
+// all the functions above work on maps as well (eg. rbt_remove also destroys the key's value)
+
+// creates red-black tree in map mode
+// -requires a compare function
+//           a destroy function for the keys and one for the values (or NULL if you want to preserve the data)
+RBTree rbt_map_create(const CompareFunc, const DestroyFunc, const DestroyFunc);
+
+// inserts the key with the value, or replaces the value of the key if it already exists
+// (then the old value and the given key are destroyed, if destroy functions were given)
+// returns true if the key was inserted, false if it already existed
+bool rbt_map_put(const RBTree, const Pointer key, const Pointer value);
+
+// returns the address of the key's value, so it can be read or changed in place, NULL if the key does not exist
+Pointer* rbt_map_get(const RBTree, const Pointer key);
+
+// returns the address of the key's value, inserting the key with a NULL value if it does not exist
+// inserted is set to true if the key was inserted - otherwise the given key is destroyed, if a destroy function was given
+Pointer* rbt_map_get_or_insert(const RBTree, const Pointer key, bool* inserted);
+
+// returns the address of the value of the node
+Pointer* rbt_map_node_value(const RBTreeNode);
+
+// in order iterator, allocated by the caller (eg. on the stack)
+// it keeps the path to the current node, so no parent pointers are followed while iterating
+// the tree must not be modified while it is being iterated
+#define RBT_MAX_HEIGHT 128  // a red-black tree of n nodes is at most 2*log(n+1) high
+
+typedef struct rbt_iter
+{
+    RBTreeNode stack[RBT_MAX_HEIGHT];  // path from the root to the current node
+    uint8_t top;                       // number of nodes in the path
+}
+rbt_iter;
+
+// initializes the iterator and returns the node with the lowest value (NULL if the tree is empty)
+RBTreeNode rbt_iter_begin(const RBTree, rbt_iter*);
+
+// returns the next, in order, node or NULL if the iteration is over
+RBTreeNode rbt_iter_next(rbt_iter*);
+
+//////////////////////////////////////////
+// persistent (copy-on-write) versions  //
+//////////////////////////////////////////
+// a version is an immutable tree, so any number of threads can read it without locking
+// updates return a new version that copies only the O(log n) nodes on the path to the value
+// and shares the rest with the old one - nodes and values are freed once no version uses them
+typedef struct rbt_version* RBTreeVersion;  // version handle
+
+// creates an empty version
+// -requires a compare function
+//           a destroy function (or NULL if you want to preserve the data)
+RBTreeVersion rbt_persistent_create(const CompareFunc, const DestroyFunc);
+
+// returns a new version with the value inserted, the given version is left unchanged
+// if the value already exists, it is destroyed (if a destroy function was given) and the new version is the same as the old one
+RBTreeVersion rbt_insert_persistent(const RBTreeVersion, const Pointer);
+
+// returns a new version with the value removed, the given version is left unchanged
+RBTreeVersion rbt_remove_persistent(const RBTreeVersion, const Pointer);
+
+// returns true if the value exists in the version, false otherwise
+bool rbt_version_exists(const RBTreeVersion, const Pointer);
+
+// returns the size of the version
+uint64_t rbt_version_size(const RBTreeVersion);
+
+// visits, in order, the values of the version, passing the given context to the visit function
+void rbt_version_foreach(const RBTreeVersion, void (*visit)(Pointer value, void* context), void*);
+
+// returns a new handle to the version in O(1) (eg. a snapshot for a reader), that also has to be released
+RBTreeVersion rbt_version_retain(const RBTreeVersion);
+
+// releases the handle to the version
+void rbt_version_release(const RBTreeVersion);
+
+///////////////////////////////
+// concurrent access mode    //
+///////////////////////////////
+// a tree that can be read by any number of threads while others modify it
+// updates are serialized and publish a new persistent version, readers never lock - they only mark,
+// on a counter of their own, that they are using the current version so it is not freed under them
+typedef struct rbt_concurrent* RBTreeConcurrent;  // concurrent tree handle
+
+// creates concurrent red-black tree
+// -requires a compare function
+//           a destroy function (or NULL if you want to preserve the data)
+RBTreeConcurrent rbt_concurrent_create(const CompareFunc, const DestroyFunc);
+
+// returns true if the item is inserted, in any other case false
+bool rbt_concurrent_insert(const RBTreeConcurrent, const Pointer);
+
+// returns true if the item is deleted, in any other case false
+bool rbt_concurrent_remove(const RBTreeConcurrent, const Pointer);
+
+// returns true if the value exists, false otherwise
+bool rbt_concurrent_exists(const RBTreeConcurrent, const Pointer);
+
+// returns the size of the tree
+uint64_t rbt_concurrent_size(const RBTreeConcurrent);
+
+// returns the current version of the tree, for longer reads (eg. traversals) - it has to be released
+RBTreeVersion rbt_concurrent_snapshot(const RBTreeConcurrent);
+
+// destroys the memory used by the tree - no other thread may be using it
+void rbt_concurrent_destroy(const RBTreeConcurrent);
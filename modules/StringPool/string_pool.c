@@ -0,0 +1,215 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "string_pool.h"
+#include "../HashTable/SeparateChaining/hash_table.h"  // the interface is the same for every implementation
+#include "../HashTable/hash_functions.h"
+#include "../HashTable/typed_hash_table.h"  // ht_hash_int
+
+// size of the blocks of the arena, longer strings get a block of their own
+#define CHUNK_SIZE (64*1024)
+
+// initial size of the array of handles
+#define MIN_CAPACITY 64
+
+// seed of the hash of the strings, fixed so that the hash values of the stored strings never change
+// (unlike the process-wide seed of hash_string64, which the application can set at any time)
+#define POOL_SEED 0x243F6A8885A308D3ull
+
+// every string is stored right after its header and is followed by '\0'
+// the entries are padded so that the next header is aligned
+typedef struct header
+{
+    uint32_t id;      // id of the string
+    uint32_t length;  // length of the string, without the '\0'
+}
+header;
+
+#define header_of(handle) ((header*)((char*)(handle) - sizeof(header)))
+#define entry_size(len) ((sizeof(header) + (uint64_t)(len) + 1 + _Alignof(header) - 1) & ~(uint64_t)(_Alignof(header) - 1))
+
+typedef struct chunk
+{
+    struct chunk* next;  // the block that was allocated before this one
+    uint64_t used;       // bytes of the block used by the entries
+    uint64_t size;       // bytes of the block
+    char data[];         // the entries
+}
+chunk;
+
+typedef struct string_pool
+{
+    chunk* chunks;         // the arena, the strings are appended to the first block
+    uint64_t bytes;        // bytes allocated for the arena
+    const char** strings;  // the handles, indexed by their ids
+    uint32_t size;         // number of strings
+    uint32_t capacity;     // size of the array of handles
+    HashTable ht;          // the handles, to find the stored string that is equal to a given one
+}
+string_pool;
+
+// the hash table stores the handles: the strings are hashed and compared using the lengths kept in their headers
+static uint64_t hash_handle(Pointer handle)
+{
+    return hash_bytes(handle, header_of(handle)->length, POOL_SEED);
+}
+
+// a total order (the buckets of UsingRBT are red-black trees), by length and then by the bytes of the strings
+static int compare_handles(Pointer a, Pointer b)
+{
+    const uint32_t length_a = header_of(a)->length, length_b = header_of(b)->length;
+    if (length_a != length_b)
+        return length_a < length_b ? -1 : 1;
+    return memcmp(a, b, length_a);
+}
+
+StringPool sp_create(void)
+{
+    StringPool pool = malloc(sizeof(string_pool));
+    assert(pool != NULL);  // allocation failure
+
+    pool->chunks = NULL;
+    pool->bytes = 0;
+
+    pool->strings = malloc(sizeof(const char*) * MIN_CAPACITY);
+    assert(pool->strings != NULL);  // allocation failure
+    pool->size = 0;
+    pool->capacity = MIN_CAPACITY;
+
+    pool->ht = hash_create64(hash_handle, compare_handles, NULL);  // the strings are freed along with the arena
+    return pool;
+}
+
+// allocates a block with room for at least size bytes, the rest of the previous block is not used
+static void add_chunk(const StringPool pool, const uint64_t size)
+{
+    const uint64_t chunk_size = size > CHUNK_SIZE ? size : CHUNK_SIZE;
+
+    chunk* new_chunk = malloc(sizeof(chunk) + chunk_size);
+    assert(new_chunk != NULL);  // allocation failure
+
+    new_chunk->next = pool->chunks;
+    new_chunk->used = 0;
+    new_chunk->size = chunk_size;
+    pool->chunks = new_chunk;
+    pool->bytes += sizeof(chunk) + chunk_size;
+}
+
+// copies the string after the last entry of the arena, without using up the space: until it is kept,
+// the copy is overwritten by the next one, so searching for a string that already exists costs no memory
+static char* tentative_copy(const StringPool pool, const char* str, const uint32_t len)
+{
+    const uint64_t size = entry_size(len);
+    if (pool->chunks == NULL || pool->chunks->used + size > pool->chunks->size)
+        add_chunk(pool, size);
+
+    header* head = (header*)(pool->chunks->data + pool->chunks->used);
+    head->id = pool->size;
+    head->length = len;
+
+    char* handle = (char*)(head + 1);
+    memcpy(handle, str, len);
+    handle[len] = '\0';
+    return handle;
+}
+
+const char* sp_intern_n(const StringPool pool, const char* str, const uint32_t len)
+{
+    assert(pool->size < UINT32_MAX);  // the ids are exhausted
+
+    char* handle = tentative_copy(pool, str, len);
+
+    Pointer existing;
+    if (!hash_get_or_insert(pool->ht, handle, &existing))  // the string already exists
+        return existing;
+
+    // a new string, keep the copy
+    pool->chunks->used += entry_size(len);
+
+    if (pool->size == pool->capacity)
+    {
+        pool->capacity *= 2;
+        pool->strings = realloc(pool->strings, sizeof(const char*) * pool->capacity);
+        assert(pool->strings != NULL);  // allocation failure
+    }
+    pool->strings[pool->size++] = handle;
+    return handle;
+}
+
+const char* sp_intern(const StringPool pool, const char* str)
+{
+    const size_t len = strlen(str);
+    assert(len < UINT32_MAX);  // the length is kept in 32 bits
+
+    return sp_intern_n(pool, str, (uint32_t)len);
+}
+
+uint32_t sp_intern_id(const StringPool pool, const char* str)
+{
+    return sp_id(sp_intern(pool, str));
+}
+
+const char* sp_lookup(const StringPool pool, const char* str)
+{
+    const size_t len = strlen(str);
+    assert(len < UINT32_MAX);  // the length is kept in 32 bits
+
+    return hash_find(pool->ht, tentative_copy(pool, str, (uint32_t)len));
+}
+
+const char* sp_string(const StringPool pool, const uint32_t id)
+{
+    assert(id < pool->size);
+    return pool->strings[id];
+}
+
+uint32_t sp_id(const char* handle)
+{
+    return header_of(handle)->id;
+}
+
+uint32_t sp_length(const char* handle)
+{
+    return header_of(handle)->length;
+}
+
+uint32_t sp_size(const StringPool pool)
+{
+    return pool->size;
+}
+
+uint64_t sp_memory(const StringPool pool)
+{
+    struct ht_stats stats;
+    hash_stats(pool->ht, &stats);
+
+    return sizeof(string_pool) + pool->bytes + sizeof(const char*) * pool->capacity + stats.bytes;
+}
+
+void sp_destroy(const StringPool pool)
+{
+    hash_destroy(pool->ht);
+
+    chunk* curr = pool->chunks;
+    while (curr != NULL)
+    {
+        chunk* next = curr->next;
+        free(curr);
+        curr = next;
+    }
+
+    free(pool->strings);
+    free(pool);
+}
+
+// the ids are consecutive integers, their hash has to spread them over all the bits
+uint64_t sp_hash(Pointer handle)
+{
+    return ht_hash_int(header_of(handle)->id);
+}
+
+int sp_compare(Pointer a, Pointer b)
+{
+    const uint32_t id_a = header_of(a)->id, id_b = header_of(b)->id;
+    return (id_a > id_b) - (id_a < id_b);
+}
@@ -0,0 +1,65 @@
+#pragma once  // include at most once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef void* Pointer;
+
+typedef struct string_pool* StringPool;
+
+// string pool (string interning)
+// every distinct string is stored once, in large blocks of memory (arena), and is identified by
+// -a handle: a const char* to the stored, null-terminated copy of the string
+// -an id: a uint32_t, the ids are given in order of insertion (0, 1, 2, ...)
+// both remain valid until the pool is destroyed, so equal strings of the same pool have the same handle and the
+// same id: comparing them needs no strcmp, comparing the handles or the ids is enough
+// (the pool is not thread safe)
+
+// creates string pool
+StringPool sp_create(void);
+
+// inserts the string at the pool, if an equal string does not already exist
+// returns the handle of the stored string
+const char* sp_intern(const StringPool, const char* str);
+
+// same as sp_intern, but the string is the first len bytes of str - it does not have to be null-terminated
+// and it can contain '\0' bytes
+const char* sp_intern_n(const StringPool, const char* str, const uint32_t len);
+
+// same as sp_intern, but returns the id of the stored string
+uint32_t sp_intern_id(const StringPool, const char* str);
+
+// returns the handle of the string if it exists in the pool, NULL otherwise (nothing is inserted)
+const char* sp_lookup(const StringPool, const char* str);
+
+// returns the handle of the string with that id
+const char* sp_string(const StringPool, const uint32_t id);
+
+// returns the id of a handle
+uint32_t sp_id(const char* handle);
+
+// returns the length of a handle's string, in O(1)
+uint32_t sp_length(const char* handle);
+
+// returns the number of (distinct) strings in the pool
+uint32_t sp_size(const StringPool);
+
+// returns the bytes allocated by the pool: the arena, the ids and the internal hash table
+uint64_t sp_memory(const StringPool);
+
+// destroys the memory used by the pool, all of its handles are invalidated
+void sp_destroy(const StringPool);
+
+//////////////////////////////
+// handles as elements      //
+//////////////////////////////
+// the handles can be stored as the elements (keys) of the other ADTs: they are hashed and compared by their ids,
+// so the hash tables and trees never read the strings themselves
+// (the handles have to come from the same pool, the order is the order of insertion, not the lexicographic one)
+
+// hashes a handle (a HashFunc64, see hash_create64)
+uint64_t sp_hash(Pointer handle);
+
+// compares two handles by their ids (a CompareFunc)
+int sp_compare(Pointer a, Pointer b);
@@ -0,0 +1,220 @@
+#include <time.h>
+#include "../lib/ADT.h"
+#include "./include/common.h"
+
+#define NUM_OF_ELEMENTS 100000
+
+void test_create(void)
+{
+    BPTree bpt = bpt_create(compareFunction, free);
+    TEST_ASSERT(bpt != NULL);
+    TEST_ASSERT(bpt_size(bpt) == 0 && is_bpt_empty(bpt));
+    bpt_destroy(bpt);
+}
+
+void test_insert(void)
+{
+    // create create bpt
+    BPTree bpt = bpt_create(compareFunction, free);
+    
+    time_t t;
+    srand((unsigned) time(&t));
+    
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS);
+
+    clock_t cur_time = clock();
+    
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        // the value does not exist
+        TEST_ASSERT(!bpt_exists(bpt, arr+i));
+
+        // insert the value
+        bpt_insert(bpt, createData(arr[i]));
+
+        // the value now exists
+        TEST_ASSERT(bpt_exists(bpt, arr+i));
+
+        // the size has changed
+        TEST_ASSERT(bpt_size(bpt) == i+1);
+    }
+
+    double time_insert = calc_time(cur_time);  // calculate insert time
+
+    // free memory used
+    bpt_destroy(bpt);
+    free(arr);
+
+    // report time taken
+    printf("\n\nInsertion took %f seconds to complete\n", time_insert);
+}
+
+void test_remove(void)
+{
+    // create create bpt
+    BPTree bpt = bpt_create(compareFunction, free);
+    
+    time_t t;
+    srand((unsigned) time(&t));
+    
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS);
+
+    clock_t cur_time = clock();
+
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        bpt_insert(bpt, createData(arr[i]));
+    
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        // the value exists
+        TEST_ASSERT(bpt_exists(bpt, arr+i));
+
+        // remove the value
+        bpt_remove(bpt, arr+i);
+
+        // the value now does not exist
+        TEST_ASSERT(!bpt_exists(bpt, arr+i));
+
+        // the size has changed
+        TEST_ASSERT(bpt_size(bpt) == NUM_OF_ELEMENTS-i-1);
+    }
+
+    double time_insert = calc_time(cur_time);  // calculate remove time
+
+    // free memory used
+    bpt_destroy(bpt);
+    free(arr);
+
+    // report time taken
+    printf("\n\nDelete took %f seconds to complete\n", time_insert);
+}
+
+void test_traversal(void)
+{
+    // create bpt
+    BPTree bpt = bpt_create(compareFunction, free);
+    
+    time_t t;
+    srand((unsigned) time(&t));
+    
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS);
+
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        bpt_insert(bpt, createData(arr[i]));
+
+    // test forward traversal
+    int value = 0;
+    for (BPTreeNode node = bpt_first(bpt); node != NULL; node = bpt_find_next(node), value++)
+        TEST_ASSERT( *((int*)bpt_node_value(node)) == value);
+
+    // test backward traversal
+    value = NUM_OF_ELEMENTS-1;
+    for (BPTreeNode node = bpt_last(bpt); node != NULL; node = bpt_find_previous(node), value--)
+        TEST_ASSERT( *((int*)bpt_node_value(node)) == value);
+
+    // free memory used
+    bpt_destroy(bpt);
+    free(arr);
+}
+
+void test_mixed(void)
+{
+    // create bpt
+    BPTree bpt = bpt_create(compareFunction, free);
+
+    time_t t;
+    srand((unsigned) time(&t));
+
+    // the values in [0, NUM_OF_ELEMENTS/2) are inserted and removed at random, while keeping track of them
+    bool* exists = calloc(NUM_OF_ELEMENTS/2, sizeof(bool));
+    assert(exists != NULL);  // allocation failure
+
+    uint64_t size = 0;
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        int value = rand() % (NUM_OF_ELEMENTS/2);
+
+        if (rand() % 3 != 0)
+        {
+            TEST_ASSERT(bpt_insert(bpt, createData(value)) == !exists[value]);
+            if (!exists[value]) size++;
+            exists[value] = true;
+        }
+        else
+        {
+            TEST_ASSERT(bpt_remove(bpt, &value) == exists[value]);
+            if (exists[value]) size--;
+            exists[value] = false;
+        }
+        TEST_ASSERT(bpt_size(bpt) == size);
+    }
+
+    // the tree holds exactly the values that should exist, in order
+    int value = -1;
+    for (BPTreeNode node = bpt_first(bpt); node != NULL; node = bpt_find_next(node))
+    {
+        int cur = *((int*)bpt_node_value(node));
+        TEST_ASSERT(cur > value && exists[cur]);
+        value = cur;
+        size--;
+    }
+    TEST_ASSERT(size == 0);
+
+    // free memory used
+    bpt_destroy(bpt);
+    free(exists);
+}
+
+// compares lookups with the red-black tree, for sets ranging from cache to main memory resident
+void test_lookup(void)
+{
+    time_t t;
+    srand((unsigned) time(&t));
+
+    printf("\n\n%12s %16s %16s\n", "elements", "red-black tree", "B+ tree");
+    for (uint32_t num_of_elements = 10000; num_of_elements <= 10*NUM_OF_ELEMENTS; num_of_elements *= 10)
+    {
+        int* arr = create_shuffled_array(num_of_elements);
+        int* lookups = create_shuffled_array(num_of_elements);
+
+        RBTree rbt = rbt_create(compareFunction, NULL);
+        BPTree bpt = bpt_create(compareFunction, NULL);
+        for (uint32_t i = 0; i < num_of_elements; i++)
+        {
+            rbt_insert(rbt, arr+i);
+            bpt_insert(bpt, arr+i);
+        }
+
+        // each tree looks up every value, in random order, a few times
+        clock_t cur_time = clock();
+        for (uint32_t r = 0; r < 10*NUM_OF_ELEMENTS / num_of_elements; r++)
+            for (uint32_t i = 0; i < num_of_elements; i++)
+                TEST_ASSERT(rbt_exists(rbt, lookups+i));
+        double time_rbt = calc_time(cur_time);
+
+        cur_time = clock();
+        for (uint32_t r = 0; r < 10*NUM_OF_ELEMENTS / num_of_elements; r++)
+            for (uint32_t i = 0; i < num_of_elements; i++)
+                TEST_ASSERT(bpt_exists(bpt, lookups+i));
+        double time_bpt = calc_time(cur_time);
+
+        // report time taken
+        printf("%12u %15fs %15fs\n", num_of_elements, time_rbt, time_bpt);
+
+        // free memory used
+        rbt_destroy(rbt);
+        bpt_destroy(bpt);
+        free(arr);
+        free(lookups);
+    }
+}
+
+TEST_LIST = {
+        { "create", test_create  },
+        { "insert", test_insert  },
+        { "remove", test_remove  },
+        { "traversal", test_traversal  },
+        { "mixed", test_mixed  },
+        { "lookup", test_lookup  },
+        { NULL, NULL }
+};
@@ -5,6 +5,16 @@
 #define NUM_OF_ELEMENTS 100000
 #define BLOOM_SIZE NUM_OF_ELEMENTS*5
 
+// upper bound of the false positive rate of a bloom filter with k hash functions, n elements and m bits:
+// every bit is set with probability 1 - (1 - 1/m)^(kn) <= kn/m, and a false positive needs k set bits
+static double max_false_positive_rate(const uint32_t k, const double n, const double m)
+{
+    double rate = 1;
+    for (uint32_t i = 0; i < k; i++)
+        rate *= k*n/m;
+    return rate;
+}
+
 void test_create(void)
 {
     HashFunc hash_functions[] = {hash_int1, hash_int2, hash_int3};
@@ -32,6 +42,7 @@ void test_insert(void)
             false_positives++;
 
     printf("False positives: %d\n", false_positives);
+    TEST_ASSERT(false_positives < max_false_positive_rate(3, NUM_OF_ELEMENTS, 3.0*BLOOM_SIZE) * NUM_OF_ELEMENTS);
 
     // free memory used
     bf_destroy(bf);
@@ -39,8 +50,35 @@ void test_insert(void)
     free(new_array);
 }
 
+void test_insert64(void)
+{
+    HashFunc64 hash_functions[] = {hash_int64};
+    bloom_filter bf = bf_create64(BLOOM_SIZE, hash_functions, sizeof(hash_functions)/sizeof(HashFunc64));
+
+    int* arr = create_ordered_array(NUM_OF_ELEMENTS*2);
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        bf_insert(bf, &arr[i]);
+
+    // no false negatives
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        TEST_ASSERT(bf_exists(bf, &arr[i]));
+
+    unsigned int false_positives = 0;
+    for (uint32_t i = NUM_OF_ELEMENTS; i < NUM_OF_ELEMENTS*2; i++)
+        if (bf_exists(bf, &arr[i]))
+            false_positives++;
+
+    printf("False positives: %d\n", false_positives);
+    TEST_ASSERT(false_positives < max_false_positive_rate(1, NUM_OF_ELEMENTS, BLOOM_SIZE) * NUM_OF_ELEMENTS);
+
+    // free memory used
+    bf_destroy(bf);
+    free(arr);
+}
+
 TEST_LIST = {
         { "create", test_create  },
         { "insert", test_insert  },
+        { "insert64", test_insert64  },
         { NULL, NULL }
 };
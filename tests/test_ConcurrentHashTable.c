@@ -0,0 +1,319 @@
+// tests the concurrent hash table (the library has to be built with HT_IMPLEMENTATION = SeparateChaining)
+#include <time.h>
+#include <pthread.h>
+#include "../lib/ADT.h"
+#include "./include/common.h"
+
+#define NUM_OF_ELEMENTS 1000000
+#define MAX_THREADS 32
+#define OPS_PER_THREAD 200000
+
+static inline double wall_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct
+{
+    HashTable ht;
+    pthread_rwlock_t* lock;  // lock of the hash table, NULL if it is concurrent
+    int* values;
+    int id;
+    int num_of_threads;
+}
+thread_args;
+
+void test_create(void)
+{
+    HashTable ht = hash_create_concurrent(hash_int1, compareFunction, free);
+    TEST_ASSERT(ht != NULL);
+    TEST_ASSERT(hash_size(ht) == 0 && is_ht_empty(ht));
+
+    // only the buckets of the shards (64 of 67 buckets each) are counted, the hash table itself has none
+    struct ht_stats stats;
+    hash_stats(ht, &stats);
+    TEST_ASSERT(stats.buckets == 64*67 && stats.histogram[0] == stats.buckets);
+    TEST_ASSERT(stats.elements == 0 && stats.load_factor == 0);
+    hash_destroy(ht);
+
+    // with a 64-bit hash function
+    ht = hash_create_concurrent64(hash_int64, compareFunction, free);
+    TEST_ASSERT(ht != NULL && is_ht_empty(ht));
+    for (int i = 0; i < 1000; i++)
+        TEST_ASSERT(hash_insert(ht, createData(i)));
+    for (int i = 0; i < 1000; i += 2)
+        TEST_ASSERT(hash_remove(ht, &i));
+    for (int i = 0; i < 1000; i++)
+        TEST_ASSERT(hash_exists(ht, &i) == (i % 2 == 1));
+    TEST_ASSERT(hash_size(ht) == 500);
+    hash_destroy(ht);
+
+    // reserving room sizes every shard, so that inserting the elements does not rehash any of them
+    ht = hash_create_concurrent(hash_int1, compareFunction, free);
+    hash_reserve(ht, 100000);
+    struct ht_stats before, after;
+    hash_stats(ht, &before);
+    for (int i = 0; i < 100000; i++)
+        TEST_ASSERT(hash_insert(ht, createData(i)));
+    hash_stats(ht, &after);
+    TEST_ASSERT(after.rehashes == before.rehashes && after.elements == 100000);
+    hash_destroy(ht);
+}
+
+// every thread inserts, searches and removes its own part of the values
+static void* insert_remove_worker(void* arg)
+{
+    thread_args* args = arg;
+    const uint32_t part = NUM_OF_ELEMENTS / args->num_of_threads;
+    const int* values = args->values + args->id * part;
+
+    for (uint32_t i = 0; i < part; i++)
+    {
+        TEST_ASSERT(hash_insert(args->ht, createData(values[i])));
+        TEST_ASSERT(!hash_insert(args->ht, createData(values[i])));  // already exists
+        TEST_ASSERT(hash_exists(args->ht, (Pointer)(values + i)));
+    }
+
+    // remove the first half of the part
+    for (uint32_t i = 0; i < part/2; i++)
+    {
+        TEST_ASSERT(hash_remove(args->ht, (Pointer)(values + i)));
+        TEST_ASSERT(!hash_exists(args->ht, (Pointer)(values + i)));
+    }
+    return NULL;
+}
+
+void test_insert_remove(void)
+{
+    HashTable ht = hash_create_concurrent(hash_int1, compareFunction, free);
+
+    time_t t;
+    srand((unsigned) time(&t));
+    
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS);
+
+    const int num_of_threads = 8;
+    const uint32_t part = NUM_OF_ELEMENTS / num_of_threads;
+
+    pthread_t threads[MAX_THREADS];
+    thread_args args[MAX_THREADS];
+    for (int i = 0; i < num_of_threads; i++)
+    {
+        args[i] = (thread_args){ ht, NULL, arr, i, num_of_threads };
+        pthread_create(threads+i, NULL, insert_remove_worker, args+i);
+    }
+    for (int i = 0; i < num_of_threads; i++)
+        pthread_join(threads[i], NULL);
+
+    // only the second half of every part is left
+    TEST_ASSERT(hash_size(ht) == (uint64_t)num_of_threads * (part - part/2));
+    for (int i = 0; i < num_of_threads; i++)
+    {
+        for (uint32_t j = 0; j < part; j++)
+            TEST_ASSERT(hash_exists(ht, arr + i*part + j) == (j >= part/2));
+    }
+
+    // free memory used
+    hash_destroy(ht);
+    free(arr);
+}
+
+// 90% lookups of existing values, 10% insertions and removals of new values
+static void* mixed_worker(void* arg)
+{
+    thread_args* args = arg;
+    unsigned int seed = args->id;
+    int value = NUM_OF_ELEMENTS + args->id * OPS_PER_THREAD;
+
+    for (int i = 0; i < OPS_PER_THREAD; i++)
+    {
+        if (i % 10 == 0)
+        {
+            if (args->lock != NULL) pthread_rwlock_wrlock(args->lock);
+            if (i % 20 == 0)
+                hash_insert(args->ht, createData(++value));
+            else
+                hash_remove(args->ht, &value);
+            if (args->lock != NULL) pthread_rwlock_unlock(args->lock);
+        }
+        else
+        {
+            if (args->lock != NULL) pthread_rwlock_rdlock(args->lock);
+            TEST_ASSERT(hash_exists(args->ht, args->values + rand_r(&seed) % NUM_OF_ELEMENTS));
+            if (args->lock != NULL) pthread_rwlock_unlock(args->lock);
+        }
+    }
+    return NULL;
+}
+
+// runs the mixed workload on the hash table with the number of threads, returns the operations per second
+static double run_mixed(HashTable ht, pthread_rwlock_t* lock, int* values, int num_of_threads)
+{
+    pthread_t threads[MAX_THREADS];
+    thread_args args[MAX_THREADS];
+    for (int i = 0; i < num_of_threads; i++)
+        args[i] = (thread_args){ ht, lock, values, i, num_of_threads };
+
+    double cur_time = wall_time();
+    for (int i = 0; i < num_of_threads; i++)
+        pthread_create(threads+i, NULL, mixed_worker, args+i);
+    for (int i = 0; i < num_of_threads; i++)
+        pthread_join(threads[i], NULL);
+    
+    return (double)num_of_threads * OPS_PER_THREAD / (wall_time() - cur_time);
+}
+
+// every thread tries to insert all the values, counting the ones it inserted
+static void* get_or_insert_worker(void* arg)
+{
+    thread_args* args = arg;
+    uint64_t inserted = 0;
+
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        Pointer existing = NULL;
+        if (hash_get_or_insert(args->ht, args->values + i, &existing))
+            inserted++;
+        TEST_ASSERT(*((int*)existing) == args->values[i]);
+    }
+    return (void*)inserted;
+}
+
+void test_get_or_insert(void)
+{
+    HashTable ht = hash_create_concurrent(hash_int1, compareFunction, NULL);
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS);
+
+    // every value is inserted by exactly one of the threads
+    const int num_of_threads = 4;
+    pthread_t threads[MAX_THREADS];
+    thread_args args[MAX_THREADS];
+    for (int i = 0; i < num_of_threads; i++)
+    {
+        args[i] = (thread_args){ ht, NULL, arr, i, num_of_threads };
+        pthread_create(threads+i, NULL, get_or_insert_worker, args+i);
+    }
+
+    uint64_t inserted = 0;
+    for (int i = 0; i < num_of_threads; i++)
+    {
+        void* count;
+        pthread_join(threads[i], &count);
+        inserted += (uint64_t)count;
+    }
+    TEST_ASSERT(inserted == NUM_OF_ELEMENTS && hash_size(ht) == NUM_OF_ELEMENTS);
+
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        TEST_ASSERT(hash_find(ht, arr+i) == arr+i);  // the threads inserted the same pointers
+
+    // free memory used
+    hash_destroy(ht);
+    free(arr);
+}
+
+// every thread inserts its own part of the values
+static void* insert_worker(void* arg)
+{
+    thread_args* args = arg;
+    const uint32_t part = NUM_OF_ELEMENTS/2 / args->num_of_threads;
+    const int* values = args->values + args->id * part;
+
+    for (uint32_t i = 0; i < part; i++)
+        TEST_ASSERT(hash_insert(args->ht, createData(values[i])));
+    return NULL;
+}
+
+// marks the element as visited
+static void mark_element(Pointer value, void* context)
+{
+    ((bool*)context)[*((int*)value)] = true;
+}
+
+void test_scan(void)
+{
+    HashTable ht = hash_create_concurrent(hash_int1, compareFunction, free);
+    int* arr = create_ordered_array(NUM_OF_ELEMENTS);
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS/2; i++)
+        hash_insert(ht, createData(arr[i]));
+
+    // scan while the threads insert the second half of the values, every value of the first half is visited
+    const int num_of_threads = 4;
+    pthread_t threads[MAX_THREADS];
+    thread_args args[MAX_THREADS];
+    for (int i = 0; i < num_of_threads; i++)
+    {
+        args[i] = (thread_args){ ht, NULL, arr + NUM_OF_ELEMENTS/2, i, num_of_threads };
+        pthread_create(threads+i, NULL, insert_worker, args+i);
+    }
+
+    bool* visited = calloc(NUM_OF_ELEMENTS, sizeof(bool));
+    uint64_t cursor = 0;
+    do
+        cursor = hash_scan(ht, cursor, 16, mark_element, visited);
+    while (cursor != 0);
+
+    for (int i = 0; i < num_of_threads; i++)
+        pthread_join(threads[i], NULL);
+
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS/2; i++)
+        TEST_ASSERT(visited[i]);
+
+    // once the threads are done, every element is visited
+    memset(visited, 0, NUM_OF_ELEMENTS * sizeof(bool));
+    hash_foreach(ht, mark_element, visited);
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        TEST_ASSERT(visited[i]);
+
+    // free memory used
+    hash_destroy(ht);
+    free(visited);
+    free(arr);
+}
+
+void test_scaling(void)
+{
+    int* arr = create_ordered_array(NUM_OF_ELEMENTS);
+
+    printf("\n\n%8s %22s %22s\n", "threads", "concurrent (ops/sec)", "rwlock (ops/sec)");
+    for (int num_of_threads = 1; num_of_threads <= MAX_THREADS; num_of_threads *= 2)
+    {
+        HashTable concurrent = hash_create_concurrent(hash_int1, compareFunction, free);
+        HashTable ht = hash_create(hash_int1, compareFunction, free);
+        pthread_rwlock_t lock;
+        pthread_rwlock_init(&lock, NULL);
+
+        for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        {
+            hash_insert(concurrent, createData(arr[i]));
+            hash_insert(ht, createData(arr[i]));
+        }
+
+        // the concurrent hash table against a hash table protected by a single read-write lock
+        double ops_concurrent = run_mixed(concurrent, NULL, arr, num_of_threads);
+        double ops_rwlock = run_mixed(ht, &lock, arr, num_of_threads);
+
+        // every thread inserted and then removed its values
+        TEST_ASSERT(hash_size(concurrent) == NUM_OF_ELEMENTS);
+        TEST_ASSERT(hash_size(ht) == NUM_OF_ELEMENTS);
+
+        // report throughput
+        printf("%8d %22.0f %22.0f\n", num_of_threads, ops_concurrent, ops_rwlock);
+
+        // free memory used
+        hash_destroy(concurrent);
+        hash_destroy(ht);
+        pthread_rwlock_destroy(&lock);
+    }
+    free(arr);
+}
+
+TEST_LIST = {
+        { "create", test_create  },
+        { "insert_remove", test_insert_remove  },
+        { "get_or_insert", test_get_or_insert  },
+        { "scan", test_scan  },
+        { "scaling", test_scaling  },
+        { NULL, NULL }
+};
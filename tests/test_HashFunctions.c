@@ -0,0 +1,275 @@
+#include <time.h>
+#include <string.h>
+#include "../lib/ADT.h"
+#include "./include/common.h"
+
+// SMHasher-style quality checks and a throughput benchmark of the provided hash functions
+
+#define SAMPLES 20000
+#define NUM_OF_KEYS 1000000
+#define KEY_LEN 16
+
+typedef struct
+{
+    const char* name;
+    HashFunc hash;
+} hash_entry;
+
+static hash_entry int_functions[] = {
+    { "hash_int1", hash_int1 }, { "hash_int2", hash_int2 }, { "hash_int3", hash_int3 }, { "hash_int4", hash_int4 }
+};
+
+static hash_entry string_functions[] = {
+    { "hash_string1", hash_string1 }, { "hash_string2", hash_string2 },
+    { "hash_string3", hash_string3 }, { "hash_string4", hash_string4 }
+};
+
+#define NUM_OF_FUNCTIONS 4
+
+// fills str with len random lower case letters
+static void random_string(char* str, int len)
+{
+    for (int i = 0; i < len; i++)
+        str[i] = 'a' + rand() % 26;
+    str[len] = '\0';
+}
+
+// returns the worst deviation from 0.5 of the probability that an output bit flips when one input bit flips
+// -input_bits is the number of input bits to flip, the key is bytes[0..]
+static double avalanche_bias(HashFunc hash, Pointer key, uint8_t* bytes, int input_bits, void (*randomize)(void))
+{
+    uint32_t (*flips)[32] = calloc(input_bits, sizeof(*flips));
+    assert(flips != NULL);  // allocation failure
+
+    for (int s = 0; s < SAMPLES; s++)
+    {
+        randomize();
+        unsigned int h = hash(key);
+        for (int i = 0; i < input_bits; i++)
+        {
+            bytes[i / 8] ^= 1 << (i % 8);
+            unsigned int diff = h ^ hash(key);
+            bytes[i / 8] ^= 1 << (i % 8);
+
+            for (int j = 0; j < 32; j++)
+                flips[i][j] += (diff >> j) & 1;
+        }
+    }
+
+    double worst = 0;
+    for (int i = 0; i < input_bits; i++)
+        for (int j = 0; j < 32; j++)
+        {
+            double bias = (double)flips[i][j] / SAMPLES - 0.5;
+            if (bias < 0) bias = -bias;
+            if (bias > worst) worst = bias;
+        }
+    free(flips);
+    return worst;
+}
+
+static int int_key;
+static char string_key[KEY_LEN + 1];
+static char* string_ptr = string_key;
+
+static void randomize_int(void) { int_key = rand() ^ (rand() << 16); }
+static void randomize_string(void) { random_string(string_key, KEY_LEN); }
+
+void test_avalanche(void)
+{
+    printf("\n\n%-14s worst avalanche bias (ideal 0.0)\n", "function");
+    for (int f = 0; f < NUM_OF_FUNCTIONS; f++)
+    {
+        double bias = avalanche_bias(int_functions[f].hash, &int_key, (uint8_t*)&int_key, 32, randomize_int);
+        printf("%-14s %.3f\n", int_functions[f].name, bias);
+    }
+    for (int f = 0; f < NUM_OF_FUNCTIONS; f++)
+    {
+        // flip only the low 5 bits of each letter, so the key remains a valid string
+        double bias = 0;
+        for (int c = 0; c < KEY_LEN; c++)
+        {
+            double b = avalanche_bias(string_functions[f].hash, &string_ptr, (uint8_t*)string_key + c, 5, randomize_string);
+            if (b > bias) bias = b;
+        }
+        printf("%-14s %.3f\n", string_functions[f].name, bias);
+    }
+
+    // the wyhash functions must avalanche almost perfectly (sampling noise is ~0.02)
+    TEST_ASSERT(avalanche_bias(hash_int4, &int_key, (uint8_t*)&int_key, 32, randomize_int) < 0.03);
+    for (int c = 0; c < KEY_LEN; c++)
+        TEST_ASSERT(avalanche_bias(hash_string4, &string_ptr, (uint8_t*)string_key + c, 5, randomize_string) < 0.03);
+}
+
+// chi-square of the keys' distribution at 2^16 buckets, divided by its expected value (ideal ~1.0)
+static double chi_square_ratio(HashFunc hash, Pointer* keys, uint32_t n, bool high_bits)
+{
+    const uint32_t buckets = 1 << 16;
+    uint32_t* count = calloc(buckets, sizeof(uint32_t));
+    assert(count != NULL);  // allocation failure
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        unsigned int h = hash(keys[i]);
+        count[high_bits ? h >> 16 : h & (buckets - 1)]++;
+    }
+
+    double expected = (double)n / buckets, chi = 0;
+    for (uint32_t i = 0; i < buckets; i++)
+        chi += (count[i] - expected) * (count[i] - expected) / expected;
+    free(count);
+    return chi / (buckets - 1);
+}
+
+static int compare_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+void test_distribution(void)
+{
+    // sequential integers and similar strings ("key0", "key1", ...): the keys real tables see
+    int* ints = create_ordered_array(NUM_OF_KEYS);
+    char (*strings)[16] = malloc(NUM_OF_KEYS * sizeof(*strings));
+    char** string_ptrs = malloc(NUM_OF_KEYS * sizeof(char*));
+    Pointer* keys = malloc(NUM_OF_KEYS * sizeof(Pointer));
+    assert(strings != NULL && string_ptrs != NULL && keys != NULL);  // allocation failure
+    for (uint32_t i = 0; i < NUM_OF_KEYS; i++)
+    {
+        sprintf(strings[i], "key%u", i);
+        string_ptrs[i] = strings[i];
+    }
+
+    printf("\n\n%-14s chi-square ratio, low bits / high bits (ideal 1.0)\n", "function");
+    for (uint32_t i = 0; i < NUM_OF_KEYS; i++)
+        keys[i] = ints + i;
+    for (int f = 0; f < NUM_OF_FUNCTIONS; f++)
+        printf("%-14s %8.2f / %8.2f\n", int_functions[f].name, chi_square_ratio(int_functions[f].hash, keys, NUM_OF_KEYS, false),
+                                                              chi_square_ratio(int_functions[f].hash, keys, NUM_OF_KEYS, true));
+    double int4_low = chi_square_ratio(hash_int4, keys, NUM_OF_KEYS, false);
+    double int4_high = chi_square_ratio(hash_int4, keys, NUM_OF_KEYS, true);
+
+    for (uint32_t i = 0; i < NUM_OF_KEYS; i++)
+        keys[i] = string_ptrs + i;
+    for (int f = 0; f < NUM_OF_FUNCTIONS; f++)
+        printf("%-14s %8.2f / %8.2f\n", string_functions[f].name, chi_square_ratio(string_functions[f].hash, keys, NUM_OF_KEYS, false),
+                                                                 chi_square_ratio(string_functions[f].hash, keys, NUM_OF_KEYS, true));
+    double string4_low = chi_square_ratio(hash_string4, keys, NUM_OF_KEYS, false);
+    double string4_high = chi_square_ratio(hash_string4, keys, NUM_OF_KEYS, true);
+
+    // the expected deviation of the ratio is sqrt(2 / buckets) ~ 0.006
+    TEST_ASSERT(int4_low < 1.05 && int4_high < 1.05);
+    TEST_ASSERT(string4_low < 1.05 && string4_high < 1.05);
+
+    // no 64-bit collisions between 1M distinct keys
+    uint64_t* hashes = malloc(NUM_OF_KEYS * sizeof(uint64_t));
+    assert(hashes != NULL);  // allocation failure
+    for (uint32_t i = 0; i < NUM_OF_KEYS; i++)
+        hashes[i] = hash_string64(string_ptrs + i);
+    for (uint32_t i = 0; i < NUM_OF_KEYS; i++)
+        TEST_CHECK(hash_int64(ints + i) != hash_int64(ints + (i + 1) % NUM_OF_KEYS));
+    qsort(hashes, NUM_OF_KEYS, sizeof(uint64_t), compare_u64);
+    uint32_t collisions = 0;
+    for (uint32_t i = 1; i < NUM_OF_KEYS; i++)
+        collisions += hashes[i] == hashes[i - 1];
+    TEST_ASSERT(collisions == 0);
+
+    free(ints);
+    free(strings);
+    free(string_ptrs);
+    free(keys);
+    free(hashes);
+}
+
+void test_seed(void)
+{
+    const char* str = "hash flooding";
+    int val = 42;
+    uint64_t old_seed = hash_get_seed();
+
+    // the 64-bit string hash is hash_bytes over the string with the current seed
+    TEST_ASSERT(hash_string64(&str) == hash_bytes(str, strlen(str), old_seed));
+
+    uint64_t h_str = hash_string64(&str), h_int = hash_int64(&val);
+    hash_set_seed(0x123456789abcdefull);
+    TEST_ASSERT(hash_get_seed() == 0x123456789abcdefull);
+    TEST_ASSERT(hash_string64(&str) != h_str);
+    TEST_ASSERT(hash_int64(&val) != h_int);
+
+    // same seed, same hashes
+    hash_set_seed(old_seed);
+    TEST_ASSERT(hash_string64(&str) == h_str);
+    TEST_ASSERT(hash_int64(&val) == h_int);
+
+    // every length hashes every byte (covers the short, medium and 48-byte block paths)
+    char buf[200];
+    random_string(buf, 199);
+    for (size_t len = 1; len < 200; len++)
+    {
+        uint64_t h = hash_bytes(buf, len, 1);
+        TEST_CHECK(h != hash_bytes(buf, len - 1, 1));
+        buf[len - 1] ^= 1;
+        TEST_CHECK(h != hash_bytes(buf, len, 1));
+        buf[len - 1] ^= 1;
+    }
+}
+
+// keeps the benchmarked hashes from being optimized away
+static volatile unsigned int hash_sink;
+
+void test_throughput(void)
+{
+    const int lengths[] = { 8, 32, 256 };
+    const uint32_t total_bytes = 1 << 27;
+
+    printf("\n\n%-14s %10s %10s %10s  (MB/s per string length)\n", "function", "8", "32", "256");
+    for (int f = 0; f < NUM_OF_FUNCTIONS; f++)
+    {
+        printf("%-14s", string_functions[f].name);
+        for (int l = 0; l < 3; l++)
+        {
+            // a few different strings, so the calls cannot be hoisted out of the loop
+            char str[16][257];
+            char* ptrs[16];
+            for (int k = 0; k < 16; k++)
+            {
+                random_string(str[k], lengths[l]);
+                ptrs[k] = str[k];
+            }
+            uint32_t iterations = total_bytes / lengths[l];
+
+            unsigned int sink = 0;
+            clock_t cur_time = clock();
+            for (uint32_t i = 0; i < iterations; i++)
+                sink += string_functions[f].hash(ptrs + (i & 15));
+            double time = calc_time(cur_time);
+            printf(" %10.0f", total_bytes / time / 1e6);
+            hash_sink = sink;
+        }
+        printf("\n");
+    }
+
+    for (int f = 0; f < NUM_OF_FUNCTIONS; f++)
+    {
+        int* arr = create_ordered_array(NUM_OF_KEYS);
+        unsigned int sink = 0;
+        clock_t cur_time = clock();
+        for (int r = 0; r < 20; r++)
+            for (uint32_t i = 0; i < NUM_OF_KEYS; i++)
+                sink += int_functions[f].hash(arr + i);
+        double time = calc_time(cur_time);
+        printf("%-14s %10.0f Mhashes/s\n", int_functions[f].name, 20 * NUM_OF_KEYS / time / 1e6);
+        hash_sink = sink;
+        free(arr);
+    }
+    printf("\n");
+}
+
+TEST_LIST = {
+        { "avalanche",    test_avalanche    },
+        { "distribution", test_distribution },
+        { "seed",         test_seed         },
+        { "throughput",   test_throughput   },
+        { NULL, NULL }
+};
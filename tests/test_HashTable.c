@@ -1,6 +1,7 @@
 #include <time.h>
 #include "../lib/ADT.h"
 #include "./include/common.h"
+#include "../modules/HashTable/typed_hash_table.h"
 
 #define NUM_OF_ELEMENTS 2000000
 
@@ -89,9 +90,905 @@ void test_remove(void)
     printf("\n\nRemove took %f seconds to complete\n", time_insert);
 }
 
+void test_search(void)
+{
+    // create hash table
+    HashTable ht = hash_create(hash_int1, compareFunction, free);
+    
+    time_t t;
+    srand((unsigned) time(&t));
+    
+    int* arr = create_shuffled_array(2*NUM_OF_ELEMENTS);
+
+    // insert half of the values
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        hash_insert(ht, createData(arr[i]));
+
+    clock_t cur_time = clock();
+    
+    // look up every value, half of them exist
+    for (uint32_t i = 0; i < 2*NUM_OF_ELEMENTS; i++)
+        TEST_ASSERT(hash_exists(ht, arr+i) == (i < NUM_OF_ELEMENTS));
+
+    double time_search = calc_time(cur_time);  // calculate search time
+
+    // free memory used
+    hash_destroy(ht);
+    free(arr);
+
+    // report time taken
+    printf("\n\nSearch took %f seconds to complete\n", time_search);
+}
+
+void test_search_cached(void)
+{
+    // create a small hash table, that fits in the cache, so that finding the bucket dominates search time
+    HashTable ht = hash_create(hash_int1, compareFunction, free);
+    
+    time_t t;
+    srand((unsigned) time(&t));
+    
+    const uint32_t num = 1000;
+    int* arr = create_shuffled_array(2*num);
+
+    // insert half of the values
+    for (uint32_t i = 0; i < num; i++)
+        hash_insert(ht, createData(arr[i]));
+
+    clock_t cur_time = clock();
+    
+    // look up every value many times, half of them exist
+    uint64_t found = 0;
+    for (uint32_t j = 0; j < 10*NUM_OF_ELEMENTS/num; j++)
+        for (uint32_t i = 0; i < 2*num; i++)
+            found += hash_exists(ht, arr+i);
+
+    double time_search = calc_time(cur_time);  // calculate search time
+    TEST_ASSERT(found == (uint64_t)num * (10*NUM_OF_ELEMENTS/num));
+
+    // free memory used
+    hash_destroy(ht);
+    free(arr);
+
+    // report time taken
+    printf("\n\nSearch (%d lookups in a cached hash table) took %f seconds to complete\n", 20*NUM_OF_ELEMENTS, time_search);
+}
+
+void test_batch(void)
+{
+    // create hash table
+    HashTable ht = hash_create(hash_int1, compareFunction, free);
+    
+    time_t t;
+    srand((unsigned) time(&t));
+    
+    int* arr = create_shuffled_array(2*NUM_OF_ELEMENTS);
+    Pointer* values = malloc(sizeof(Pointer) * 2*NUM_OF_ELEMENTS);
+    uint64_t* result = malloc(sizeof(uint64_t) * (2*NUM_OF_ELEMENTS/64 + 1));
+    TEST_ASSERT(values != NULL && result != NULL);
+
+    // insert half of the values, all of them are new
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        values[i] = createData(arr[i]);
+    TEST_ASSERT(hash_insert_many(ht, values, NUM_OF_ELEMENTS, result) == NUM_OF_ELEMENTS);
+    TEST_ASSERT(hash_size(ht) == NUM_OF_ELEMENTS);
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        TEST_ASSERT((result[i / 64] >> (i % 64)) & 1);
+
+    // insert a few of them again, along with new ones
+    for (uint32_t i = 0; i < 100; i++)
+        values[i] = createData(arr[NUM_OF_ELEMENTS - 50 + i]);
+    TEST_ASSERT(hash_insert_many(ht, values, 100, result) == 50);
+    for (uint32_t i = 0; i < 100; i++)
+        TEST_ASSERT(((result[i / 64] >> (i % 64)) & 1) == (i >= 50));
+    
+    // look up every value, one at a time and in batches
+    for (uint32_t i = 0; i < 2*NUM_OF_ELEMENTS; i++)
+        values[i] = arr+i;
+    
+    clock_t cur_time = clock();
+    uint64_t found = 0;
+    for (uint32_t i = 0; i < 2*NUM_OF_ELEMENTS; i++)
+        found += hash_exists(ht, values[i]);
+    double time_single = calc_time(cur_time);
+
+    cur_time = clock();
+    TEST_ASSERT(hash_exists_many(ht, values, 2*NUM_OF_ELEMENTS, result) == found);
+    double time_batch = calc_time(cur_time);
+    
+    TEST_ASSERT(found == NUM_OF_ELEMENTS + 50);
+    for (uint32_t i = 0; i < 2*NUM_OF_ELEMENTS; i++)
+        TEST_ASSERT(((result[i / 64] >> (i % 64)) & 1) == hash_exists(ht, arr+i));
+
+    // no result bitmap
+    TEST_ASSERT(hash_exists_many(ht, values, 2*NUM_OF_ELEMENTS, NULL) == found);
+
+    // free memory used
+    hash_destroy(ht);
+    free(values);
+    free(result);
+    free(arr);
+
+    // report time taken
+    printf("\n\nSearch took %f seconds one at a time, %f seconds in batches\n", time_single, time_batch);
+}
+
+void test_map(void)
+{
+    // create hash table in map mode
+    HashTable ht = hash_map_create(hash_int1, compareFunction, free, free);
+    
+    time_t t;
+    srand((unsigned) time(&t));
+    
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS);
+
+    clock_t cur_time = clock();
+
+    // map every value to its double
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        TEST_ASSERT(hash_map_get(ht, arr+i) == NULL);
+        TEST_ASSERT(hash_map_put(ht, createData(arr[i]), createData(2*arr[i])));
+        TEST_ASSERT(hash_size(ht) == i+1);
+    }
+
+    // count the values in place, a single lookup for existing and new keys
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        bool inserted;
+        Pointer* slot = hash_map_get_or_insert(ht, createData(arr[i]), &inserted);
+        TEST_ASSERT(!inserted && *((int*)*slot) == 2*arr[i]);
+        (*((int*)*slot))++;
+    }
+
+    double time_map = calc_time(cur_time);  // calculate map time
+
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        Pointer* slot = hash_map_get(ht, arr+i);
+        TEST_ASSERT(slot != NULL && *((int*)*slot) == 2*arr[i]+1);
+    }
+
+    // a new key starts with a NULL value
+    bool inserted;
+    Pointer* slot = hash_map_get_or_insert(ht, createData(-1), &inserted);
+    TEST_ASSERT(inserted && *slot == NULL);
+    *slot = createData(0);
+
+    // replace values, the old ones are destroyed
+    TEST_ASSERT(!hash_map_put(ht, createData(arr[0]), createData(-5)));
+    TEST_ASSERT(*((int*)*hash_map_get(ht, arr)) == -5);
+    TEST_ASSERT(hash_size(ht) == NUM_OF_ELEMENTS+1);
+
+    // removing a key destroys its value as well
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS/2; i++)
+    {
+        TEST_ASSERT(hash_remove(ht, arr+i));
+        TEST_ASSERT(hash_map_get(ht, arr+i) == NULL);
+    }
+
+    // free memory used
+    hash_destroy(ht);
+    free(arr);
+
+    // report time taken
+    printf("\n\nMap operations took %f seconds to complete\n", time_map);
+}
+
+void test_hash64(void)
+{
+    // create hash table with a 64-bit hash function
+    HashTable ht = hash_create64(hash_int64, compareFunction, free);
+    TEST_ASSERT(ht != NULL && is_ht_empty(ht));
+    
+    time_t t;
+    srand((unsigned) time(&t));
+    
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS);
+
+    clock_t cur_time = clock();
+
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        TEST_ASSERT(hash_insert(ht, createData(arr[i])));
+        TEST_ASSERT(hash_size(ht) == i+1);
+    }
+    TEST_ASSERT(!hash_insert(ht, createData(arr[0])));  // already exists
+
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        TEST_ASSERT(hash_exists(ht, arr+i));
+
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS/2; i++)
+    {
+        TEST_ASSERT(hash_remove(ht, arr+i));
+        TEST_ASSERT(!hash_exists(ht, arr+i));
+    }
+    for (uint32_t i = NUM_OF_ELEMENTS/2; i < NUM_OF_ELEMENTS; i++)
+        TEST_ASSERT(hash_exists(ht, arr+i));
+    TEST_ASSERT(hash_size(ht) == NUM_OF_ELEMENTS - NUM_OF_ELEMENTS/2);
+
+    // the batch operations hash with the 64-bit function as well
+    Pointer* values = malloc(NUM_OF_ELEMENTS * sizeof(Pointer));
+    assert(values != NULL);  // allocation failure
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        values[i] = arr+i;
+    TEST_ASSERT(hash_exists_many(ht, values, NUM_OF_ELEMENTS, NULL) == NUM_OF_ELEMENTS - NUM_OF_ELEMENTS/2);
+    free(values);
+
+    double time_hash64 = calc_time(cur_time);  // calculate time
+
+    hash_destroy(ht);
+
+    // map mode with a 64-bit hash function
+    ht = hash_map_create64(hash_int64, compareFunction, free, free);
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS/10; i++)
+        TEST_ASSERT(hash_map_put(ht, createData(arr[i]), createData(2*arr[i])));
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS/10; i++)
+    {
+        Pointer* slot = hash_map_get(ht, arr+i);
+        TEST_ASSERT(slot != NULL && *((int*)*slot) == 2*arr[i]);
+    }
+
+    // free memory used
+    hash_destroy(ht);
+    free(arr);
+
+    // report time taken
+    printf("\n\n64-bit hash operations took %f seconds to complete\n", time_hash64);
+}
+
+// returns the mean of the statistics' histogram, ignoring entry 0 (empty buckets)
+static double histogram_mean(const struct ht_stats* stats)
+{
+    uint64_t count = 0, sum = 0;
+    for (uint32_t i = 1; i < HT_HISTOGRAM_SIZE; i++)
+    {
+        count += stats->histogram[i];
+        sum += i * stats->histogram[i];
+    }
+    return count != 0 ? (double)sum / count : 0;
+}
+
+static void print_stats(const char* name, const struct ht_stats* stats)
+{
+    printf("\n%s: %lu elements, %lu buckets, load factor %.2f, %lu bytes, %lu tombstones, %lu rehashes, %.2f probes per lookup\n",
+           name, stats->elements, stats->buckets, stats->load_factor, stats->bytes, stats->tombstones, stats->rehashes,
+           stats->lookups != 0 ? (double)stats->probes / stats->lookups : 0);
+    printf("histogram:");
+    for (uint32_t i = 0; i < HT_HISTOGRAM_SIZE; i++)
+        printf(" %lu", stats->histogram[i]);
+    printf("\n");
+}
+
+static int compare_strings(Pointer a, Pointer b) { return strcmp(*(char**)a, *(char**)b); }
+
+void test_stats(void)
+{
+    HashTable ht = hash_create(hash_int1, compareFunction, free);
+    struct ht_stats stats;
+
+    hash_stats(ht, &stats);
+    TEST_ASSERT(stats.elements == 0 && stats.buckets > 0 && stats.load_factor == 0 && stats.bytes > 0);
+    TEST_ASSERT(stats.rehashes == 0 && stats.lookups == 0 && stats.probes == 0);
+
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS);
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        hash_insert(ht, createData(arr[i]));
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        TEST_ASSERT(hash_exists(ht, arr+i));
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS/2; i++)
+        TEST_ASSERT(hash_remove(ht, arr+i));
+
+    hash_stats(ht, &stats);
+    print_stats("hash_int1", &stats);
+    TEST_ASSERT(stats.elements == hash_size(ht));
+    TEST_ASSERT(stats.load_factor > 0 && stats.load_factor == (double)stats.elements / stats.buckets);
+    TEST_ASSERT(stats.bytes >= stats.buckets);
+    TEST_ASSERT(stats.rehashes > 0);
+    TEST_ASSERT(stats.probes >= stats.lookups);  // both 0 unless the probes are counted
+
+    // every element is counted by the histogram, either as part of a chain or by its probes
+    uint64_t chained = 0, probed = 0;
+    for (uint32_t i = 0; i < HT_HISTOGRAM_SIZE; i++)
+    {
+        chained += i * stats.histogram[i];
+        probed += stats.histogram[i];
+    }
+    TEST_ASSERT(stats.histogram[0] != 0 ? chained <= stats.elements : probed == stats.elements);
+
+    hash_destroy(ht);
+    free(arr);
+
+    // a bad hash function shows up as longer chains (probe sequences)
+    const uint32_t num = 5000;
+    char (*strings)[16] = malloc(num * sizeof(*strings));
+    char** string_ptrs = malloc(num * sizeof(char*));
+    assert(strings != NULL && string_ptrs != NULL);  // allocation failure
+    for (uint32_t i = 0; i < num; i++)
+    {
+        sprintf(strings[i], "key%u", i);
+        string_ptrs[i] = strings[i];
+    }
+
+    HashTable bad = hash_create(hash_string3, compare_strings, NULL);
+    HashTable good = hash_create(hash_string4, compare_strings, NULL);
+    for (uint32_t i = 0; i < num; i++)
+    {
+        hash_insert(bad, string_ptrs + i);
+        hash_insert(good, string_ptrs + i);
+    }
+
+    struct ht_stats bad_stats, good_stats;
+    hash_stats(bad, &bad_stats);
+    hash_stats(good, &good_stats);
+    print_stats("hash_string3", &bad_stats);
+    print_stats("hash_string4", &good_stats);
+    TEST_ASSERT(histogram_mean(&bad_stats) > 2 * histogram_mean(&good_stats));
+
+    hash_destroy(bad);
+    hash_destroy(good);
+    free(strings);
+    free(string_ptrs);
+}
+
+void test_churn(void)
+{
+    // a hash table of steady size, whose elements are constantly replaced
+    HashTable ht = hash_create(hash_int1, compareFunction, free);
+    struct ht_stats stats;
+
+    time_t t;
+    srand((unsigned) time(&t));
+
+    const uint32_t num = 10000;
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS + num);
+    for (uint32_t i = 0; i < num; i++)
+        hash_insert(ht, createData(arr[i]));
+
+    clock_t cur_time = clock();
+
+    // remove the oldest element and insert a new one, looking up a removed one along the way
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        TEST_ASSERT(hash_remove(ht, arr+i));
+        TEST_ASSERT(hash_insert(ht, createData(arr[i + num])));
+        TEST_ASSERT(!hash_exists(ht, arr+i));
+    }
+
+    double time_churn = calc_time(cur_time);  // calculate churn time
+    TEST_ASSERT(hash_size(ht) == num);
+
+    // the deleted buckets are cleaned up before they fill the table, so searches still find empty buckets
+    hash_stats(ht, &stats);
+    print_stats("churn", &stats);
+    TEST_ASSERT(stats.elements + stats.tombstones < stats.buckets);
+    TEST_ASSERT(stats.buckets < 64 * num);  // the table did not grow because of them
+
+    // compacting removes every deleted bucket and keeps the elements
+    hash_compact(ht);
+    hash_stats(ht, &stats);
+    TEST_ASSERT(stats.tombstones == 0 && stats.elements == num);
+    for (uint32_t i = NUM_OF_ELEMENTS; i < NUM_OF_ELEMENTS + num; i++)
+        TEST_ASSERT(hash_exists(ht, arr+i));
+
+    // free memory used
+    hash_destroy(ht);
+    free(arr);
+
+    // report time taken
+    printf("\n\nChurn (%d removals and insertions) took %f seconds to complete\n", NUM_OF_ELEMENTS, time_churn);
+}
+
+// a bad hash function: every 16 consecutive integers have the same hash value
+static unsigned int hash_group(Pointer value) { return *(int*)value / 16; }
+
+void test_collisions(void)
+{
+    // elements that no hash table can separate, so they pile up wherever they collide (the stash of CuckooHashing)
+    HashTable ht = hash_map_create(hash_group, compareFunction, free, free);
+
+    const uint32_t num = 4096;
+    int* arr = create_shuffled_array(num);
+    for (uint32_t i = 0; i < num; i++)
+        TEST_ASSERT(hash_map_put(ht, createData(arr[i]), createData(2*arr[i])));
+    TEST_ASSERT(hash_size(ht) == num);
+
+    for (uint32_t i = 0; i < num; i++)
+    {
+        Pointer* slot = hash_map_get(ht, arr+i);
+        TEST_ASSERT(slot != NULL && *((int*)*slot) == 2*arr[i]);
+    }
+
+    for (uint32_t i = 0; i < num/2; i++)
+        TEST_ASSERT(hash_remove(ht, arr+i));
+    for (uint32_t i = 0; i < num; i++)
+        TEST_ASSERT(hash_exists(ht, arr+i) == (i >= num/2));
+    TEST_ASSERT(hash_size(ht) == num - num/2);
+
+    // free memory used
+    hash_destroy(ht);
+    free(arr);
+}
+
+static int compare_latencies(const void* a, const void* b)
+{
+    const uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// returns the current time in nanoseconds
+static inline uint64_t time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void test_latency(void)
+{
+    // time every lookup on its own, the tail of the distribution shows the longest searches
+    HashTable ht = hash_create(hash_int4, compareFunction, free);
+
+    time_t t;
+    srand((unsigned) time(&t));
+
+    const uint32_t num = NUM_OF_ELEMENTS/2;
+    int* arr = create_shuffled_array(2*num);
+    for (uint32_t i = 0; i < num; i++)
+        hash_insert(ht, createData(arr[i]));
+
+    // half of the values exist, the lookups are shuffled so that the cache does not favor any of them
+    uint64_t* latencies = malloc(2*num * sizeof(uint64_t));
+    assert(latencies != NULL);  // allocation failure
+    uint64_t found = 0;
+    for (uint32_t i = 0; i < 2*num; i++)
+    {
+        const uint64_t start = time_ns();
+        found += hash_exists(ht, arr+i);
+        latencies[i] = time_ns() - start;
+    }
+    TEST_ASSERT(found == num);
+
+    qsort(latencies, 2*num, sizeof(uint64_t), compare_latencies);
+    printf("\n\nLookup latency (ns, including the timer): p50 %lu, p99 %lu, p99.9 %lu\n",
+           latencies[num], latencies[2*num / 100 * 99], latencies[2*num / 1000 * 999]);
+
+    // free memory used
+    hash_destroy(ht);
+    free(latencies);
+    free(arr);
+}
+
+// counts the elements (context[0]) and adds them up (context[1])
+static void sum_element(Pointer value, void* context)
+{
+    uint64_t* sum = context;
+    sum[0]++;
+    sum[1] += *((int*)value);
+}
+
+// marks the element as visited
+static void mark_element(Pointer value, void* context)
+{
+    ((bool*)context)[*((int*)value)] = true;
+}
+
+void test_iterate(void)
+{
+    HashTable ht = hash_create(hash_int1, compareFunction, free);
+
+    time_t t;
+    srand((unsigned) time(&t));
+
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS);
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        hash_insert(ht, createData(arr[i]));
+        total += arr[i];
+    }
+
+    // visit every element
+    clock_t cur_time = clock();
+    uint64_t sum[2] = { 0, 0 };
+    hash_foreach(ht, sum_element, sum);
+    double time_foreach = calc_time(cur_time);  // calculate foreach time
+    TEST_ASSERT(sum[0] == NUM_OF_ELEMENTS && sum[1] == total);
+
+    // the iterator returns every element once
+    bool* visited = calloc(2 * NUM_OF_ELEMENTS, sizeof(bool));
+    uint32_t count = 0;
+    hash_iter it;
+    cur_time = clock();
+    for (Pointer value = hash_iter_begin(ht, &it); value != NULL; value = hash_iter_next(&it), count++)
+    {
+        TEST_ASSERT(!visited[*((int*)value)]);
+        visited[*((int*)value)] = true;
+    }
+    double time_iter = calc_time(cur_time);  // calculate iteration time
+    TEST_ASSERT(count == NUM_OF_ELEMENTS && hash_iter_next(&it) == NULL);
+
+    // scan while inserting as many new elements (several rehashes) and removing a quarter of the old ones
+    // every old element that is not removed is visited
+    memset(visited, 0, 2 * NUM_OF_ELEMENTS * sizeof(bool));
+    uint32_t inserted = 0, removed = 0, calls = 0;
+    uint64_t cursor = 0;
+    do
+    {
+        cursor = hash_scan(ht, cursor, 64, mark_element, visited);
+        for (uint32_t i = 0; i < 8 && inserted < NUM_OF_ELEMENTS; i++, inserted++)
+            TEST_ASSERT(hash_insert(ht, createData(NUM_OF_ELEMENTS + inserted)));
+        if (removed < NUM_OF_ELEMENTS/4)
+            TEST_ASSERT(hash_remove(ht, arr + removed++));
+        calls++;
+    }
+    while (cursor != 0);
+
+    for (uint32_t i = NUM_OF_ELEMENTS/4; i < NUM_OF_ELEMENTS; i++)
+        TEST_ASSERT(visited[arr[i]]);
+
+    // free memory used
+    hash_destroy(ht);
+    free(visited);
+
+    // the values of a map
+    ht = hash_map_create(hash_int1, compareFunction, free, free);
+    for (uint32_t i = 0; i < 1000; i++)
+        hash_map_put(ht, createData(arr[i]), createData(2*arr[i]));
+
+    count = 0;
+    for (Pointer key = hash_iter_begin(ht, &it); key != NULL; key = hash_iter_next(&it), count++)
+        TEST_ASSERT(*((int*)*hash_iter_value(&it)) == 2 * *((int*)key));
+    TEST_ASSERT(count == 1000);
+
+    // free memory used
+    hash_destroy(ht);
+    free(arr);
+
+    // report time taken
+    printf("\n\nVisiting %d elements took %f seconds (foreach), %f seconds (iterator)\n", NUM_OF_ELEMENTS, time_foreach, time_iter);
+    printf("Scan: %u calls\n", calls);
+}
+
+// the elements of the table that test_scan_churn keeps, of them the first tenth is never removed
+#define CHURN_ELEMENTS 10000
+#define CHURN_KEPT (CHURN_ELEMENTS / 10)
+
+static void mark_kept(Pointer value, void* context)
+{
+    if (*((int*)value) < CHURN_KEPT)
+        ((bool*)context)[*((int*)value)] = true;
+}
+
+void test_scan_churn(void)
+{
+    HashTable ht = hash_create(hash_int1, compareFunction, free);
+    for (int i = 0; i < CHURN_ELEMENTS; i++)
+        hash_insert(ht, createData(i));
+
+    // scan a few buckets at a time, while the oldest elements keep being replaced by new ones (the hash table keeps
+    // its size, but it fills with deleted buckets), the scan still ends and visits every element that was not removed
+    bool visited[CHURN_KEPT] = { false };
+    int oldest = CHURN_KEPT, next = CHURN_ELEMENTS;
+    uint32_t calls = 0;
+    uint64_t cursor = 0;
+    do
+    {
+        cursor = hash_scan(ht, cursor, 16, mark_kept, visited);
+        for (uint32_t i = 0; i < 64; i++, oldest++)
+        {
+            TEST_ASSERT(hash_remove(ht, &oldest));
+            TEST_ASSERT(hash_insert(ht, createData(next++)));
+        }
+        calls++;
+    }
+    while (cursor != 0 && calls < 100000);
+
+    TEST_ASSERT(cursor == 0);
+    for (uint32_t i = 0; i < CHURN_KEPT; i++)
+        TEST_ASSERT(visited[i]);
+    TEST_ASSERT(hash_size(ht) == CHURN_ELEMENTS);
+
+    // the same while all but the kept elements are removed and inserted again (a hash table that shrinks does not)
+    memset(visited, 0, sizeof(visited));
+    uint32_t shrink_calls = 0;
+    do
+    {
+        cursor = hash_scan(ht, cursor, 1024, mark_kept, visited);
+        for (int i = oldest; i < next; i++)
+            TEST_ASSERT(hash_remove(ht, &i));
+        for (int i = oldest; i < next; i++)
+            TEST_ASSERT(hash_insert(ht, createData(i)));
+        shrink_calls++;
+    }
+    while (cursor != 0 && shrink_calls < 10000);
+
+    TEST_ASSERT(cursor == 0);
+    for (uint32_t i = 0; i < CHURN_KEPT; i++)
+        TEST_ASSERT(visited[i]);
+
+    // free memory used
+    hash_destroy(ht);
+
+    printf("\n\nScan under churn: %u calls, %u calls while shrinking\n", calls, shrink_calls);
+}
+
+// hashes four consecutive integers to the same value
+static unsigned int hash_by_four(Pointer value)
+{
+    int quarter = *((int*)value) / 4;
+    return hash_int1(&quarter);
+}
+
+void test_get_or_insert(void)
+{
+    HashTable ht = hash_create(hash_int1, compareFunction, free);
+
+    time_t t;
+    srand((unsigned) time(&t));
+
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS);
+
+    // the first value of each kind is stored
+    Pointer* stored = malloc(NUM_OF_ELEMENTS * sizeof(Pointer));
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        TEST_ASSERT(hash_find(ht, arr+i) == NULL);
+        stored[i] = createData(arr[i]);
+        Pointer existing = NULL;
+        TEST_ASSERT(hash_get_or_insert(ht, stored[i], &existing));
+        TEST_ASSERT(existing == stored[i] && hash_find(ht, arr+i) == stored[i]);
+    }
+
+    // an equal value returns the stored one and is not destroyed, the caller still owns it
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        int* value = createData(arr[i]);
+        Pointer existing = NULL;
+        TEST_ASSERT(!hash_get_or_insert(ht, value, &existing));
+        TEST_ASSERT(existing == stored[i] && *value == arr[i]);
+        free(value);
+    }
+    TEST_ASSERT(hash_size(ht) == NUM_OF_ELEMENTS);
+    hash_destroy(ht);
+
+    // colliding values (UsingRBT moves them from the bucket arrays to rbts)
+    ht = hash_create(hash_by_four, compareFunction, free);
+    for (int i = 0; i < 1000; i++)
+    {
+        int* value = createData(i);
+        Pointer existing = NULL;
+        TEST_ASSERT(hash_get_or_insert(ht, value, &existing) && existing == value);
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        Pointer existing = NULL;
+        TEST_ASSERT(!hash_get_or_insert(ht, &i, &existing) && existing != &i && *((int*)existing) == i);
+    }
+    TEST_ASSERT(hash_size(ht) == 1000);
+    hash_destroy(ht);
+
+    // deduplicate values that repeat on average twice: searching and then inserting against a single call
+    ht = hash_create(hash_int1, compareFunction, NULL);
+    clock_t cur_time = clock();
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        if (!hash_exists(ht, arr + i/2))
+            hash_insert(ht, arr + i/2);
+    }
+    double time_two_calls = calc_time(cur_time);  // calculate exists + insert time
+    hash_destroy(ht);
+
+    ht = hash_create(hash_int1, compareFunction, NULL);
+    cur_time = clock();
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        Pointer existing;
+        hash_get_or_insert(ht, arr + i/2, &existing);
+    }
+    double time_one_call = calc_time(cur_time);  // calculate get_or_insert time
+    TEST_ASSERT(hash_size(ht) == NUM_OF_ELEMENTS/2);
+
+    // free memory used
+    hash_destroy(ht);
+    free(stored);
+    free(arr);
+
+    // report time taken
+    printf("\n\nDeduplicating %d values took %f seconds (hash_exists + hash_insert), %f seconds (hash_get_or_insert)\n",
+           NUM_OF_ELEMENTS, time_two_calls, time_one_call);
+}
+
+void test_reserve(void)
+{
+    struct ht_stats stats;
+
+    time_t t;
+    srand((unsigned) time(&t));
+
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS);
+
+    // load the elements into a hash table that grows as they are inserted
+    HashTable ht = hash_create(hash_int1, compareFunction, free);
+    clock_t cur_time = clock();
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        hash_insert(ht, createData(arr[i]));
+    double time_growing = calc_time(cur_time);  // calculate load time
+    hash_stats(ht, &stats);
+    const uint64_t rehashes = stats.rehashes;
+    hash_destroy(ht);
+
+    // and into one that has room for all of them from the start, which never rehashes
+    ht = hash_create_with_capacity(hash_int1, compareFunction, free, NUM_OF_ELEMENTS);
+    cur_time = clock();
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        TEST_ASSERT(hash_insert(ht, createData(arr[i])));
+    double time_sized = calc_time(cur_time);  // calculate load time
+    hash_stats(ht, &stats);
+    TEST_ASSERT(stats.rehashes == 0 && stats.elements == NUM_OF_ELEMENTS);
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        TEST_ASSERT(hash_exists(ht, arr+i));
+    hash_destroy(ht);
+
+    // reserving room in a hash table with elements rehashes it once, and keeps them
+    ht = hash_create(hash_int1, compareFunction, free);
+    for (uint32_t i = 0; i < 1000; i++)
+        hash_insert(ht, createData(arr[i]));
+    hash_stats(ht, &stats);
+    const uint64_t rehashes_before = stats.rehashes;
+    hash_reserve(ht, NUM_OF_ELEMENTS);
+    hash_reserve(ht, 10);  // never shrinks
+    for (uint32_t i = 1000; i < NUM_OF_ELEMENTS; i++)
+        hash_insert(ht, createData(arr[i]));
+    hash_stats(ht, &stats);
+    TEST_ASSERT(stats.rehashes == rehashes_before + 1 && stats.elements == NUM_OF_ELEMENTS);
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        TEST_ASSERT(hash_exists(ht, arr+i));
+
+    // free memory used
+    hash_destroy(ht);
+    free(arr);
+
+    // report time taken
+    printf("\n\nLoading %d elements took %f seconds (%lu rehashes), %f seconds with hash_create_with_capacity\n",
+           NUM_OF_ELEMENTS, time_growing, rehashes, time_sized);
+}
+
+// type-specialized tables: a set of integers and records looked up by their id
+typedef struct { int64_t id; int64_t balance; } record;
+
+#define record_hash(r) ht_hash_int((r).id)
+#define record_eq(a, b) ((a).id == (b).id)
+
+HT_DEFINE(int_set, int64_t, ht_hash_int, ht_eq)
+HT_DEFINE(record_table, record, record_hash, record_eq)
+HT_DEFINE(string_set, const char*, ht_hash_string, ht_eq_string)
+
+void test_typed(void)
+{
+    time_t t;
+    srand((unsigned) time(&t));
+    
+    int* arr = create_shuffled_array(2*NUM_OF_ELEMENTS);
+
+    int_set set = int_set_create();
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        TEST_ASSERT(int_set_insert(set, arr[i]));
+        TEST_ASSERT(int_set_size(set) == i+1);
+    }
+    TEST_ASSERT(!int_set_insert(set, arr[0]));  // already exists
+
+    // look up every value, half of them exist - the same lookups as test_search
+    HashTable ht = hash_create(hash_int1, compareFunction, free);
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        hash_insert(ht, createData(arr[i]));
+
+    clock_t cur_time = clock();
+    for (uint32_t i = 0; i < 2*NUM_OF_ELEMENTS; i++)
+        TEST_ASSERT(int_set_exists(set, arr[i]) == (i < NUM_OF_ELEMENTS));
+    double time_typed = calc_time(cur_time);
+
+    cur_time = clock();
+    for (uint32_t i = 0; i < 2*NUM_OF_ELEMENTS; i++)
+        TEST_ASSERT(hash_exists(ht, arr+i) == (i < NUM_OF_ELEMENTS));
+    double time_pointer = calc_time(cur_time);
+
+    // lookups in small tables, that fit in the cache, where the function calls dominate
+    const uint32_t num = 1000;
+    int_set small_set = int_set_create();
+    HashTable small_ht = hash_create(hash_int1, compareFunction, free);
+    for (uint32_t i = 0; i < num; i++)
+    {
+        int_set_insert(small_set, arr[i]);
+        hash_insert(small_ht, createData(arr[i]));
+    }
+
+    uint64_t found = 0;
+    cur_time = clock();
+    for (uint32_t j = 0; j < 10*NUM_OF_ELEMENTS/num; j++)
+        for (uint32_t i = 0; i < 2*num; i++)
+            found += int_set_exists(small_set, arr[i]);
+    double time_typed_cached = calc_time(cur_time);
+    TEST_ASSERT(found == (uint64_t)num * (10*NUM_OF_ELEMENTS/num));
+
+    found = 0;
+    cur_time = clock();
+    for (uint32_t j = 0; j < 10*NUM_OF_ELEMENTS/num; j++)
+        for (uint32_t i = 0; i < 2*num; i++)
+            found += hash_exists(small_ht, arr+i);
+    double time_pointer_cached = calc_time(cur_time);
+    TEST_ASSERT(found == (uint64_t)num * (10*NUM_OF_ELEMENTS/num));
+
+    // remove half of the values
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS/2; i++)
+    {
+        TEST_ASSERT(int_set_remove(set, arr[i]));
+        TEST_ASSERT(!int_set_remove(set, arr[i]));
+    }
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        TEST_ASSERT(int_set_exists(set, arr[i]) == (i >= NUM_OF_ELEMENTS/2));
+    TEST_ASSERT(int_set_size(set) == NUM_OF_ELEMENTS - NUM_OF_ELEMENTS/2);
+
+    // records, found by their id and updated in place
+    record_table records = record_table_create();
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS/10; i++)
+        TEST_ASSERT(record_table_insert(records, (record){ arr[i], 100 }));
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS/10; i++)
+    {
+        record* r = record_table_find(records, (record){ .id = arr[i] });
+        TEST_ASSERT(r != NULL && r->id == arr[i] && r->balance == 100);
+        r->balance += arr[i];
+    }
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS/10; i++)
+        TEST_ASSERT(record_table_find(records, (record){ .id = arr[i] })->balance == 100 + arr[i]);
+    TEST_ASSERT(record_table_find(records, (record){ .id = -1 }) == NULL);
+
+    // strings, compared by their contents
+    string_set strings = string_set_create();
+    const char* words[] = { "a", "hash", "table", "hashtable", "a longer string than a single word" };
+    char copy[64];
+    for (uint32_t i = 0; i < sizeof(words) / sizeof(words[0]); i++)
+        TEST_ASSERT(string_set_insert(strings, words[i]));
+    for (uint32_t i = 0; i < sizeof(words) / sizeof(words[0]); i++)
+    {
+        strcpy(copy, words[i]);
+        TEST_ASSERT(string_set_exists(strings, copy));
+    }
+    TEST_ASSERT(!string_set_exists(strings, "hash table"));
+
+    // free memory used
+    int_set_destroy(set);
+    int_set_destroy(small_set);
+    record_table_destroy(records);
+    string_set_destroy(strings);
+    hash_destroy(ht);
+    hash_destroy(small_ht);
+    free(arr);
+
+    // report time taken
+    printf("\n\nSearch took %f seconds (typed) vs %f seconds (hash_exists)\n", time_typed, time_pointer);
+    printf("Cached search took %f seconds (typed) vs %f seconds (hash_exists)\n", time_typed_cached, time_pointer_cached);
+}
+
 TEST_LIST = {
         { "create", test_create  },
         { "insert", test_insert  },
         { "remove", test_remove  },
+        { "search", test_search  },
+        { "search_cached", test_search_cached  },
+        { "batch", test_batch  },
+        { "map", test_map  },
+        { "hash64", test_hash64  },
+        { "typed", test_typed  },
+        { "stats", test_stats  },
+        { "churn", test_churn  },
+        { "collisions", test_collisions  },
+        { "latency", test_latency  },
+        { "iterate", test_iterate  },
+        { "scan_churn", test_scan_churn  },
+        { "get_or_insert", test_get_or_insert  },
+        { "reserve", test_reserve  },
         { NULL, NULL }
 };
@@ -1,4 +1,5 @@
 #include <time.h>
+#include <pthread.h>
 #include "../lib/ADT.h"
 #include "./include/common.h"
 
@@ -117,10 +118,477 @@ void test_traversal(void)
     free(arr);
 }
 
+void test_create_from_sorted(void)
+{
+    int* arr = create_ordered_array(NUM_OF_ELEMENTS);
+
+    Pointer* values = malloc(sizeof(Pointer) * NUM_OF_ELEMENTS);
+    assert(values != NULL);  // allocation failure
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        values[i] = createData(arr[i]);
+
+    clock_t cur_time = clock();
+
+    RBTree rbt = rbt_create_from_sorted(compareFunction, free, values, NUM_OF_ELEMENTS);
+
+    double time_create = calc_time(cur_time);  // calculate creation time
+
+    TEST_ASSERT(rbt_size(rbt) == NUM_OF_ELEMENTS);
+
+    // the values are in order
+    int value = 0;
+    for (RBTreeNode node = rbt_first(rbt); node != NULL; node = rbt_find_next(node), value++)
+        TEST_ASSERT( *((int*)rbt_node_value(node)) == value);
+    TEST_ASSERT(value == NUM_OF_ELEMENTS);
+
+    // the tree is a valid red-black tree, so it can be modified normally
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        TEST_ASSERT(rbt_exists(rbt, arr+i));
+        TEST_ASSERT(rbt_remove(rbt, arr+i));
+        TEST_ASSERT(!rbt_exists(rbt, arr+i));
+    }
+    TEST_ASSERT(rbt_size(rbt) == 0);
+
+    // free memory used
+    rbt_destroy(rbt);
+    free(values);
+    free(arr);
+
+    // report time taken
+    printf("\n\nCreation from sorted values took %f seconds to complete\n", time_create);
+}
+
+void test_insert_sorted_batch(void)
+{
+    RBTree rbt = rbt_create(compareFunction, free);
+
+    int* arr = create_ordered_array(NUM_OF_ELEMENTS);
+
+    // insert the even values one by one
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i += 2)
+        rbt_insert(rbt, createData(arr[i]));
+
+    // insert all the values as a batch, the even ones already exist
+    Pointer* values = malloc(sizeof(Pointer) * NUM_OF_ELEMENTS);
+    assert(values != NULL);  // allocation failure
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        values[i] = createData(arr[i]);
+
+    TEST_ASSERT(rbt_insert_sorted_batch(rbt, values, NUM_OF_ELEMENTS) == NUM_OF_ELEMENTS/2);
+    TEST_ASSERT(rbt_size(rbt) == NUM_OF_ELEMENTS);
+
+    int value = 0;
+    for (RBTreeNode node = rbt_first(rbt); node != NULL; node = rbt_find_next(node), value++)
+        TEST_ASSERT( *((int*)rbt_node_value(node)) == value);
+    TEST_ASSERT(value == NUM_OF_ELEMENTS);
+
+    // a small batch is inserted one by one
+    values[0] = createData(-1);
+    values[1] = createData(NUM_OF_ELEMENTS/2);
+    values[2] = createData(NUM_OF_ELEMENTS);
+    TEST_ASSERT(rbt_insert_sorted_batch(rbt, values, 3) == 2);
+    TEST_ASSERT(rbt_size(rbt) == NUM_OF_ELEMENTS+2);
+    TEST_ASSERT(*((int*)rbt_node_value(rbt_first(rbt))) == -1);
+    TEST_ASSERT(*((int*)rbt_node_value(rbt_last(rbt))) == NUM_OF_ELEMENTS);
+    rbt_destroy(rbt);
+
+    // values repeated in the batch are inserted once
+    rbt = rbt_create(compareFunction, free);
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        values[i] = createData(arr[i/2]);
+    TEST_ASSERT(rbt_insert_sorted_batch(rbt, values, NUM_OF_ELEMENTS) == NUM_OF_ELEMENTS/2);
+    TEST_ASSERT(rbt_size(rbt) == NUM_OF_ELEMENTS/2);
+
+    TEST_ASSERT(rbt_remove(rbt, arr+1) && !rbt_exists(rbt, arr+1));
+    TEST_ASSERT(rbt_insert_sorted_batch(rbt, values, 0) == 0);
+    TEST_ASSERT(rbt_size(rbt) == NUM_OF_ELEMENTS/2 - 1);
+
+    // free memory used
+    rbt_destroy(rbt);
+    free(values);
+    free(arr);
+}
+
+void test_get_or_insert(void)
+{
+    RBTree rbt = rbt_create(compareFunction, free);
+
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS);
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        int* value = createData(arr[i]);
+        Pointer existing = NULL;
+        TEST_ASSERT(rbt_get_or_insert(rbt, value, &existing) && existing == value);
+    }
+
+    // an equal value returns the stored one and is not destroyed, the caller still owns it
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        Pointer existing = NULL;
+        TEST_ASSERT(!rbt_get_or_insert(rbt, arr+i, &existing));
+        TEST_ASSERT(existing != arr+i && *((int*)existing) == arr[i]);
+    }
+    TEST_ASSERT(rbt_size(rbt) == NUM_OF_ELEMENTS);
+
+    // free memory used
+    rbt_destroy(rbt);
+    free(arr);
+}
+
+void test_iterator(void)
+{
+    // create rbt
+    RBTree rbt = rbt_create(compareFunction, free);
+    
+    time_t t;
+    srand((unsigned) time(&t));
+    
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS);
+
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        rbt_insert(rbt, createData(arr[i]));
+
+    // empty tree, nothing to iterate
+    rbt_iter iter;
+    RBTree empty = rbt_create(compareFunction, free);
+    TEST_ASSERT(rbt_iter_begin(empty, &iter) == NULL);
+    rbt_destroy(empty);
+
+    // scan using the parent pointers
+    clock_t cur_time = clock();
+    int value = 0;
+    for (RBTreeNode node = rbt_first(rbt); node != NULL; node = rbt_find_next(node), value++)
+        TEST_ASSERT( *((int*)rbt_node_value(node)) == value);
+    double time_find_next = calc_time(cur_time);
+
+    // scan using the iterator
+    cur_time = clock();
+    value = 0;
+    for (RBTreeNode node = rbt_iter_begin(rbt, &iter); node != NULL; node = rbt_iter_next(&iter), value++)
+        TEST_ASSERT( *((int*)rbt_node_value(node)) == value);
+    double time_iter = calc_time(cur_time);
+    TEST_ASSERT(value == NUM_OF_ELEMENTS);
+
+    // free memory used
+    cur_time = clock();
+    rbt_destroy(rbt);
+    double time_destroy = calc_time(cur_time);
+    free(arr);
+
+    // report time taken
+    printf("\n\nScan using rbt_find_next took %f seconds to complete\n", time_find_next);
+    printf("Scan using the iterator took %f seconds to complete\n", time_iter);
+    printf("Destroy took %f seconds to complete\n", time_destroy);
+}
+
+void test_map(void)
+{
+    // create rbt in map mode
+    RBTree rbt = rbt_map_create(compareFunction, free, free);
+    
+    time_t t;
+    srand((unsigned) time(&t));
+    
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS);
+
+    // map every value to its double
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        TEST_ASSERT(rbt_map_get(rbt, arr+i) == NULL);
+        TEST_ASSERT(rbt_map_put(rbt, createData(arr[i]), createData(2*arr[i])));
+        TEST_ASSERT(rbt_size(rbt) == i+1);
+    }
+
+    // change the values in place, a single lookup for existing and new keys
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        bool inserted;
+        Pointer* slot = rbt_map_get_or_insert(rbt, createData(arr[i]), &inserted);
+        TEST_ASSERT(!inserted && *((int*)*slot) == 2*arr[i]);
+        (*((int*)*slot))++;
+    }
+
+    // the keys are in order, each with its value
+    int key = 0;
+    for (RBTreeNode node = rbt_first(rbt); node != NULL; node = rbt_find_next(node), key++)
+    {
+        TEST_ASSERT(*((int*)rbt_node_value(node)) == key);
+        TEST_ASSERT(*((int*)*rbt_map_node_value(node)) == 2*key+1);
+    }
+
+    // a new key starts with a NULL value
+    bool inserted;
+    Pointer* slot = rbt_map_get_or_insert(rbt, createData(-1), &inserted);
+    TEST_ASSERT(inserted && *slot == NULL);
+    *slot = createData(0);
+
+    // replace a value, the old one is destroyed
+    TEST_ASSERT(!rbt_map_put(rbt, createData(arr[0]), createData(-5)));
+    TEST_ASSERT(*((int*)*rbt_map_get(rbt, arr)) == -5);
+
+    // removing a key destroys its value as well
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS/2; i++)
+        TEST_ASSERT(rbt_remove(rbt, arr+i));
+    TEST_ASSERT(rbt_size(rbt) == NUM_OF_ELEMENTS - NUM_OF_ELEMENTS/2 + 1);
+
+    // free memory used
+    rbt_destroy(rbt);
+    free(arr);
+}
+
+// checks that the values are visited in ascending order
+static void visit_in_order(Pointer value, void* context)
+{
+    int* prev = context;
+    TEST_ASSERT(*((int*)value) > *prev);
+    *prev = *((int*)value);
+}
+
+void test_persistent(void)
+{
+    time_t t;
+    srand((unsigned) time(&t));
+    
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS);
+
+    // keep every version created while inserting
+    RBTreeVersion* versions = malloc(sizeof(RBTreeVersion) * (NUM_OF_ELEMENTS+1));
+    assert(versions != NULL);  // allocation failure
+
+    versions[0] = rbt_persistent_create(compareFunction, free);
+
+    clock_t cur_time = clock();
+
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        versions[i+1] = rbt_insert_persistent(versions[i], createData(arr[i]));
+
+    double time_insert = calc_time(cur_time);  // calculate insert time
+
+    // inserting an existing value returns the same tree
+    RBTreeVersion same = rbt_insert_persistent(versions[NUM_OF_ELEMENTS], createData(arr[0]));
+    TEST_ASSERT(rbt_version_size(same) == NUM_OF_ELEMENTS);
+    rbt_version_release(same);
+
+    // every version holds exactly the values inserted before it
+    for (uint32_t i = 0; i <= NUM_OF_ELEMENTS; i += NUM_OF_ELEMENTS/10)
+    {
+        TEST_ASSERT(rbt_version_size(versions[i]) == i);
+        if (i != 0) TEST_ASSERT(rbt_version_exists(versions[i], arr+i-1));
+        if (i != NUM_OF_ELEMENTS) TEST_ASSERT(!rbt_version_exists(versions[i], arr+i));
+    }
+
+    // a snapshot outlives the release of the version it was taken from
+    RBTreeVersion snapshot = rbt_version_retain(versions[NUM_OF_ELEMENTS]);
+    for (uint32_t i = 0; i <= NUM_OF_ELEMENTS; i++)
+        rbt_version_release(versions[i]);
+
+    // remove every value, while older versions remain unchanged
+    RBTreeVersion version = rbt_version_retain(snapshot);
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        RBTreeVersion new_version = rbt_remove_persistent(version, arr+i);
+        TEST_ASSERT(!rbt_version_exists(new_version, arr+i));
+        TEST_ASSERT(rbt_version_exists(version, arr+i));
+        TEST_ASSERT(rbt_version_size(new_version) == NUM_OF_ELEMENTS-i-1);
+
+        rbt_version_release(version);
+        version = new_version;
+    }
+    rbt_version_release(version);
+
+    // the snapshot still holds every value, in order
+    int prev = -1;
+    TEST_ASSERT(rbt_version_size(snapshot) == NUM_OF_ELEMENTS);
+    rbt_version_foreach(snapshot, visit_in_order, &prev);
+    TEST_ASSERT(prev == NUM_OF_ELEMENTS-1);
+
+    // free memory used
+    rbt_version_release(snapshot);
+    free(versions);
+    free(arr);
+
+    // report time taken
+    printf("\n\nPersistent insertion took %f seconds to complete\n", time_insert);
+}
+
+// inserts and removes values at a tree of its own
+static void* independent_worker(void* arg)
+{
+    int* arr = arg;
+    RBTree rbt = rbt_create(compareFunction, free);
+
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        rbt_insert(rbt, createData(arr[i]));
+    
+    for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+    {
+        TEST_ASSERT(rbt_remove(rbt, arr+i));
+        TEST_ASSERT(!rbt_exists(rbt, arr+i));
+    }
+    TEST_ASSERT(rbt_size(rbt) == 0 && is_rbt_empty(rbt));
+
+    // the tree can be reused after being emptied
+    rbt_insert(rbt, createData(arr[0]));
+    TEST_ASSERT(rbt_exists(rbt, arr));
+
+    rbt_destroy(rbt);
+    return NULL;
+}
+
+void test_independent_trees(void)
+{
+    time_t t;
+    srand((unsigned) time(&t));
+    
+    int* arr = create_shuffled_array(NUM_OF_ELEMENTS);
+
+    // trees share no state, so different threads can use different trees without locking
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++)
+        pthread_create(threads+i, NULL, independent_worker, arr);
+    for (int i = 0; i < 4; i++)
+        pthread_join(threads[i], NULL);
+
+    free(arr);
+}
+
+#define MAX_THREADS 32
+#define OPS_PER_THREAD 100000
+
+// wall clock time, in seconds
+static inline double wall_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct
+{
+    RBTreeConcurrent concurrent;  // tree used by the concurrent mode
+    RBTree rbt;                   // tree used by the read-write lock
+    pthread_rwlock_t* lock;
+    int* values;                  // values in [0, NUM_OF_ELEMENTS), all of them exist in the tree
+    int id;
+}
+thread_args;
+
+// 99% lookups of existing values, 1% insertions and removals of values outside of them
+static void* concurrent_worker(void* arg)
+{
+    thread_args* args = arg;
+    unsigned int seed = args->id;
+
+    for (int i = 0; i < OPS_PER_THREAD; i++)
+    {
+        if (i % 100 == 0)
+        {
+            int value = NUM_OF_ELEMENTS + args->id;
+            if (i % 200 == 0)
+                rbt_concurrent_insert(args->concurrent, createData(value));
+            else
+                rbt_concurrent_remove(args->concurrent, &value);
+        }
+        else
+            TEST_ASSERT(rbt_concurrent_exists(args->concurrent, args->values + rand_r(&seed) % NUM_OF_ELEMENTS));
+    }
+    return NULL;
+}
+
+// same workload on a red-black tree protected by a read-write lock
+static void* rwlock_worker(void* arg)
+{
+    thread_args* args = arg;
+    unsigned int seed = args->id;
+
+    for (int i = 0; i < OPS_PER_THREAD; i++)
+    {
+        if (i % 100 == 0)
+        {
+            int value = NUM_OF_ELEMENTS + args->id;
+            pthread_rwlock_wrlock(args->lock);
+            if (i % 200 == 0)
+                rbt_insert(args->rbt, createData(value));
+            else
+                rbt_remove(args->rbt, &value);
+            pthread_rwlock_unlock(args->lock);
+        }
+        else
+        {
+            pthread_rwlock_rdlock(args->lock);
+            TEST_ASSERT(rbt_exists(args->rbt, args->values + rand_r(&seed) % NUM_OF_ELEMENTS));
+            pthread_rwlock_unlock(args->lock);
+        }
+    }
+    return NULL;
+}
+
+void test_concurrent(void)
+{
+    int* arr = create_ordered_array(NUM_OF_ELEMENTS);
+
+    printf("\n\n%8s %22s %22s\n", "threads", "concurrent (ops/sec)", "rwlock (ops/sec)");
+    for (int num_of_threads = 1; num_of_threads <= MAX_THREADS; num_of_threads *= 2)
+    {
+        RBTreeConcurrent concurrent = rbt_concurrent_create(compareFunction, free);
+        RBTree rbt = rbt_create(compareFunction, free);
+        pthread_rwlock_t lock;
+        pthread_rwlock_init(&lock, NULL);
+
+        for (uint32_t i = 0; i < NUM_OF_ELEMENTS; i++)
+        {
+            rbt_concurrent_insert(concurrent, createData(arr[i]));
+            rbt_insert(rbt, createData(arr[i]));
+        }
+
+        pthread_t threads[MAX_THREADS];
+        thread_args args[MAX_THREADS];
+        for (int i = 0; i < num_of_threads; i++)
+            args[i] = (thread_args){ concurrent, rbt, &lock, arr, i };
+
+        double cur_time = wall_time();
+        for (int i = 0; i < num_of_threads; i++)
+            pthread_create(threads+i, NULL, concurrent_worker, args+i);
+        for (int i = 0; i < num_of_threads; i++)
+            pthread_join(threads[i], NULL);
+        double time_concurrent = wall_time() - cur_time;
+
+        cur_time = wall_time();
+        for (int i = 0; i < num_of_threads; i++)
+            pthread_create(threads+i, NULL, rwlock_worker, args+i);
+        for (int i = 0; i < num_of_threads; i++)
+            pthread_join(threads[i], NULL);
+        double time_rwlock = wall_time() - cur_time;
+
+        // the values written were removed in the end
+        TEST_ASSERT(rbt_concurrent_size(concurrent) == NUM_OF_ELEMENTS);
+        TEST_ASSERT(rbt_size(rbt) == NUM_OF_ELEMENTS);
+
+        // report throughput
+        double ops = (double)num_of_threads * OPS_PER_THREAD;
+        printf("%8d %22.0f %22.0f\n", num_of_threads, ops / time_concurrent, ops / time_rwlock);
+
+        // free memory used
+        rbt_concurrent_destroy(concurrent);
+        rbt_destroy(rbt);
+        pthread_rwlock_destroy(&lock);
+    }
+    free(arr);
+}
+
 TEST_LIST = {
         { "create", test_create  },
         { "insert", test_insert  },
         { "remove", test_remove  },
         { "traversal", test_traversal  },
+        { "create_from_sorted", test_create_from_sorted  },
+        { "insert_sorted_batch", test_insert_sorted_batch  },
+        { "get_or_insert", test_get_or_insert  },
+        { "iterator", test_iterator  },
+        { "map", test_map  },
+        { "persistent", test_persistent  },
+        { "independent_trees", test_independent_trees  },
+        { "concurrent", test_concurrent  },
         { NULL, NULL }
 };
@@ -0,0 +1,194 @@
+#include <time.h>
+#include <string.h>
+#include "../lib/ADT.h"
+#include "./include/common.h"
+
+#define NUM_OF_STRINGS 200000
+#define NUM_OF_LOOKUPS 2000000
+
+// the i-th test string, "string0".."string199999"
+static char* create_strings(uint32_t num)
+{
+    char* strings = malloc(num * 16);
+    assert(strings != NULL);  // allocation failure
+    for (uint32_t i = 0; i < num; i++)
+        sprintf(strings + 16*i, "string%u", i);
+    return strings;
+}
+
+static int compare_strings(Pointer a, Pointer b)
+{
+    return strcmp(*(char**)a, *(char**)b);
+}
+
+void test_create(void)
+{
+    StringPool pool = sp_create();
+    TEST_ASSERT(pool != NULL);
+    TEST_ASSERT(sp_size(pool) == 0);
+    TEST_ASSERT(sp_lookup(pool, "string") == NULL);
+    sp_destroy(pool);
+}
+
+void test_intern(void)
+{
+    StringPool pool = sp_create();
+    char* strings = create_strings(NUM_OF_STRINGS);
+
+    const char** handles = malloc(NUM_OF_STRINGS * sizeof(const char*));
+    assert(handles != NULL);  // allocation failure
+
+    for (uint32_t i = 0; i < NUM_OF_STRINGS; i++)
+    {
+        handles[i] = sp_intern(pool, strings + 16*i);
+        TEST_ASSERT(handles[i] != strings + 16*i && strcmp(handles[i], strings + 16*i) == 0);
+        TEST_ASSERT(sp_id(handles[i]) == i);  // the ids are given in order of insertion
+        TEST_ASSERT(sp_length(handles[i]) == strlen(strings + 16*i));
+    }
+    TEST_ASSERT(sp_size(pool) == NUM_OF_STRINGS);
+
+    // interning them again returns the same handles and ids, nothing is inserted
+    for (uint32_t i = 0; i < NUM_OF_STRINGS; i++)
+    {
+        TEST_ASSERT(sp_intern(pool, strings + 16*i) == handles[i]);
+        TEST_ASSERT(sp_intern_id(pool, strings + 16*i) == i);
+        TEST_ASSERT(sp_lookup(pool, strings + 16*i) == handles[i]);
+    }
+    TEST_ASSERT(sp_size(pool) == NUM_OF_STRINGS);
+
+    // the handles are stable, the strings are never moved
+    for (uint32_t i = 0; i < NUM_OF_STRINGS; i++)
+    {
+        TEST_ASSERT(strcmp(handles[i], strings + 16*i) == 0);
+        TEST_ASSERT(sp_string(pool, i) == handles[i]);
+    }
+
+    TEST_ASSERT(sp_lookup(pool, "missing") == NULL);
+    TEST_ASSERT(sp_lookup(pool, "") == NULL);
+    TEST_ASSERT(sp_size(pool) == NUM_OF_STRINGS);
+
+    sp_destroy(pool);
+    free(strings);
+    free(handles);
+}
+
+void test_intern_n(void)
+{
+    StringPool pool = sp_create();
+
+    // strings that are not null-terminated, or contain '\0'
+    const char* text = "abcabc";
+    const char* abc = sp_intern_n(pool, text, 3);
+    TEST_ASSERT(strcmp(abc, "abc") == 0 && sp_length(abc) == 3);
+    TEST_ASSERT(sp_intern_n(pool, text + 3, 3) == abc);
+    TEST_ASSERT(sp_intern(pool, "abc") == abc);
+
+    const char* a0b = sp_intern_n(pool, "a\0b", 3);
+    const char* a0c = sp_intern_n(pool, "a\0c", 3);
+    const char* a0 = sp_intern_n(pool, "a\0", 2);
+    const char* a = sp_intern(pool, "a");
+    TEST_ASSERT(a0b != a0c && a0b != a0 && a0 != a);
+    TEST_ASSERT(sp_length(a0b) == 3 && memcmp(a0b, "a\0b", 4) == 0);
+    TEST_ASSERT(sp_length(a0) == 2 && sp_length(a) == 1);
+
+    const char* empty = sp_intern(pool, "");
+    TEST_ASSERT(sp_length(empty) == 0 && empty[0] == '\0');
+    TEST_ASSERT(sp_intern_n(pool, text, 0) == empty && sp_lookup(pool, "") == empty);
+    TEST_ASSERT(sp_size(pool) == 6);
+
+    // strings longer than the blocks of the arena
+    const uint32_t len = 1000000;
+    char* long_string = malloc(len + 1);
+    assert(long_string != NULL);  // allocation failure
+    memset(long_string, 'x', len);
+    long_string[len] = '\0';
+
+    const char* handle = sp_intern(pool, long_string);
+    TEST_ASSERT(sp_length(handle) == len && strcmp(handle, long_string) == 0);
+    TEST_ASSERT(sp_lookup(pool, long_string) == handle);
+    TEST_ASSERT(sp_intern(pool, long_string) == handle);
+    TEST_ASSERT(sp_intern(pool, "abc") == abc && sp_size(pool) == 7);
+
+    sp_destroy(pool);
+    free(long_string);
+}
+
+void test_seed(void)
+{
+    StringPool pool = sp_create();
+    const char* handle = sp_intern(pool, "hello");
+
+    // the strings of the pool are not hashed with the process-wide seed, changing it does not affect them
+    const uint64_t old_seed = hash_get_seed();
+    hash_set_seed(12345);
+    TEST_ASSERT(sp_intern(pool, "hello") == handle && sp_lookup(pool, "hello") == handle);
+    TEST_ASSERT(sp_size(pool) == 1);
+    hash_set_seed(old_seed);
+
+    sp_destroy(pool);
+}
+
+void test_keys(void)
+{
+    // many occurrences of few distinct strings, interned once each
+    StringPool pool = sp_create();
+    char* strings = create_strings(NUM_OF_STRINGS);
+
+    const uint32_t distinct = NUM_OF_STRINGS / 100;
+    uint64_t copies_bytes = 0;
+    for (uint32_t i = 0; i < NUM_OF_STRINGS; i++)
+    {
+        const char* str = strings + 16*(i % distinct);
+        sp_intern(pool, str);
+        copies_bytes += strlen(str) + 1;  // every occurrence as a copy of its own
+    }
+    TEST_ASSERT(sp_size(pool) == distinct);
+    printf("\n%u occurrences of %u strings: %lu bytes as copies, %lu bytes in the pool\n", NUM_OF_STRINGS, distinct,
+           (unsigned long)copies_bytes, (unsigned long)sp_memory(pool));
+    TEST_ASSERT(sp_memory(pool) < copies_bytes);
+
+    // the handles as keys: hashed and compared as integers
+    HashTable by_handle = hash_create64(sp_hash, sp_compare, NULL);
+    HashTable by_string = hash_create64(hash_string64, compare_strings, NULL);
+    RBTree tree = rbt_create(sp_compare, NULL);
+
+    char** string_ptrs = malloc(distinct * sizeof(char*));
+    assert(string_ptrs != NULL);  // allocation failure
+    for (uint32_t i = 0; i < distinct; i++)
+    {
+        string_ptrs[i] = strings + 16*i;
+        TEST_ASSERT(hash_insert(by_handle, (Pointer)sp_string(pool, i)));
+        TEST_ASSERT(hash_insert(by_string, string_ptrs + i));
+        TEST_ASSERT(rbt_insert(tree, (Pointer)sp_string(pool, i)));
+    }
+    TEST_ASSERT(!hash_insert(by_handle, (Pointer)sp_intern(pool, strings)));
+    TEST_ASSERT(rbt_exists(tree, (Pointer)sp_intern(pool, strings + 16*(distinct - 1))));
+
+    clock_t cur_time = clock();
+    for (uint32_t i = 0; i < NUM_OF_LOOKUPS; i++)
+        TEST_ASSERT(hash_exists(by_handle, (Pointer)sp_string(pool, i % distinct)));
+    double time_handles = calc_time(cur_time);
+
+    cur_time = clock();
+    for (uint32_t i = 0; i < NUM_OF_LOOKUPS; i++)
+        TEST_ASSERT(hash_exists(by_string, string_ptrs + i % distinct));
+    double time_strings = calc_time(cur_time);
+
+    printf("%u lookups: strings %.3f s, handles %.3f s\n", NUM_OF_LOOKUPS, time_strings, time_handles);
+
+    hash_destroy(by_handle);
+    hash_destroy(by_string);
+    rbt_destroy(tree);
+    sp_destroy(pool);
+    free(strings);
+    free(string_ptrs);
+}
+
+TEST_LIST = {
+        { "create", test_create  },
+        { "intern", test_intern  },
+        { "intern_n", test_intern_n  },
+        { "seed", test_seed  },
+        { "keys", test_keys  },
+        { NULL, NULL }
+};